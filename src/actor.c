@@ -0,0 +1,339 @@
+/** @file actor.c
+ *
+ *  A minimalist, cross-platform puzzle-platformer, designed
+ *  especially for the Nokia N-Gage.
+ *
+ *  Copyright (c) 2026, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <SDL3/SDL.h>
+
+#if defined __SSE2__
+#include <emmintrin.h>
+#elif defined __ARM_NEON
+#include <arm_neon.h>
+#endif
+
+#include "actor.h"
+#include "config.h"
+#include "fix32.h"
+#include "fixedp.h"
+#include "map.h"
+#include "trace.h"
+
+#define ACTOR_BENCH_MIN    256
+#define ACTOR_BENCH_FRAMES 600
+
+#if defined __SSE2__
+// SSE2 has no 32-bit mullo; multiply even and odd lanes and interleave.
+static __m128i mul_lo_epi32(__m128i a, __m128i b)
+{
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+#endif
+
+static void apply_actor_gravity(fix32_t *velocity_y, int count, fix32_t step)
+{
+    int index = 0;
+
+#if defined __SSE2__
+    __m128i g = _mm_set1_epi32(step);
+    __m128i cap = _mm_set1_epi32(MAX_FALLING_SPEED_FP);
+
+    for (; index + 4 <= count; index += 4)
+    {
+        __m128i v = _mm_add_epi32(_mm_loadu_si128((const __m128i *)(velocity_y + index)), g);
+        __m128i over = _mm_cmpgt_epi32(v, cap);
+        _mm_storeu_si128((__m128i *)(velocity_y + index), _mm_or_si128(_mm_and_si128(over, cap), _mm_andnot_si128(over, v)));
+    }
+#elif defined __ARM_NEON
+    int32x4_t g = vdupq_n_s32(step);
+    int32x4_t cap = vdupq_n_s32(MAX_FALLING_SPEED_FP);
+
+    for (; index + 4 <= count; index += 4)
+    {
+        vst1q_s32(velocity_y + index, vminq_s32(vaddq_s32(vld1q_s32(velocity_y + index), g), cap));
+    }
+#endif
+
+    for (; index < count; index += 1)
+    {
+        velocity_y[index] += step;
+        if (velocity_y[index] > MAX_FALLING_SPEED_FP)
+        {
+            velocity_y[index] = MAX_FALLING_SPEED_FP;
+        }
+    }
+}
+
+static void integrate_actor_axis(fix32_t *pos, const fix32_t *velocity, int count, int ticks)
+{
+    int index = 0;
+
+#if defined __SSE2__
+    __m128i t = _mm_set1_epi32(ticks);
+
+    for (; index + 4 <= count; index += 4)
+    {
+        __m128i p = _mm_loadu_si128((const __m128i *)(pos + index));
+        __m128i v = _mm_loadu_si128((const __m128i *)(velocity + index));
+        _mm_storeu_si128((__m128i *)(pos + index), _mm_add_epi32(p, mul_lo_epi32(v, t)));
+    }
+#elif defined __ARM_NEON
+    for (; index + 4 <= count; index += 4)
+    {
+        vst1q_s32(pos + index, vmlaq_n_s32(vld1q_s32(pos + index), vld1q_s32(velocity + index), ticks));
+    }
+#endif
+
+    for (; index < count; index += 1)
+    {
+        pos[index] += FP_MUL_TICKS(velocity[index], ticks);
+    }
+}
+
+static void collide_actors(actors_t *actors, map_t *map)
+{
+    // Tile lookups are gathers, so this pass stays scalar.
+    tile_desc_t *tile_desc = map->tile_desc;
+
+    for (int index = 0; index < actors->count; index += 1)
+    {
+        int x = fix32_to_int(actors->pos_x[index]);
+        int y = fix32_to_int(actors->pos_y[index]);
+        int half_w = actors->half_w[index];
+        int half_h = actors->half_h[index];
+
+        if (y - half_h >= map->height)
+        {
+            actors->state[index] = ACTOR_DEAD;
+            continue;
+        }
+
+        // Walls and map edges turn an actor around.
+        if (actors->velocity_x[index] > 0)
+        {
+            int edge_x = x + half_w;
+            if (edge_x >= map->width)
+            {
+                actors->pos_x[index] = fix32_from_int(map->width - half_w);
+                actors->velocity_x[index] = -actors->velocity_x[index];
+            }
+            else if (y >= 0 && y < map->height && tile_desc[get_tile_index(edge_x, y, map)].is_wall)
+            {
+                actors->pos_x[index] = fix32_from_int(SNAP_TO_TILE(edge_x) - half_w);
+                actors->velocity_x[index] = -actors->velocity_x[index];
+            }
+        }
+        else if (actors->velocity_x[index] < 0)
+        {
+            int edge_x = x - half_w;
+            if (edge_x < 0)
+            {
+                actors->pos_x[index] = fix32_from_int(half_w);
+                actors->velocity_x[index] = -actors->velocity_x[index];
+            }
+            else if (y >= 0 && y < map->height && tile_desc[get_tile_index(edge_x, y, map)].is_wall)
+            {
+                actors->pos_x[index] = fix32_from_int(SNAP_TO_TILE(edge_x) + TILE_SIZE + half_w);
+                actors->velocity_x[index] = -actors->velocity_x[index];
+            }
+        }
+
+        // Land on solid tiles while falling.
+        int feet_y = y + half_h;
+        if (actors->velocity_y[index] >= 0 && feet_y >= 0 && feet_y < map->height && x >= 0 && x < map->width)
+        {
+            int tile = get_tile_index(x, feet_y, map);
+            int ground_y = SNAP_TO_TILE(feet_y) + tile_desc[tile].offset_top;
+
+            if (tile_desc[tile].is_solid && feet_y >= ground_y)
+            {
+                actors->pos_y[index] = fix32_from_int(ground_y - half_h);
+                actors->velocity_y[index] = 0;
+                actors->state[index] = ACTOR_GROUNDED;
+                continue;
+            }
+        }
+
+        actors->state[index] = ACTOR_AIRBORNE;
+    }
+}
+
+static void remove_dead_actors(actors_t *actors)
+{
+    int index = 0;
+
+    // Swap-remove; order is not meaningful.
+    while (index < actors->count)
+    {
+        if (ACTOR_DEAD != actors->state[index])
+        {
+            index += 1;
+            continue;
+        }
+
+        int last = actors->count - 1;
+        actors->pos_x[index] = actors->pos_x[last];
+        actors->pos_y[index] = actors->pos_y[last];
+        actors->velocity_x[index] = actors->velocity_x[last];
+        actors->velocity_y[index] = actors->velocity_y[last];
+        actors->half_w[index] = actors->half_w[last];
+        actors->half_h[index] = actors->half_h[last];
+        actors->state[index] = actors->state[last];
+        actors->count = last;
+    }
+}
+
+void destroy_actors(actors_t *actors)
+{
+    if (actors)
+    {
+        SDL_free(actors->state);
+        SDL_free(actors->half_h);
+        SDL_free(actors->half_w);
+        SDL_free(actors->velocity_y);
+        SDL_free(actors->velocity_x);
+        SDL_free(actors->pos_y);
+        SDL_free(actors->pos_x);
+        SDL_free(actors);
+    }
+}
+
+bool create_actors(int capacity, actors_t **actors)
+{
+    *actors = (actors_t *)SDL_calloc(1, sizeof(actors_t));
+    if (!*actors)
+    {
+        SDL_Log("Error allocating memory for actors");
+        return false;
+    }
+
+    (*actors)->pos_x = (fix32_t *)SDL_calloc(capacity, sizeof(fix32_t));
+    (*actors)->pos_y = (fix32_t *)SDL_calloc(capacity, sizeof(fix32_t));
+    (*actors)->velocity_x = (fix32_t *)SDL_calloc(capacity, sizeof(fix32_t));
+    (*actors)->velocity_y = (fix32_t *)SDL_calloc(capacity, sizeof(fix32_t));
+    (*actors)->half_w = (int *)SDL_calloc(capacity, sizeof(int));
+    (*actors)->half_h = (int *)SDL_calloc(capacity, sizeof(int));
+    (*actors)->state = (Uint8 *)SDL_calloc(capacity, sizeof(Uint8));
+
+    if (!(*actors)->pos_x || !(*actors)->pos_y || !(*actors)->velocity_x || !(*actors)->velocity_y ||
+        !(*actors)->half_w || !(*actors)->half_h || !(*actors)->state)
+    {
+        SDL_Log("Error allocating memory for %d actors", capacity);
+        destroy_actors(*actors);
+        *actors = NULL;
+        return false;
+    }
+
+    (*actors)->capacity = capacity;
+
+    return true;
+}
+
+void clear_actors(actors_t *actors)
+{
+    if (actors)
+    {
+        actors->count = 0;
+    }
+}
+
+int spawn_actor(actors_t *actors, int x, int y, int half_w, int half_h, fix32_t velocity_x)
+{
+    if (!actors || actors->count >= actors->capacity)
+    {
+        return -1;
+    }
+
+    int index = actors->count;
+    actors->pos_x[index] = fix32_from_int(x);
+    actors->pos_y[index] = fix32_from_int(y);
+    actors->velocity_x[index] = velocity_x;
+    actors->velocity_y[index] = 0;
+    actors->half_w[index] = half_w;
+    actors->half_h[index] = half_h;
+    actors->state[index] = ACTOR_AIRBORNE;
+    actors->count += 1;
+
+    return index;
+}
+
+void update_actors(actors_t *actors, map_t *map, Uint64 delta_time)
+{
+    if (!actors || !actors->count || !map)
+    {
+        return;
+    }
+
+    int ticks = (delta_time > MAX_DELTA_TIME) ? MAX_DELTA_TIME : (int)delta_time;
+
+    apply_actor_gravity(actors->velocity_y, actors->count, FP_MUL_TICKS(GRAVITY_FP, ticks));
+    integrate_actor_axis(actors->pos_x, actors->velocity_x, actors->count, ticks);
+    integrate_actor_axis(actors->pos_y, actors->velocity_y, actors->count, ticks);
+    collide_actors(actors, map);
+    remove_dead_actors(actors);
+}
+
+bool benchmark_actors(int max_count)
+{
+    char first_map[11] = { 0 };
+    map_t *map = NULL;
+    actors_t *actors = NULL;
+
+    SDL_snprintf(first_map, 11, "%03d.%s", FIRST_LEVEL, MAP_SUFFIX);
+    if (!prepare_map(first_map, &map))
+    {
+        return false;
+    }
+
+    if (!create_actors(max_count, &actors))
+    {
+        destroy_map(map);
+        return false;
+    }
+
+    SDL_Log("Actor update cost on %s, %d frames per run", first_map, ACTOR_BENCH_FRAMES);
+
+    for (int count = ACTOR_BENCH_MIN; count <= max_count; count *= 2)
+    {
+        Uint32 seed = 1;
+        Uint64 actor_updates = 0;
+
+        clear_actors(actors);
+        for (int index = 0; index < count; index += 1)
+        {
+            seed = (seed * 1103515245) + 12345;
+            int x = (int)((seed >> 8) % (Uint32)map->width);
+            seed = (seed * 1103515245) + 12345;
+            int y = (int)((seed >> 8) % (Uint32)(map->height / 2));
+            fix32_t velocity_x = (seed & 0x10000) ? MAX_SPEED_FP / 2 : -MAX_SPEED_FP / 2;
+
+            spawn_actor(actors, x, y, 8, 8, velocity_x);
+        }
+
+        Uint64 start = SDL_GetTicksNS();
+        for (int frame = 0; frame < ACTOR_BENCH_FRAMES; frame += 1)
+        {
+            actor_updates += actors->count;
+            update_actors(actors, map, TRACE_TICK_MS);
+        }
+        Uint64 elapsed = SDL_GetTicksNS() - start;
+
+        SDL_Log("%6d actors: %.3f ms/frame, %.2f ns/actor",
+                count,
+                (double)elapsed / ACTOR_BENCH_FRAMES / 1000000.0,
+                actor_updates ? (double)elapsed / actor_updates : 0.0);
+    }
+
+    destroy_actors(actors);
+    destroy_map(map);
+
+    return true;
+}
@@ -0,0 +1,52 @@
+/** @file actor.h
+ *
+ *  A minimalist, cross-platform puzzle-platformer, designed
+ *  especially for the Nokia N-Gage.
+ *
+ *  Copyright (c) 2026, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#ifndef ACTOR_H
+#define ACTOR_H
+
+#include <SDL3/SDL.h>
+
+#include "fix32.h"
+#include "map.h"
+
+typedef enum actor_state
+{
+    ACTOR_AIRBORNE = 0,
+    ACTOR_GROUNDED,
+    ACTOR_DEAD
+
+} actor_state_t;
+
+// Enemies, platforms and projectiles; one array per field so every
+// batch pass streams only what it touches. Nothing in the maps spawns
+// actors yet, so only the --actors benchmark drives them for now.
+typedef struct actors
+{
+    fix32_t *pos_x; // Centre of the AABB.
+    fix32_t *pos_y;
+    fix32_t *velocity_x;
+    fix32_t *velocity_y;
+    int *half_w;
+    int *half_h;
+    Uint8 *state;
+
+    int count;
+    int capacity;
+
+} actors_t;
+
+void destroy_actors(actors_t *actors);
+bool create_actors(int capacity, actors_t **actors);
+void clear_actors(actors_t *actors);
+int spawn_actor(actors_t *actors, int x, int y, int half_w, int half_h, fix32_t velocity_x);
+void update_actors(actors_t *actors, map_t *map, Uint64 delta_time);
+bool benchmark_actors(int max_count);
+
+#endif // ACTOR_H
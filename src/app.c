@@ -11,12 +11,12 @@
 #include "SDL3/SDL.h"
 
 #include "app.h"
+#include "audio.h"
 #include "config.h"
+#include "music.h"
 #include "pfs.h"
 
-static SDL_AudioDeviceID audio_device;
-
-bool init_app(SDL_Renderer **renderer, SDL_Window *window)
+bool init_app(SDL_Renderer **renderer, SDL_Window *window, SDL_AudioDeviceID *audio_device)
 {
 #ifndef __SYMBIAN32__
     SDL_SetHint("SDL_RENDER_VSYNC", "1");
@@ -109,19 +109,27 @@ bool init_app(SDL_Renderer **renderer, SDL_Window *window)
     SDL_AudioSpec spec;
     spec.channels = 1;
     spec.format = SDL_AUDIO_S16;
-    spec.freq = 8000;
+    spec.freq = AUDIO_FREQ;
 
-    audio_device = SDL_OpenAudioDevice(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, &spec);
-    if (audio_device == 0)
+    *audio_device = SDL_OpenAudioDevice(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, &spec);
+    if (*audio_device == 0)
     {
         SDL_Log("SDL_OpenAudioDevice: %s", SDL_GetError());
         return false;
     }
 
+    if (!init_mixer(*audio_device))
+    {
+        return false;
+    }
+    init_music(*audio_device);
+
     return true;
 }
 
-void destroy_app(void)
+void destroy_app(SDL_AudioDeviceID audio_device)
 {
+    stop_music();
+    destroy_mixer();
     SDL_CloseAudioDevice(audio_device);
 }
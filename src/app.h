@@ -13,7 +13,7 @@
 
 #include <SDL3/SDL.h>
 
-bool init_app(SDL_Renderer **renderer, SDL_Window *window);
-void destroy_app(void);
+bool init_app(SDL_Renderer **renderer, SDL_Window *window, SDL_AudioDeviceID *audio_device);
+void destroy_app(SDL_AudioDeviceID audio_device);
 
 #endif // APP_H
@@ -0,0 +1,350 @@
+/** @file audio.c
+ *
+ *  A minimalist, cross-platform puzzle-platformer, designed
+ *  especially for the Nokia N-Gage.
+ *
+ *  Copyright (c) 2026, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <SDL3/SDL.h>
+
+#include "audio.h"
+#include "config.h"
+#include "pfs.h"
+
+#define MIXER_CHUNK         256
+#define MIXER_QUEUE_MASK    (MIXER_QUEUE_SIZE - 1)
+#define MIXER_VOLUME_SHIFT  8 // Volume is Q8: 256 plays a clip unchanged.
+#define MIXER_BENCH_SECONDS 10
+
+typedef struct voice
+{
+    const sound_t *sound;
+    int position;
+    int volume;
+
+} voice_t;
+
+typedef struct mixer_command
+{
+    const sound_t *sound; // NULL stops every voice.
+    int volume;
+
+} mixer_command_t;
+
+static const char *sound_file[SOUND_COUNT] = { "coin.wav", "jump.wav", "death.wav" };
+static sound_t sound[SOUND_COUNT];
+static bool sounds_loaded = false;
+
+// Owned by the audio thread once the stream is bound; nothing here allocates or locks.
+static voice_t voice[MIXER_VOICES];
+static Sint32 mix_buffer[MIXER_CHUNK];
+static Sint16 out_buffer[MIXER_CHUNK];
+
+// Single-producer/single-consumer ring: the game thread only advances head,
+// the audio thread only advances tail.
+static mixer_command_t command[MIXER_QUEUE_SIZE];
+static SDL_AtomicInt command_head;
+static SDL_AtomicInt command_tail;
+
+static SDL_AudioStream *stream = NULL;
+
+static bool push_command(const sound_t *clip, int volume)
+{
+    Uint32 head = (Uint32)SDL_GetAtomicInt(&command_head);
+    Uint32 tail = (Uint32)SDL_GetAtomicInt(&command_tail);
+
+    // Full: drop the command rather than wait for the audio thread.
+    if (head - tail >= MIXER_QUEUE_SIZE)
+    {
+        return false;
+    }
+
+    command[head & MIXER_QUEUE_MASK].sound = clip;
+    command[head & MIXER_QUEUE_MASK].volume = volume;
+    SDL_SetAtomicInt(&command_head, (int)(head + 1));
+
+    return true;
+}
+
+static void start_voice(const sound_t *clip, int volume)
+{
+    voice_t *slot = &voice[0];
+
+    // Take a free voice, otherwise steal the one closest to its end.
+    for (int index = 0; index < MIXER_VOICES; index += 1)
+    {
+        if (!voice[index].sound)
+        {
+            slot = &voice[index];
+            break;
+        }
+        if (voice[index].position > slot->position)
+        {
+            slot = &voice[index];
+        }
+    }
+
+    slot->sound = clip;
+    slot->position = 0;
+    slot->volume = volume;
+}
+
+static void drain_commands(void)
+{
+    Uint32 tail = (Uint32)SDL_GetAtomicInt(&command_tail);
+    Uint32 head = (Uint32)SDL_GetAtomicInt(&command_head);
+
+    while (tail != head)
+    {
+        const mixer_command_t *next = &command[tail & MIXER_QUEUE_MASK];
+
+        if (next->sound)
+        {
+            start_voice(next->sound, next->volume);
+        }
+        else
+        {
+            SDL_zeroa(voice);
+        }
+        tail += 1;
+    }
+
+    SDL_SetAtomicInt(&command_tail, (int)tail);
+}
+
+static void mix_voices(int count)
+{
+    SDL_memset(mix_buffer, 0, sizeof(Sint32) * count);
+
+    for (int index = 0; index < MIXER_VOICES; index += 1)
+    {
+        voice_t *active = &voice[index];
+        if (!active->sound)
+        {
+            continue;
+        }
+
+        int remaining = active->sound->length - active->position;
+        int length = (remaining < count) ? remaining : count;
+        const Sint16 *src = active->sound->samples + active->position;
+        Sint32 volume = active->volume;
+
+        for (int sample = 0; sample < length; sample += 1)
+        {
+            mix_buffer[sample] += (src[sample] * volume) >> MIXER_VOLUME_SHIFT;
+        }
+
+        active->position += length;
+        if (active->position >= active->sound->length)
+        {
+            active->sound = NULL;
+        }
+    }
+
+    for (int sample = 0; sample < count; sample += 1)
+    {
+        Sint32 value = mix_buffer[sample];
+        out_buffer[sample] = (Sint16)((value > SDL_MAX_SINT16) ? SDL_MAX_SINT16 : (value < SDL_MIN_SINT16) ? SDL_MIN_SINT16 : value);
+    }
+}
+
+static void SDLCALL feed_mixer(void *userdata, SDL_AudioStream *audio_stream, int additional_amount, int total_amount)
+{
+    int samples = additional_amount / (int)sizeof(Sint16);
+
+    drain_commands();
+
+    while (samples > 0)
+    {
+        int count = (samples < MIXER_CHUNK) ? samples : MIXER_CHUNK;
+
+        mix_voices(count);
+        SDL_PutAudioStreamData(audio_stream, out_buffer, count * (int)sizeof(Sint16));
+        samples -= count;
+    }
+}
+
+static bool load_sound(const char *file_name, sound_t *clip)
+{
+    const SDL_AudioSpec device_spec = { SDL_AUDIO_S16, 1, AUDIO_FREQ };
+    SDL_AudioSpec spec;
+    Uint8 *wav = NULL;
+    Uint32 wav_length = 0;
+    int length = 0;
+
+    Uint8 *buffer = (Uint8 *)load_binary_file_from_path(file_name);
+    if (!buffer)
+    {
+        // Sounds are optional; a missing clip just stays silent.
+        SDL_LogDebug(SDL_LOG_CATEGORY_AUDIO, "Sound %s not packed", file_name);
+        return true;
+    }
+
+    // SDL decodes both PCM and IMA ADPCM WAV files.
+    SDL_IOStream *io = SDL_IOFromConstMem(buffer, size_of_file(file_name));
+    if (!io || !SDL_LoadWAV_IO(io, true, &spec, &wav, &wav_length))
+    {
+        SDL_Log("Couldn't decode sound %s: %s", file_name, SDL_GetError());
+        SDL_free(buffer);
+        return false;
+    }
+    SDL_free(buffer);
+
+    if (!SDL_ConvertAudioSamples(&spec, wav, (int)wav_length, &device_spec, (Uint8 **)&clip->samples, &length))
+    {
+        SDL_Log("Couldn't convert sound %s: %s", file_name, SDL_GetError());
+        SDL_free(wav);
+        return false;
+    }
+    SDL_free(wav);
+
+    clip->length = length / (int)sizeof(Sint16);
+
+    return true;
+}
+
+bool init_mixer(SDL_AudioDeviceID device)
+{
+    const SDL_AudioSpec spec = { SDL_AUDIO_S16, 1, AUDIO_FREQ };
+
+    stream = SDL_CreateAudioStream(&spec, &spec);
+    if (!stream)
+    {
+        SDL_Log("Couldn't create mixer stream: %s", SDL_GetError());
+        return false;
+    }
+
+    if (!SDL_SetAudioStreamGetCallback(stream, feed_mixer, NULL) || !SDL_BindAudioStream(device, stream))
+    {
+        SDL_Log("Couldn't bind mixer stream: %s", SDL_GetError());
+        SDL_DestroyAudioStream(stream);
+        stream = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+bool load_sounds(void)
+{
+    // Decoded once, on the first level load; the pool never changes under the audio thread.
+    if (sounds_loaded)
+    {
+        return true;
+    }
+
+    for (int index = 0; index < SOUND_COUNT; index += 1)
+    {
+        if (!load_sound(sound_file[index], &sound[index]))
+        {
+            return false;
+        }
+    }
+    sounds_loaded = true;
+
+    return true;
+}
+
+void play_sound(sound_id_t id, int volume)
+{
+    if (!stream || id >= SOUND_COUNT || !sound[id].samples)
+    {
+        return;
+    }
+
+    push_command(&sound[id], volume);
+}
+
+void stop_sounds(void)
+{
+    push_command(NULL, 0);
+}
+
+void destroy_mixer(void)
+{
+    // Destroying the stream unbinds it, so the callback is no longer running below.
+    if (stream)
+    {
+        SDL_DestroyAudioStream(stream);
+        stream = NULL;
+    }
+
+    for (int index = 0; index < SOUND_COUNT; index += 1)
+    {
+        SDL_free(sound[index].samples);
+        sound[index].samples = NULL;
+        sound[index].length = 0;
+    }
+    sounds_loaded = false;
+}
+
+#if defined BENCHMARK
+bool benchmark_mixer(int max_voices)
+{
+    sound_t tone;
+
+    tone.length = AUDIO_FREQ * MIXER_BENCH_SECONDS;
+    tone.samples = (Sint16 *)SDL_malloc(sizeof(Sint16) * tone.length);
+    if (!tone.samples)
+    {
+        SDL_Log("Error allocating memory for benchmark tone");
+        return false;
+    }
+
+    // Square wave at 440 Hz; every voice stays active for the whole run.
+    for (int sample = 0; sample < tone.length; sample += 1)
+    {
+        tone.samples[sample] = ((sample * 880 / AUDIO_FREQ) & 1) ? 8000 : -8000;
+    }
+
+    // The benchmark thread becomes the only consumer.
+    if (stream)
+    {
+        SDL_UnbindAudioStream(stream);
+    }
+
+    if (max_voices > MIXER_VOICES)
+    {
+        max_voices = MIXER_VOICES;
+    }
+
+    SDL_Log("Mixing %d s of %d Hz audio per run", MIXER_BENCH_SECONDS, AUDIO_FREQ);
+
+    for (int voices = 1; voices <= max_voices; voices *= 2)
+    {
+        int samples = tone.length;
+
+        stop_sounds();
+        drain_commands();
+        for (int index = 0; index < voices; index += 1)
+        {
+            push_command(&tone, 256 / voices);
+        }
+
+        Uint64 start = SDL_GetTicksNS();
+        while (samples > 0)
+        {
+            int count = (samples < MIXER_CHUNK) ? samples : MIXER_CHUNK;
+
+            drain_commands();
+            mix_voices(count);
+            samples -= count;
+        }
+        Uint64 elapsed = SDL_GetTicksNS() - start;
+
+        SDL_Log("%3d voices: %.3f ms per second of audio, %.0fx realtime",
+                voices,
+                (double)elapsed / MIXER_BENCH_SECONDS / 1000000.0,
+                (double)MIXER_BENCH_SECONDS * SDL_NS_PER_SECOND / (double)(elapsed ? elapsed : 1));
+    }
+
+    stop_sounds();
+    drain_commands();
+    SDL_free(tone.samples);
+
+    return true;
+}
+#endif
@@ -0,0 +1,42 @@
+/** @file audio.h
+ *
+ *  A minimalist, cross-platform puzzle-platformer, designed
+ *  especially for the Nokia N-Gage.
+ *
+ *  Copyright (c) 2026, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include <SDL3/SDL.h>
+
+typedef enum sound_id
+{
+    SOUND_COIN = 0,
+    SOUND_JUMP,
+    SOUND_DEATH,
+    SOUND_COUNT
+
+} sound_id_t;
+
+// A clip decoded to the device format, S16 mono at AUDIO_FREQ.
+typedef struct sound
+{
+    Sint16 *samples;
+    int length;
+
+} sound_t;
+
+bool init_mixer(SDL_AudioDeviceID device);
+bool load_sounds(void);
+void play_sound(sound_id_t id, int volume);
+void stop_sounds(void);
+void destroy_mixer(void);
+#if defined BENCHMARK
+bool benchmark_mixer(int max_voices);
+#endif
+
+#endif // AUDIO_H
@@ -0,0 +1,228 @@
+/** @file batch.c
+ *
+ *  A minimalist, cross-platform puzzle-platformer, designed
+ *  especially for the Nokia N-Gage.
+ *
+ *  Copyright (c) 2026, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <SDL3/SDL.h>
+
+#include "batch.h"
+#include "core.h"
+#include "trace.h"
+
+#if !defined WORLD_MODE
+typedef struct batch
+{
+    const char *file_name;
+    int instances;
+    SDL_AtomicInt next_instance;
+    SDL_AtomicInt failures;
+    Uint32 *hash;  // Final state hash, one per instance.
+    Uint64 *ticks; // Ticks simulated, one per instance.
+
+} batch_t;
+
+static bool run_instance(const char *file_name, Uint32 *hash, Uint64 *ticks)
+{
+    trace_t *trace = create_trace();
+    core_t *nc = NULL;
+    bool exit_code = false;
+
+    if (!trace)
+    {
+        return false;
+    }
+
+    // Clock, input and hash of this instance live in its own trace.
+    bind_trace(trace);
+
+    if (start_replay(file_name) && init_headless(&nc))
+    {
+        unsigned int pressed = 0;
+        unsigned int released = 0;
+
+        exit_code = true;
+
+        // Same steps as a replay in the app, minus drawing; quitting through the menu ends the run.
+        while (replay_input(&pressed, &released) && apply_buttons(nc, pressed, released) && update(nc))
+        {
+            hash_state(nc);
+            *ticks += 1;
+        }
+        *hash = get_state_hash();
+    }
+
+    stop_replay();
+    destroy(nc);
+    bind_trace(NULL);
+    destroy_trace(trace);
+
+    return exit_code;
+}
+
+static int SDLCALL run_worker(void *data)
+{
+    batch_t *batch = (batch_t *)data;
+
+    for (;;)
+    {
+        int instance = SDL_AddAtomicInt(&batch->next_instance, 1);
+        if (instance >= batch->instances)
+        {
+            break;
+        }
+
+        batch->ticks[instance] = 0;
+        if (!run_instance(batch->file_name, &batch->hash[instance], &batch->ticks[instance]))
+        {
+            SDL_AddAtomicInt(&batch->failures, 1);
+        }
+    }
+
+    return 0;
+}
+
+static int next_thread_count(int threads, int max_threads)
+{
+    if (threads < max_threads && threads * 2 > max_threads)
+    {
+        return max_threads;
+    }
+
+    return threads * 2;
+}
+#endif
+
+bool run_batch(const char *file_name, int instances)
+{
+#if defined WORLD_MODE
+    SDL_Log("Batch replays need separate levels, not a world");
+    return false;
+#else
+    int max_threads = SDL_GetNumLogicalCPUCores();
+    batch_t batch;
+    bool exit_code = true;
+    double base_rate = 0.0;
+
+    if (instances < 1)
+    {
+        instances = 1;
+    }
+    if (max_threads < 1)
+    {
+        max_threads = 1;
+    }
+
+    SDL_zero(batch);
+    batch.file_name = file_name;
+    batch.instances = instances;
+    batch.hash = (Uint32 *)SDL_calloc(instances, sizeof(Uint32));
+    batch.ticks = (Uint64 *)SDL_calloc(instances, sizeof(Uint64));
+
+    SDL_Thread **thread = (SDL_Thread **)SDL_calloc(max_threads, sizeof(SDL_Thread *));
+    if (!batch.hash || !batch.ticks || !thread)
+    {
+        SDL_Log("Failed to allocate memory for batch run");
+        SDL_free(batch.hash);
+        SDL_free(batch.ticks);
+        SDL_free(thread);
+        return false;
+    }
+
+    SDL_Log("Batch replay of %s, %d headless instance(s) per run, up to %d thread(s)", file_name, instances, max_threads);
+
+    // Doubling thread counts, and all cores last, show where throughput stops scaling.
+    for (int threads = 1; exit_code && threads <= max_threads; threads = next_thread_count(threads, max_threads))
+    {
+        SDL_LogPriority priority = SDL_GetLogPriority(SDL_LOG_CATEGORY_APPLICATION);
+        int started = 0;
+
+        SDL_SetAtomicInt(&batch.next_instance, 0);
+        SDL_SetAtomicInt(&batch.failures, 0);
+
+        // Every instance would announce its replay and each map it loads.
+        SDL_SetLogPriority(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_WARN);
+
+        Uint64 start = SDL_GetTicksNS();
+        for (int index = 0; index < threads; index += 1)
+        {
+            thread[index] = SDL_CreateThread(run_worker, "batch_worker", &batch);
+            if (!thread[index])
+            {
+                break;
+            }
+            started += 1;
+        }
+        for (int index = 0; index < started; index += 1)
+        {
+            SDL_WaitThread(thread[index], NULL);
+        }
+        Uint64 elapsed = SDL_GetTicksNS() - start;
+
+        SDL_SetLogPriority(SDL_LOG_CATEGORY_APPLICATION, priority);
+
+        if (started < threads)
+        {
+            SDL_Log("Couldn't start batch worker: %s", SDL_GetError());
+            exit_code = false;
+            break;
+        }
+
+        int failures = SDL_GetAtomicInt(&batch.failures);
+        if (failures)
+        {
+            SDL_Log("%d instance(s) failed to replay %s", failures, file_name);
+            exit_code = false;
+            break;
+        }
+
+        Uint64 total_ticks = 0;
+        int mismatches = 0;
+        for (int index = 0; index < instances; index += 1)
+        {
+            total_ticks += batch.ticks[index];
+            if (batch.hash[index] != batch.hash[0] || batch.ticks[index] != batch.ticks[0])
+            {
+                mismatches += 1;
+            }
+        }
+
+        // Every instance replays the same input, so any difference is shared state leaking.
+        if (mismatches)
+        {
+            SDL_Log("%d instance(s) diverged from state hash 0x%08" SDL_PRIx32, mismatches, batch.hash[0]);
+            exit_code = false;
+            break;
+        }
+
+        double seconds = (double)elapsed / 1000000000.0;
+        double rate = seconds > 0.0 ? (double)instances / seconds : 0.0;
+        if (1 == threads)
+        {
+            base_rate = rate;
+        }
+
+        SDL_Log("%3d thread(s): %8.1f instances/s, %12.0f ticks/s, %5.2fx, %.2f per thread",
+                threads,
+                rate,
+                seconds > 0.0 ? (double)total_ticks / seconds : 0.0,
+                base_rate > 0.0 ? rate / base_rate : 0.0,
+                base_rate > 0.0 ? rate / base_rate / threads : 0.0);
+    }
+
+    if (exit_code)
+    {
+        SDL_Log("State hash:    0x%08" SDL_PRIx32 " after %" SDL_PRIu64 " ticks", batch.hash[0], batch.ticks[0]);
+    }
+
+    SDL_free(batch.hash);
+    SDL_free(batch.ticks);
+    SDL_free(thread);
+
+    return exit_code;
+#endif
+}
@@ -0,0 +1,18 @@
+/** @file batch.h
+ *
+ *  A minimalist, cross-platform puzzle-platformer, designed
+ *  especially for the Nokia N-Gage.
+ *
+ *  Copyright (c) 2026, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <SDL3/SDL.h>
+
+bool run_batch(const char *file_name, int instances);
+
+#endif // BATCH_H
@@ -13,27 +13,22 @@
 #include "cheats.h"
 #include "utils.h"
 
-#define BUFFER_SIZE 15
-
-static button_t sequence_ring_buffer[BUFFER_SIZE] = { 0 };
-static int current_index = 0;
-
-void add_to_ring_buffer(button_t button)
+void add_to_ring_buffer(cheats_t *cheats, button_t button)
 {
-    sequence_ring_buffer[current_index] = button;
-    current_index = (current_index + 1) % BUFFER_SIZE;
+    cheats->ring_buffer[cheats->current_index] = button;
+    cheats->current_index = (cheats->current_index + 1) % BUFFER_SIZE;
 }
 
-void clear_ring_buffer(void)
+void clear_ring_buffer(cheats_t *cheats)
 {
     for (int i = 0; i < BUFFER_SIZE; i++)
     {
-        sequence_ring_buffer[i] = 0;
+        cheats->ring_buffer[i] = 0;
     }
-    current_index = 0;
+    cheats->current_index = 0;
 }
 
-bool find_sequence(const button_t *sequence, int sequence_length)
+bool find_sequence(cheats_t *cheats, const button_t *sequence, int sequence_length)
 {
     if (sequence_length > BUFFER_SIZE)
     {
@@ -46,8 +41,8 @@ bool find_sequence(const button_t *sequence, int sequence_length)
     // last written position.
     for (int j = 0; j < sequence_length; j++)
     {
-        int buf_pos = (current_index - 1 - j + BUFFER_SIZE) % BUFFER_SIZE;
-        if (sequence_ring_buffer[buf_pos] != sequence[sequence_length - 1 - j])
+        int buf_pos = (cheats->current_index - 1 - j + BUFFER_SIZE) % BUFFER_SIZE;
+        if (cheats->ring_buffer[buf_pos] != sequence[sequence_length - 1 - j])
         {
             return false;
         }
@@ -15,8 +15,17 @@
 
 #include "utils.h"
 
-void add_to_ring_buffer(button_t button);
-void clear_ring_buffer(void);
-bool find_sequence(const button_t *sequence, int sequence_length);
+#define BUFFER_SIZE 15
+
+typedef struct cheats
+{
+    button_t ring_buffer[BUFFER_SIZE];
+    int current_index;
+
+} cheats_t;
+
+void add_to_ring_buffer(cheats_t *cheats, button_t button);
+void clear_ring_buffer(cheats_t *cheats);
+bool find_sequence(cheats_t *cheats, const button_t *sequence, int sequence_length);
 
 #endif // CHEATS_H
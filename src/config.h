@@ -18,19 +18,60 @@
 #define ANIM_FPS          15
 #define DEATH_LINE_COUNT  21
 #define DECELERATION      0.0025f
+#define DIALOGUE_CACHE    8
 #define FIRST_LEVEL       1
+#define LAST_LEVEL        6
 #define GRAVITY           0.00125f
 #define JUMP_VELOCITY     0.3f
+#define MAX_DELTA_TIME    100
 #define MAX_FALLING_SPEED 0.2f
 #define MAX_SPEED         0.1f
 #define PRIDE_LINE_COUNT  5
 
+#define AUDIO_FREQ       8000
+#define MIXER_VOICES     64
+#define MIXER_QUEUE_SIZE 128 // Power of two; play requests beyond this per audio callback are dropped.
+
+#define SAVE_ORG        "ngagesdk"
+#define SAVE_APP        "kagekero"
+#define SAVE_FILE       "state.sav"
+#define SAVE_BENCH_FILE "bench.sav"
+
+#define LEVEL_BENCH_FILE "levels.json"
+#define BATCH_INSTANCES  256 // Headless game instances per batch run.
+
+#define MUSIC_FILE           "music.wav"
+#define MUSIC_BLOCK_MAX      1024 // Largest IMA ADPCM block read from the archive at once.
+#define MUSIC_BUFFER_SAMPLES 2048 // Per half of the decode double buffer.
+
+#define MAX_GAMEPADS   4
+#define STICK_DEADZONE 8000 // Left stick travel, out of 32767, before it counts as a direction.
+
 #define SCREEN_W 176
 #define SCREEN_H 208
 
-#if defined __SYMBIAN32__
-#define TILE_SIZE  16
-#define TILE_SHIFT 4 // log2(16) = 4, for bit shift operations (>> 4 and << 4).
+// Square tiles shared by every map and tileset.png; load_map() rejects maps that differ.
+#define TILE_SIZE       16
+#define TILESET_COLUMNS 32 // tileset.png is 512 px wide.
+
+// 8, 16 and 32 px tiles convert with shifts and masks; other sizes divide, rounding
+// down like the shift does so that positions left of or above the map agree.
+#if TILE_SIZE == 8
+#define TILE_SHIFT 3
+#elif TILE_SIZE == 16
+#define TILE_SHIFT 4
+#elif TILE_SIZE == 32
+#define TILE_SHIFT 5
+#endif
+
+#if defined TILE_SHIFT
+#define POS_TO_TILE(pos)  ((pos) >> TILE_SHIFT)
+#define TILE_TO_POS(tile) ((tile) << TILE_SHIFT)
+#define SNAP_TO_TILE(pos) ((pos) & ~(TILE_SIZE - 1))
+#else
+#define POS_TO_TILE(pos)  (((pos) - ((pos) < 0 ? TILE_SIZE - 1 : 0)) / TILE_SIZE)
+#define TILE_TO_POS(tile) ((tile) * TILE_SIZE)
+#define SNAP_TO_TILE(pos) (TILE_TO_POS(POS_TO_TILE(pos)))
 #endif
 
 #if defined DEBUG
@@ -47,7 +88,6 @@
 #define SCREEN_OFFSET_Y 16
 #define FRAME_IMAGE     "frame_400x240.png"
 #elif defined __EMSCRIPTEN__
-#define MAP_SUFFIX      "tmj"
 #define WINDOW_W        512
 #define WINDOW_H        512
 #define SCREEN_OFFSET_X 168
@@ -77,8 +117,40 @@
 #define FRAME_HEIGHT 480
 #endif
 
+// Maps are archived under their plain name; gzip is detected from the data.
 #ifndef MAP_SUFFIX
-#define MAP_SUFFIX "tmj.gz"
+#define MAP_SUFFIX "tmj"
+#endif
+
+#ifndef WORLD_FILE
+#define WORLD_FILE "kagekero.world"
+#endif
+
+// Streaming limits for world mode, in pixels around the camera.
+#ifndef WORLD_MAX_RESIDENT
+#define WORLD_MAX_RESIDENT 4
+#endif
+
+#ifndef WORLD_PRELOAD_MARGIN
+#define WORLD_PRELOAD_MARGIN 64
+#endif
+
+#ifndef WORLD_UNLOAD_MARGIN
+#define WORLD_UNLOAD_MARGIN 176
+#endif
+
+// Tiles of a streamed map drawn into its canvas per frame.
+#ifndef WORLD_CELLS_PER_FRAME
+#define WORLD_CELLS_PER_FRAME 128
+#endif
+
+// Frame pacing; idle covers pause, dialogue and death, where only sprites animate.
+#ifndef TARGET_FPS
+#define TARGET_FPS 60
+#endif
+
+#ifndef IDLE_FPS
+#define IDLE_FPS ANIM_FPS
 #endif
 
 #ifndef FRAME_IMAGE
@@ -20,10 +20,15 @@
 #include "kero.h"
 #include "map.h"
 #include "menu.h"
+#include "music.h"
 #include "overclock.h"
 #include "overlay.h"
 #include "pfs.h"
+#include "raster.h"
+#include "save.h"
+#include "trace.h"
 #include "utils.h"
+#include "world.h"
 
 bool init(core_t **nc)
 {
@@ -34,7 +39,7 @@ bool init(core_t **nc)
         return false;
     }
 
-    if (!init_app((SDL_Renderer **)&(*nc)->renderer, (*nc)->window))
+    if (!init_app((SDL_Renderer **)&(*nc)->renderer, (*nc)->window, &(*nc)->audio_device))
     {
         return SDL_APP_FAILURE;
     }
@@ -83,12 +88,48 @@ bool init(core_t **nc)
     SDL_SetTextureScaleMode((*nc)->backbuffer, SDL_SCALEMODE_NEAREST);
 #endif
 
+#if defined SOFTWARE_RASTER
+    if (!create_raster(SCREEN_W, SCREEN_H, &(*nc)->raster))
+    {
+        return false;
+    }
+
+    (*nc)->raster_texture = SDL_CreateTexture((*nc)->renderer, SDL_PIXELFORMAT_XRGB4444, SDL_TEXTUREACCESS_STREAMING, SCREEN_W, SCREEN_H);
+    if (!(*nc)->raster_texture)
+    {
+        SDL_Log("Failed to create raster texture: %s", SDL_GetError());
+        return false;
+    }
+    SDL_SetTextureScaleMode((*nc)->raster_texture, SDL_SCALEMODE_NEAREST);
+#endif
+
+    (*nc)->state = STATE_INTRO;
+    return true;
+}
+
+bool init_headless(core_t **nc)
+{
+    // Nothing but the simulation: SDL and the file reader are set up once by init().
+    *nc = (core_t *)SDL_calloc(1, sizeof(core_t));
+    if (!*nc)
+    {
+        SDL_Log("Failed to allocate memory for engine core");
+        return false;
+    }
+
+    (*nc)->is_headless = true;
     (*nc)->state = STATE_INTRO;
     return true;
 }
 
 bool update(core_t *nc)
 {
+    // Decoding happens here, on the game thread, never in the audio callback.
+    if (!nc->is_headless)
+    {
+        update_music();
+    }
+
     switch (nc->state)
     {
         case STATE_INTRO:
@@ -104,7 +145,11 @@ bool update(core_t *nc)
 
 bool draw_scene(core_t *nc)
 {
-    if (nc->map != NULL)
+    if (nc->world != NULL)
+    {
+        clamp_world_camera(nc->world, &nc->cam_x, &nc->cam_y);
+    }
+    else if (nc->map != NULL)
     {
         if (nc->cam_x <= 0)
         {
@@ -124,7 +169,6 @@ bool draw_scene(core_t *nc)
         }
     }
 
-    SDL_FRect src;
     SDL_FRect dst;
 
 #if defined __SYMBIAN32__
@@ -144,7 +188,7 @@ bool draw_scene(core_t *nc)
 
             if (nc->temp_b != NULL)
             {
-                float anim_offset = fix32_to_float(SIN_LUT[(SDL_GetTicks() >> 3) & 0xFF]);
+                float anim_offset = fix32_to_float(SIN_LUT[(get_ticks() >> 3) & 0xFF]);
                 SDL_FRect dst_b;
                 dst_b.x = 96.0f;
                 dst_b.y = 16.0f + anim_offset;
@@ -155,33 +199,62 @@ bool draw_scene(core_t *nc)
         }
         else if (nc->map != NULL)
         {
-            // Draw visible slice of the map.
-            src.x = (float)nc->cam_x;
-            src.y = (float)nc->cam_y;
-            src.w = SCREEN_W;
-            src.h = SCREEN_H;
-            dst.x = 0.f;
-            dst.y = 0.f;
-            dst.w = SCREEN_W;
-            dst.h = SCREEN_H;
-            SDL_RenderTexture(nc->renderer, nc->map->render_target, &src, &dst);
+#if defined SOFTWARE_RASTER
+            // Compose the map slice and kero on the CPU, then upload the frame once.
+            if (nc->world != NULL)
+            {
+                draw_world_raster(nc->world, nc->raster, nc->cam_x, nc->cam_y);
+            }
+            else
+            {
+                blit_raster(nc->raster, nc->map->raster, nc->cam_x, nc->cam_y, SCREEN_W, SCREEN_H, 0, 0, false);
+            }
+            draw_kero(nc->kero, nc->raster, nc->cam_x - nc->map->world_x, nc->cam_y - nc->map->world_y);
+
+            if (!upload_raster(nc->raster, nc->raster_texture))
+            {
+                return false;
+            }
+            SDL_RenderTexture(nc->renderer, nc->raster_texture, NULL, NULL);
+#else
+            if (nc->world != NULL)
+            {
+                // Draw visible slices of all streamed maps, kero lives in the active one.
+                draw_world(nc->world, nc->renderer, nc->cam_x, nc->cam_y);
+                render_kero(nc->kero, nc->renderer, nc->cam_x - nc->map->world_x, nc->cam_y - nc->map->world_y);
+            }
+            else
+            {
+                // Draw visible slice of the map.
+                SDL_FRect src;
+                src.x = (float)nc->cam_x;
+                src.y = (float)nc->cam_y;
+                src.w = SCREEN_W;
+                src.h = SCREEN_H;
+                dst.x = 0.f;
+                dst.y = 0.f;
+                dst.w = SCREEN_W;
+                dst.h = SCREEN_H;
+                SDL_RenderTexture(nc->renderer, nc->map->render_target, &src, &dst);
 
-            // Draw kero in screen space.
-            render_kero(nc->kero, nc->renderer, nc->cam_x, nc->cam_y);
+                // Draw kero in screen space.
+                render_kero(nc->kero, nc->renderer, nc->cam_x, nc->cam_y);
+            }
+#endif
 
             // HUD: coin counter.
             dst.x = 0.f;
             dst.y = 4.f;
             dst.w = 55.f;
             dst.h = 16.f;
-            SDL_RenderTexture(nc->renderer, nc->ui->coin_count_canvas, NULL, &dst);
+            SDL_RenderTexture(nc->renderer, nc->ui->hud_atlas, &nc->ui->widget[HUD_COINS].bounds, &dst);
 
             // HUD: life counter.
             dst.x = 139.f;
             dst.y = 4.f;
             dst.w = 37.f;
             dst.h = 16.f;
-            SDL_RenderTexture(nc->renderer, nc->ui->life_count_canvas, NULL, &dst);
+            SDL_RenderTexture(nc->renderer, nc->ui->hud_atlas, &nc->ui->widget[HUD_LIVES].bounds, &dst);
 
             if (nc->is_paused)
             {
@@ -189,7 +262,7 @@ bool draw_scene(core_t *nc)
                 dst.y = 80.f;
                 dst.w = 96.f;
                 dst.h = 48.f;
-                SDL_RenderTexture(nc->renderer, nc->ui->menu_canvas, NULL, &dst);
+                SDL_RenderTexture(nc->renderer, nc->ui->hud_atlas, &nc->ui->widget[HUD_MENU].bounds, &dst);
             }
 
             if (nc->map->show_dialogue)
@@ -258,9 +331,43 @@ bool draw_scene(core_t *nc)
 
     SDL_RenderPresent(nc->renderer);
 
+    // First present since a press was handled: that press is now on screen.
+    if (nc->input_timestamp)
+    {
+        add_input_latency(SDL_GetTicksNS() - nc->input_timestamp);
+        nc->input_timestamp = 0;
+    }
+
     return true;
 }
 
+void hash_state(core_t *nc)
+{
+    // Fold kero's fixed-point state into the determinism hash.
+    if (nc->kero)
+    {
+        add_state_hash(nc->kero->pos_x);
+        add_state_hash(nc->kero->pos_y);
+        add_state_hash(nc->kero->velocity_x);
+        add_state_hash(nc->kero->velocity_y);
+    }
+}
+
+bool is_idle(core_t *nc)
+{
+    // Only screens where nothing moves but ANIM_FPS sprite animations may drop to idle pacing.
+    switch (nc->state)
+    {
+        case STATE_MENU:
+            // The title logo bobs with the clock and would stutter at ANIM_FPS.
+            return !nc->temp_b;
+        case STATE_GAME:
+            return nc->is_paused || (nc->map && nc->map->show_dialogue) || (nc->kero && STATE_DEAD == nc->kero->state);
+        default:
+            return false;
+    }
+}
+
 static bool handle_button_down(core_t *nc, button_t button)
 {
     switch (nc->state)
@@ -276,6 +383,120 @@ static bool handle_button_down(core_t *nc, button_t button)
     }
 }
 
+bool apply_buttons(core_t *nc, unsigned int pressed, unsigned int released)
+{
+    nc->btn &= ~released;
+
+    // Pressed bits behave like button-down events, in button order.
+    for (unsigned int button = BTN_BACKSPACE; button <= BTN_RIGHT; button += 1)
+    {
+        if (check_bit(pressed, button))
+        {
+            set_bit(&nc->btn, button);
+            if (!handle_button_down(nc, (button_t)button))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+static input_event_t *get_queued_input(core_t *nc, int position)
+{
+    return &nc->input_queue[(nc->input_head + position) % INPUT_QUEUE_SIZE];
+}
+
+static void remove_queued_input(core_t *nc, int position)
+{
+    for (; position < nc->input_count - 1; position += 1)
+    {
+        *get_queued_input(nc, position) = *get_queued_input(nc, position + 1);
+    }
+    nc->input_count -= 1;
+}
+
+static bool is_release_redundant(core_t *nc, int position, button_t button)
+{
+    // True when the next queued event for the button after this position is a release as well.
+    for (position += 1; position < nc->input_count; position += 1)
+    {
+        input_event_t *input = get_queued_input(nc, position);
+        if (input->button == button)
+        {
+            return INPUT_RELEASE == input->action;
+        }
+    }
+
+    return false;
+}
+
+static bool make_room_for_release(core_t *nc, button_t button)
+{
+    // A release already last in line for the button covers this one.
+    for (int position = nc->input_count - 1; position >= 0; position -= 1)
+    {
+        input_event_t *input = get_queued_input(nc, position);
+        if (input->button == button)
+        {
+            if (INPUT_RELEASE == input->action)
+            {
+                SDL_LogWarn(SDL_LOG_CATEGORY_INPUT, "Input queue full, merging release with a queued one");
+                return false;
+            }
+            break;
+        }
+    }
+
+    // Otherwise the oldest press gives way; a lost release would leave a button stuck.
+    for (int position = 0; position < nc->input_count; position += 1)
+    {
+        if (INPUT_PRESS == get_queued_input(nc, position)->action)
+        {
+            SDL_LogWarn(SDL_LOG_CATEGORY_INPUT, "Input queue full, dropping the oldest press for a release");
+            remove_queued_input(nc, position);
+            return true;
+        }
+    }
+
+    // A queue of releases only: there are fewer buttons than slots, so one repeats.
+    for (int position = 0; position < nc->input_count; position += 1)
+    {
+        if (is_release_redundant(nc, position, get_queued_input(nc, position)->button))
+        {
+            SDL_LogWarn(SDL_LOG_CATEGORY_INPUT, "Input queue full, merging repeated releases");
+            remove_queued_input(nc, position);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void queue_input(core_t *nc, button_t button, input_action_t action)
+{
+    if (nc->input_count >= INPUT_QUEUE_SIZE)
+    {
+        if (INPUT_PRESS == action)
+        {
+            SDL_LogWarn(SDL_LOG_CATEGORY_INPUT, "Input queue full, dropping press");
+            return;
+        }
+
+        if (!make_room_for_release(nc, button))
+        {
+            return;
+        }
+    }
+
+    input_event_t *input = &nc->input_queue[(nc->input_head + nc->input_count) % INPUT_QUEUE_SIZE];
+    input->timestamp = nc->event->common.timestamp;
+    input->button = button;
+    input->action = action;
+    nc->input_count += 1;
+}
+
 bool handle_events(core_t *nc)
 {
     switch (nc->event->type)
@@ -284,9 +505,25 @@ bool handle_events(core_t *nc)
             {
                 return false;
             }
+        case SDL_EVENT_WILL_ENTER_BACKGROUND:
+            {
+                // The app may be killed from the background without another event.
+                save_game(nc);
+                return true;
+            }
         case SDL_EVENT_GAMEPAD_ADDED:
             {
                 const SDL_JoystickID which = nc->event->gdevice.which;
+                if (SDL_GetGamepadFromID(which))
+                {
+                    return true; // Already open.
+                }
+                if (nc->gamepad_count >= MAX_GAMEPADS)
+                {
+                    SDL_LogDebug(SDL_LOG_CATEGORY_INPUT, "Joystick #%" SDL_PRIu32 " ignored, %d gamepads in use", which, MAX_GAMEPADS);
+                    return true;
+                }
+
                 SDL_Gamepad *gamepad = SDL_OpenGamepad(which);
                 if (!gamepad)
                 {
@@ -294,6 +531,8 @@ bool handle_events(core_t *nc)
                 }
                 else
                 {
+                    nc->gamepad[nc->gamepad_count] = gamepad;
+                    nc->gamepad_count += 1;
                     SDL_LogDebug(SDL_LOG_CATEGORY_INPUT, "Joystick #%" SDL_PRIu32 " connected: %s", which, SDL_GetGamepadName(gamepad));
                 }
                 return true;
@@ -301,38 +540,23 @@ bool handle_events(core_t *nc)
         case SDL_EVENT_GAMEPAD_REMOVED:
             {
                 const SDL_JoystickID which = nc->event->gdevice.which;
-                SDL_Gamepad *gamepad = SDL_GetGamepadFromID(which);
-                if (gamepad)
+                for (int index = 0; index < nc->gamepad_count; index += 1)
                 {
-                    SDL_CloseGamepad(gamepad); /* the joystick was unplugged. */
+                    if (SDL_GetGamepadID(nc->gamepad[index]) == which)
+                    {
+                        SDL_CloseGamepad(nc->gamepad[index]); /* the joystick was unplugged. */
+                        nc->gamepad_count -= 1;
+                        nc->gamepad[index] = nc->gamepad[nc->gamepad_count];
+                        nc->gamepad[nc->gamepad_count] = NULL;
+                        break;
+                    }
                 }
                 return true;
             }
         case SDL_EVENT_GAMEPAD_AXIS_MOTION:
             {
-                const SDL_JoystickID which = nc->event->gdevice.which;
-                SDL_Gamepad *gamepad = SDL_OpenGamepad(which);
-
-                Sint16 x_axis = SDL_GetGamepadAxis(gamepad, SDL_GAMEPAD_AXIS_LEFTX);
-                Sint16 y_axis = SDL_GetGamepadAxis(gamepad, SDL_GAMEPAD_AXIS_LEFTY);
-
-                const Sint16 threshold = 8000; // Threshold for axis motion to be considered significant.
-
-                if (x_axis <= -threshold)
-                {
-                    set_bit(&nc->btn, BTN_LEFT);
-                    clear_bit(&nc->btn, BTN_RIGHT);
-                }
-                else if (x_axis >= threshold)
-                {
-                    clear_bit(&nc->btn, BTN_LEFT);
-                    set_bit(&nc->btn, BTN_RIGHT);
-                }
-                else
-                {
-                    clear_bit(&nc->btn, BTN_LEFT);
-                    clear_bit(&nc->btn, BTN_RIGHT);
-                }
+                // Sticks are polled once per tick in process_input.
+                break;
             }
         case SDL_EVENT_KEY_DOWN:
             {
@@ -341,29 +565,22 @@ bool handle_events(core_t *nc)
                     break;
                 }
 
-                button_t button = get_button_from_key(nc->event->key.key);
-                set_bit(&nc->btn, button);
-                return handle_button_down(nc, button);
+                queue_input(nc, get_button_from_key(nc->event->key.key), INPUT_PRESS);
+                break;
             }
         case SDL_EVENT_KEY_UP:
             {
-                button_t button = get_button_from_key(nc->event->key.key);
-                clear_bit(&nc->btn, button);
+                queue_input(nc, get_button_from_key(nc->event->key.key), INPUT_RELEASE);
                 break;
             }
         case SDL_EVENT_GAMEPAD_BUTTON_DOWN:
             {
-                const SDL_JoystickID which = nc->event->gbutton.which;
-                button_t button = get_button_from_gamepad(nc->event->gbutton.button);
-                set_bit(&nc->btn, button);
-                return handle_button_down(nc, button);
+                queue_input(nc, get_button_from_gamepad(nc->event->gbutton.button), INPUT_PRESS);
+                break;
             }
         case SDL_EVENT_GAMEPAD_BUTTON_UP:
             {
-                const SDL_JoystickID which = nc->event->gbutton.which;
-                button_t button = get_button_from_gamepad(nc->event->gbutton.button);
-                clear_bit(&nc->btn, button);
-
+                queue_input(nc, get_button_from_gamepad(nc->event->gbutton.button), INPUT_RELEASE);
                 break;
             }
     }
@@ -371,14 +588,161 @@ bool handle_events(core_t *nc)
     return true;
 }
 
+static unsigned int get_stick_buttons(core_t *nc)
+{
+    unsigned int stick_btn = 0;
+
+    for (int index = 0; index < nc->gamepad_count; index += 1)
+    {
+        Sint16 x_axis = SDL_GetGamepadAxis(nc->gamepad[index], SDL_GAMEPAD_AXIS_LEFTX);
+
+        if (x_axis <= -STICK_DEADZONE)
+        {
+            set_bit(&stick_btn, BTN_LEFT);
+        }
+        else if (x_axis >= STICK_DEADZONE)
+        {
+            set_bit(&stick_btn, BTN_RIGHT);
+        }
+    }
+
+    return stick_btn;
+}
+
+static void poll_sticks(core_t *nc)
+{
+    unsigned int stick_btn = get_stick_buttons(nc);
+
+    // Merge edges only, so game code that clears btn keeps working; a
+    // direction released on the stick stays set while a key still holds it.
+    unsigned int engaged = stick_btn & ~nc->stick_btn;
+    unsigned int released = nc->stick_btn & ~stick_btn & ~nc->held_btn;
+
+    nc->btn = (nc->btn | engaged) & ~released;
+    nc->stick_btn = stick_btn;
+}
+
+static bool process_recorded_input(core_t *nc)
+{
+    unsigned int tapped = 0;
+
+    // A trace holds one button level per tick, so queued events only update what is held.
+    while (nc->input_count > 0)
+    {
+        input_event_t input = nc->input_queue[nc->input_head];
+        nc->input_head = (nc->input_head + 1) % INPUT_QUEUE_SIZE;
+        nc->input_count -= 1;
+
+        switch (input.action)
+        {
+            case INPUT_PRESS:
+                if (!nc->input_timestamp || input.timestamp < nc->input_timestamp)
+                {
+                    nc->input_timestamp = input.timestamp;
+                }
+
+                set_bit(&nc->held_btn, input.button);
+                set_bit(&tapped, input.button);
+                break;
+            case INPUT_RELEASE:
+                clear_bit(&nc->held_btn, input.button);
+                break;
+        }
+    }
+
+    nc->stick_btn = get_stick_buttons(nc);
+
+    // A press released within the same tick is kept for this tick and released on the next.
+    // Recording advances the clock before the edges are applied, as replay_input() does.
+    unsigned int pressed = 0;
+    unsigned int released = 0;
+    record_input(nc->held_btn | nc->stick_btn | tapped, &pressed, &released);
+
+    return apply_buttons(nc, pressed, released);
+}
+
+bool process_input(core_t *nc)
+{
+    // Recorded ticks go through the same steps as replayed ones.
+    if (is_recording())
+    {
+        return process_recorded_input(nc);
+    }
+
+    // Runs at the start of a tick, so heavy button actions stay out of the event callback.
+    while (nc->input_count > 0)
+    {
+        input_event_t input = nc->input_queue[nc->input_head];
+        nc->input_head = (nc->input_head + 1) % INPUT_QUEUE_SIZE;
+        nc->input_count -= 1;
+
+        switch (input.action)
+        {
+            case INPUT_PRESS:
+                if (!nc->input_timestamp || input.timestamp < nc->input_timestamp)
+                {
+                    nc->input_timestamp = input.timestamp;
+                }
+
+                set_bit(&nc->btn, input.button);
+                set_bit(&nc->held_btn, input.button);
+                if (!handle_button_down(nc, input.button))
+                {
+                    return false;
+                }
+                break;
+            case INPUT_RELEASE:
+                clear_bit(&nc->held_btn, input.button);
+                if (!check_bit(nc->stick_btn, input.button))
+                {
+                    clear_bit(&nc->btn, input.button);
+                }
+                break;
+        }
+    }
+
+    poll_sticks(nc);
+
+    return true;
+}
+
 void destroy(core_t *nc)
 {
+    if (nc && nc->is_headless)
+    {
+        unload_game(nc);
+        SDL_free(nc);
+        return;
+    }
+
     disable_overclock();
 
+    SDL_AudioDeviceID audio_device = 0;
+
     if (nc)
     {
+        audio_device = nc->audio_device;
+        save_game(nc);
         unload_game(nc);
 
+        for (int index = 0; index < nc->gamepad_count; index += 1)
+        {
+            SDL_CloseGamepad(nc->gamepad[index]);
+            nc->gamepad[index] = NULL;
+        }
+        nc->gamepad_count = 0;
+
+#if defined SOFTWARE_RASTER
+        if (nc->raster_texture)
+        {
+            SDL_DestroyTexture(nc->raster_texture);
+            nc->raster_texture = NULL;
+        }
+
+        destroy_raster(nc->raster);
+        nc->raster = NULL;
+#endif
+
 #ifndef __SYMBIAN32__
         if (nc->backbuffer)
         {
@@ -408,5 +772,5 @@ void destroy(core_t *nc)
         SDL_free(nc);
     }
 
-    destroy_app();
+    destroy_app(audio_device);
 }
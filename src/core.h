@@ -13,9 +13,16 @@
 
 #include <SDL3/SDL.h>
 
+#include "cheats.h"
+#include "config.h"
 #include "kero.h"
 #include "map.h"
 #include "overlay.h"
+#include "raster.h"
+#include "utils.h"
+#include "world.h"
+
+#define INPUT_QUEUE_SIZE 32
 
 typedef enum
 {
@@ -25,11 +32,27 @@ typedef enum
 
 } state_t;
 
+typedef enum input_action
+{
+    INPUT_PRESS = 0,
+    INPUT_RELEASE
+
+} input_action_t;
+
+typedef struct input_event
+{
+    Uint64 timestamp; // SDL event time, in nanoseconds.
+    button_t button;
+    input_action_t action;
+
+} input_event_t;
+
 typedef struct
 {
     SDL_Window *window;
     SDL_Renderer *renderer;
     SDL_Event *event;
+    SDL_AudioDeviceID audio_device;
 
     state_t state;
 
@@ -45,8 +68,13 @@ typedef struct
     int frame_offset_y;
     int screen_offset_x;
     int screen_offset_y;
+#endif
+#if defined SOFTWARE_RASTER
+    raster_t *raster;
+    SDL_Texture *raster_texture;
 #endif
     map_t *map;
+    world_t *world;
     kero_t *kero;
     overlay_t *ui;
 
@@ -56,15 +84,36 @@ typedef struct
     int display_w;
 
     unsigned int btn;
+
+    // Input is queued by the event callback and applied at the start of each tick.
+    input_event_t input_queue[INPUT_QUEUE_SIZE];
+    int input_head;
+    int input_count;
+    Uint64 input_timestamp; // Earliest press not yet shown on screen.
+
+    // Gamepads are opened once when added; sticks are polled once per tick.
+    SDL_Gamepad *gamepad[MAX_GAMEPADS];
+    int gamepad_count;
+    unsigned int held_btn;  // Held through key and gamepad button events.
+    unsigned int stick_btn; // Held through the left stick.
     bool has_updated;
     bool is_paused;
+    bool is_headless; // No window, renderer or audio; the simulation runs on its own.
+
+    cheats_t cheats;
+    int pride_line_index;
 
 } core_t;
 
 bool init(core_t **nc);
+bool init_headless(core_t **nc);
 bool update(core_t *nc);
 bool draw_scene(core_t *nc);
 bool handle_events(core_t *nc);
+bool process_input(core_t *nc);
+bool apply_buttons(core_t *nc, unsigned int pressed, unsigned int released);
+void hash_state(core_t *nc);
+bool is_idle(core_t *nc);
 void destroy(core_t *nc);
 
 bool update_intro(core_t *nc);
@@ -107,9 +107,23 @@
 
 #include <stdint.h> // uint32_t
 
+// Error state is per thread where the compiler has thread-local storage, so maps
+// can be parsed on several threads at once. Elsewhere it is shared and
+// CUTE_TILED_SHARED_ERRORS is set: parse on one thread at a time.
+#if !defined(CUTE_TILED_THREAD_LOCAL)
+	#if defined(_MSC_VER)
+		#define CUTE_TILED_THREAD_LOCAL __declspec(thread)
+	#elif defined(__GNUC__) && !defined(__SYMBIAN32__) && !defined(__DREAMCAST__)
+		#define CUTE_TILED_THREAD_LOCAL __thread
+	#else
+		#define CUTE_TILED_THREAD_LOCAL
+		#define CUTE_TILED_SHARED_ERRORS
+	#endif
+#endif
+
 // Read this in the event of errors
-extern const char* cute_tiled_error_reason;
-extern int cute_tiled_error_line;
+extern CUTE_TILED_THREAD_LOCAL const char* cute_tiled_error_reason;
+extern CUTE_TILED_THREAD_LOCAL int cute_tiled_error_line;
 
 
 typedef struct cute_tiled_map_t cute_tiled_map_t;
@@ -1282,10 +1296,10 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 	#define CUTE_TILED_FCLOSE fclose
 #endif
 
-int cute_tiled_error_cline; 			// The line in cute_tiled.h where the error was triggered.
-const char* cute_tiled_error_reason; 		// The error message.
-int cute_tiled_error_line;  			// The line where the error happened in the json.
-const char* cute_tiled_error_file = NULL; 	// The filepath of the file being parsed. NULL if from memory.
+CUTE_TILED_THREAD_LOCAL int cute_tiled_error_cline; 			// The line in cute_tiled.h where the error was triggered.
+CUTE_TILED_THREAD_LOCAL const char* cute_tiled_error_reason; 		// The error message.
+CUTE_TILED_THREAD_LOCAL int cute_tiled_error_line;  			// The line where the error happened in the json.
+CUTE_TILED_THREAD_LOCAL const char* cute_tiled_error_file = NULL; 	// The filepath of the file being parsed. NULL if from memory.
 
 #ifdef CUTE_TILED_DEFAULT_WARNING
 	#include <stdio.h>
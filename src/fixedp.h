@@ -19,13 +19,17 @@
 
 // Precomputed fixed-point constants (available on all platforms)
 // Use these for frequently used constants in hot loops
-#define GRAVITY_FP           ((fix32_t)(GRAVITY * 65536.0f))
-#define ACCELERATION_FP      ((fix32_t)(ACCELERATION * 65536.0f))
-#define DECELERATION_FP      ((fix32_t)(DECELERATION * 65536.0f))
-#define JUMP_VELOCITY_FP     ((fix32_t)(JUMP_VELOCITY * 65536.0f))
-#define MAX_FALLING_SPEED_FP ((fix32_t)(MAX_FALLING_SPEED * 65536.0f))
-#define MAX_SPEED_FP         ((fix32_t)(MAX_SPEED * 65536.0f))
-#define ACCELERATION_DASH_FP ((fix32_t)(ACCELERATION_DASH * 65536.0f))
+// Rounded to nearest: the small ones lose several percent when truncated.
+#define GRAVITY_FP           ((fix32_t)(GRAVITY * 65536.0f + 0.5f))
+#define ACCELERATION_FP      ((fix32_t)(ACCELERATION * 65536.0f + 0.5f))
+#define DECELERATION_FP      ((fix32_t)(DECELERATION * 65536.0f + 0.5f))
+#define JUMP_VELOCITY_FP     ((fix32_t)(JUMP_VELOCITY * 65536.0f + 0.5f))
+#define MAX_FALLING_SPEED_FP ((fix32_t)(MAX_FALLING_SPEED * 65536.0f + 0.5f))
+#define MAX_SPEED_FP         ((fix32_t)(MAX_SPEED * 65536.0f + 0.5f))
+#define ACCELERATION_DASH_FP ((fix32_t)(ACCELERATION_DASH * 65536.0f + 0.5f))
+
+// 16.16 value times a whole number of milliseconds; exact, no shift needed.
+#define FP_MUL_TICKS(val_fp, ticks) ((fix32_t)((val_fp) * (fix32_t)(ticks)))
 
 #ifdef __SYMBIAN32__
 // On N-Gage, use inline macros to avoid conversion overhead
@@ -10,15 +10,19 @@
 
 #include <SDL3/SDL.h>
 
+#include "audio.h"
 #include "cheats.h"
 #include "config.h"
 #include "core.h"
 #include "game.h"
 #include "kero.h"
 #include "map.h"
+#include "music.h"
 #include "overclock.h"
 #include "overlay.h"
+#include "save.h"
 #include "utils.h"
+#include "world.h"
 
 static const char *pride_lines[PRIDE_LINE_COUNT] = {
     "This frog's pro-  nouns? Rib/bit.   Deal with it.",
@@ -28,14 +32,32 @@ static const char *pride_lines[PRIDE_LINE_COUNT] = {
     "You thought Kero  was just a frog?  Surprise - they'rea queer icon."
 };
 
-bool load_game(core_t *nc)
+bool load_game(core_t *nc, const char *file_name)
 {
     char first_map[11] = { 0 };
     SDL_snprintf(first_map, 11, "%03d.%s", FIRST_LEVEL, MAP_SUFFIX);
-    if (!load_map(first_map, &nc->map, nc->renderer))
+
+    // NULL starts a new game; resuming passes the map of the snapshot.
+    if (!file_name)
+    {
+        file_name = first_map;
+    }
+#if defined WORLD_MODE
+    if (!load_world(WORLD_FILE, &nc->world))
+    {
+        return false;
+    }
+
+    if (!enter_world(nc->world, file_name, &nc->map, nc->renderer))
+    {
+        return false;
+    }
+#else
+    if (!load_map(file_name, &nc->map, nc->renderer))
     {
         return false;
     }
+#endif
 
     if (!load_kero(&nc->kero, nc->map, nc->renderer))
     {
@@ -43,6 +65,22 @@ bool load_game(core_t *nc)
         return false;
     }
 
+    // The mixer and the music stream belong to the audio device; headless instances have none.
+    if (!nc->is_headless)
+    {
+        if (!load_sounds())
+        {
+            SDL_Log("Failed to load sounds");
+            return false;
+        }
+
+        if (!play_music(MUSIC_FILE))
+        {
+            SDL_Log("Failed to start music");
+            return false;
+        }
+    }
+
     if (!load_overlay(nc->map, &nc->ui, nc->renderer))
     {
         SDL_Log("Failed to load overlay");
@@ -62,16 +100,34 @@ bool update_game(core_t *nc)
 {
     update_kero(nc->kero, nc->map, nc->ui, &nc->btn, nc->renderer, nc->is_paused, &nc->has_updated);
 
-    nc->cam_x = (int)nc->kero->pos_x - (SCREEN_W / 2);
-    nc->cam_y = (int)nc->kero->pos_y - (SCREEN_H / 2);
+    nc->cam_x = fix32_to_int(nc->kero->pos_x) - (SCREEN_W / 2);
+    nc->cam_y = fix32_to_int(nc->kero->pos_y) - (SCREEN_H / 2);
 
-    render_map(nc->map, nc->renderer, &nc->has_updated);
+    if (nc->world)
+    {
+        // Camera lives in world space while a world is streamed.
+        nc->cam_x += nc->map->world_x;
+        nc->cam_y += nc->map->world_y;
+
+        map_t *prev_map = nc->map;
+        update_world(nc->world, &nc->map, nc->kero, nc->cam_x, nc->cam_y, nc->renderer);
+        if (nc->map != prev_map)
+        {
+            prepare_dialogue(nc->map, nc->ui, nc->renderer);
+        }
+        render_world(nc->world, nc->renderer, &nc->has_updated);
+    }
+    else
+    {
+        render_map(nc->map, nc->renderer, &nc->has_updated);
+    }
 
-    if ((nc->kero->prev_life_count != nc->kero->life_count) ||
-        (nc->map->prev_coins != nc->map->coins_left) ||
-        (nc->is_paused && nc->ui->menu_selection != nc->ui->prev_selection))
+    // Cheap when nothing changed: only stale HUD widgets are redrawn.
+    render_overlay(nc->map->coins_left, nc->map->coin_max, nc->kero->life_count, nc->is_paused, nc->map, nc->ui, nc->renderer);
+
+    if (nc->is_headless)
     {
-        render_overlay(nc->map->coins_left, nc->map->coin_max, nc->kero->life_count, nc->map, nc->ui, nc->renderer);
+        return true;
     }
 
 #if defined __3DS__
@@ -107,7 +163,7 @@ bool handle_game_button_down(core_t *nc, button_t button)
 {
     if (nc->is_paused)
     {
-        add_to_ring_buffer(button);
+        add_to_ring_buffer(&nc->cheats, button);
 #ifdef __SYMBIAN32__
         int sequence_length = 5;
         static const button_t cheat_sequence[5] = { BTN_5, BTN_4, BTN_2, BTN_8, BTN_7 };
@@ -115,7 +171,7 @@ bool handle_game_button_down(core_t *nc, button_t button)
         int sequence_length = 10;
         static const button_t cheat_sequence[10] = { BTN_UP, BTN_UP, BTN_DOWN, BTN_DOWN, BTN_LEFT, BTN_RIGHT, BTN_LEFT, BTN_RIGHT, BTN_5, BTN_7 };
 #endif
-        if (find_sequence(cheat_sequence, sequence_length))
+        if (find_sequence(&nc->cheats, cheat_sequence, sequence_length))
         {
             nc->kero->wears_mask = true;
             nc->map->use_lgbtq_flag = true;
@@ -123,21 +179,20 @@ bool handle_game_button_down(core_t *nc, button_t button)
             nc->map->keep_dialogue = true;
             nc->is_paused = false;
 
-            static int pride_line_index = 0;
-            render_text(pride_lines[pride_line_index], nc->kero->wears_mask, nc->map, nc->ui, nc->renderer);
-            pride_line_index++;
-            if (pride_line_index > PRIDE_LINE_COUNT - 1)
+            render_text(pride_lines[nc->pride_line_index], nc->kero->wears_mask, nc->map, nc->ui, nc->renderer);
+            nc->pride_line_index++;
+            if (nc->pride_line_index > PRIDE_LINE_COUNT - 1)
             {
-                pride_line_index = 0;
+                nc->pride_line_index = 0;
             }
 
-            clear_ring_buffer();
+            clear_ring_buffer(&nc->cheats);
             return true;
         }
     }
     else
     {
-        clear_ring_buffer();
+        clear_ring_buffer(&nc->cheats);
     }
 
     if ((check_bit(nc->btn, BTN_SOFTRIGHT) || check_bit(nc->btn, BTN_SOFTLEFT)) && !nc->is_paused && !nc->map->show_dialogue)
@@ -145,7 +200,8 @@ bool handle_game_button_down(core_t *nc, button_t button)
         nc->is_paused = true;
         nc->ui->prev_selection = nc->ui->menu_selection;
         nc->ui->menu_selection = MENU_RESUME;
-        clear_ring_buffer();
+        clear_ring_buffer(&nc->cheats);
+        save_game(nc);
     }
     else if (nc->map->show_dialogue)
     {
@@ -179,9 +235,18 @@ bool handle_game_button_down(core_t *nc, button_t button)
                     nc->ui->is_settings_menu = true;
                     break;
                 case MENU_QUIT:
+                    // Unloaded first, so shutdown has nothing left to snapshot.
+                    discard_save(nc);
+                    unload_game(nc);
                     return false;
                 case MENU_MHZ:
                     {
+                        // The CPU clock belongs to the device, not to one instance.
+                        if (nc->is_headless)
+                        {
+                            break;
+                        }
+
                         if (is_overclock_enabled())
                         {
                             disable_overclock();
@@ -245,6 +310,11 @@ bool handle_game_button_down(core_t *nc, button_t button)
 
 void unload_game(core_t *nc)
 {
+    if (!nc->is_headless)
+    {
+        stop_music();
+    }
+
     if (nc->ui)
     {
         destroy_overlay(nc->ui);
@@ -257,6 +327,14 @@ void unload_game(core_t *nc)
         nc->kero = NULL;
     }
 
+    if (nc->world)
+    {
+        // The active map is owned by the world.
+        destroy_world(nc->world);
+        nc->world = NULL;
+        nc->map = NULL;
+    }
+
     if (nc->map)
     {
         destroy_map(nc->map);
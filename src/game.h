@@ -16,7 +16,7 @@
 #include "core.h"
 #include "utils.h"
 
-bool load_game(core_t *nc);
+bool load_game(core_t *nc, const char *file_name);
 bool update_game(core_t *nc);
 bool handle_game_button_down(core_t *nc, button_t button);
 void unload_game(core_t *nc);
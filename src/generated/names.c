@@ -0,0 +1,77 @@
+/** @file names.c
+ *
+ *  A minimalist, cross-platform puzzle-platformer, designed
+ *  especially for the Nokia N-Gage.
+ *
+ *  Copyright (c) 2026, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ *  Generated by tools/namegen from tools/names.txt; do not edit.
+ *
+ **/
+
+#include <SDL3/SDL.h>
+
+#include "names.h"
+#include "utils.h"
+
+#define NAME_SLOTS   11
+#define NAME_BUCKETS 6
+
+static const Uint32 name_displacement[NAME_BUCKETS] = { 0x00000000, 0x00000008, 0x00000001, 0x00000003, 0x00000001, 0x00000006 };
+
+static const char *const name_string[NAME_SLOTS] = {
+    "tilelayer",
+    "objectgroup",
+    "is_deadly",
+    "is_wall",
+    "is_solid",
+    "block",
+    "offset_top",
+    "str",
+    "spawn",
+    "coin",
+    "door",
+};
+
+static const name_id_t name_id[NAME_SLOTS] = {
+    NAME_TILELAYER,
+    NAME_OBJECTGROUP,
+    NAME_IS_DEADLY,
+    NAME_IS_WALL,
+    NAME_IS_SOLID,
+    NAME_BLOCK,
+    NAME_OFFSET_TOP,
+    NAME_STR,
+    NAME_SPAWN,
+    NAME_COIN,
+    NAME_DOOR,
+};
+
+static Uint32 mix_name_hash(Uint64 hash)
+{
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+
+    return (Uint32)(hash >> 32);
+}
+
+name_id_t lookup_name(const char *name)
+{
+    if (!name)
+    {
+        return NAME_UNKNOWN;
+    }
+
+    // One pass over the string, then a single compare rejects unknown names.
+    Uint64 hash = generate_hash((const unsigned char *)name);
+    Uint32 slot = mix_name_hash(hash ^ name_displacement[mix_name_hash(hash) % NAME_BUCKETS]) % NAME_SLOTS;
+
+    if (SDL_strcmp(name_string[slot], name) != 0)
+    {
+        return NAME_UNKNOWN;
+    }
+
+    return name_id[slot];
+}
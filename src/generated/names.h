@@ -0,0 +1,38 @@
+/** @file names.h
+ *
+ *  A minimalist, cross-platform puzzle-platformer, designed
+ *  especially for the Nokia N-Gage.
+ *
+ *  Copyright (c) 2026, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ *  Generated by tools/namegen from tools/names.txt; do not edit.
+ *
+ **/
+
+#ifndef NAMES_H
+#define NAMES_H
+
+#include <SDL3/SDL.h>
+
+typedef enum name_id
+{
+    NAME_UNKNOWN = 0,
+    NAME_BLOCK,
+    NAME_COIN,
+    NAME_DOOR,
+    NAME_IS_DEADLY,
+    NAME_IS_SOLID,
+    NAME_IS_WALL,
+    NAME_OBJECTGROUP,
+    NAME_OFFSET_TOP,
+    NAME_SPAWN,
+    NAME_STR,
+    NAME_TILELAYER,
+    NAME_COUNT
+
+} name_id_t;
+
+name_id_t lookup_name(const char *name);
+
+#endif // NAMES_H
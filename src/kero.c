@@ -11,11 +11,13 @@
 #include "SDL3/SDL.h"
 
 #include "aabb.h"
+#include "audio.h"
 #include "config.h"
 #include "fixedp.h"
 #include "kero.h"
 #include "map.h"
 #include "overlay.h"
+#include "raster.h"
 #include "utils.h"
 
 static const char *death_lines[DEATH_LINE_COUNT] = {
@@ -45,10 +47,16 @@ static const char *death_lines[DEATH_LINE_COUNT] = {
 static void update_kero_timing(kero_t *kero)
 {
     kero->time_b = kero->time_a;
-    kero->time_a = SDL_GetTicks();
+    kero->time_a = get_ticks();
     kero->delta_time = (kero->time_a > kero->time_b)
                            ? kero->time_a - kero->time_b
                            : kero->time_b - kero->time_a;
+
+    // Keeps fixed-point products in range after a stall.
+    if (kero->delta_time > MAX_DELTA_TIME)
+    {
+        kero->delta_time = MAX_DELTA_TIME;
+    }
 }
 
 static void update_kero_animation(kero_t *kero, bool *has_updated)
@@ -77,11 +85,11 @@ static void update_kero_animation(kero_t *kero, bool *has_updated)
 
 static void apply_gravity(kero_t *kero)
 {
-    kero->velocity_y += FP_MUL_INT_CONST(kero->delta_time, GRAVITY_FP);
+    kero->velocity_y += FP_MUL_TICKS(GRAVITY_FP, kero->delta_time);
 
-    if (kero->velocity_y > MAX_FALLING_SPEED)
+    if (kero->velocity_y > MAX_FALLING_SPEED_FP)
     {
-        kero->velocity_y = MAX_FALLING_SPEED;
+        kero->velocity_y = MAX_FALLING_SPEED_FP;
     }
 }
 
@@ -101,14 +109,20 @@ static void handle_jump(kero_t *kero, map_t *map, unsigned int *btn)
 {
     if (check_bit(*btn, BTN_7) && !check_bit(*btn, BTN_5) && !kero->jump_lock)
     {
-        int index = get_tile_index((int)kero->pos_x, (int)kero->pos_y - KERO_SIZE, map);
+        int index = get_tile_index(fix32_to_int(kero->pos_x), fix32_to_int(kero->pos_y) - KERO_SIZE, map);
         index -= map->handle->width;
-        if (index >= 0)
+
+        // Below an open top edge the world continues, so there is always headroom.
+        if (index >= 0 || (map->open_edges & EDGE_TOP))
         {
             if (kero->prev_state != STATE_JUMP && kero->state != STATE_JUMP)
             {
-                kero->velocity_y = -JUMP_VELOCITY;
+                kero->velocity_y = -JUMP_VELOCITY_FP;
                 set_kero_state(kero, STATE_JUMP);
+                if (!kero->is_silent)
+                {
+                    play_sound(SOUND_JUMP, 256);
+                }
             }
             kero->jump_lock = true;
         }
@@ -118,27 +132,29 @@ static void handle_jump(kero_t *kero, map_t *map, unsigned int *btn)
 static void reset_kero_on_out_of_bounds(kero_t *kero, map_t *map)
 {
     set_kero_state(kero, STATE_IDLE);
-    kero->pos_x = (float)map->spawn_x;
-    kero->pos_y = (float)map->spawn_y;
-    kero->velocity_x = 0.f;
-    kero->velocity_y = 0.f;
+    kero->pos_x = fix32_from_int(map->spawn_x);
+    kero->pos_y = fix32_from_int(map->spawn_y);
+    kero->velocity_x = 0;
+    kero->velocity_y = 0;
 }
 
-static bool handle_interaction(kero_t *kero, map_t *map, unsigned int *btn, SDL_Renderer *renderer)
+static bool handle_interaction(kero_t *kero, map_t *map, overlay_t *ui, unsigned int *btn, SDL_Renderer *renderer)
 {
     if (check_bit(*btn, BTN_UP))
     {
         aabb_t kero_bb;
-        kero_bb.top = kero->pos_y - KERO_HALF;
-        kero_bb.bottom = kero->pos_y + KERO_HALF;
-        kero_bb.left = kero->pos_x - KERO_HALF;
-        kero_bb.right = kero->pos_x + KERO_HALF;
+        kero_bb.top = (float)(fix32_to_int(kero->pos_y) - KERO_HALF);
+        kero_bb.bottom = (float)(fix32_to_int(kero->pos_y) + KERO_HALF);
+        kero_bb.left = (float)(fix32_to_int(kero->pos_x) - KERO_HALF);
+        kero_bb.right = (float)(fix32_to_int(kero->pos_x) + KERO_HALF);
 
         int index = -1;
 
         if (object_intersects(kero_bb, map, &index))
         {
-            if (H_DOOR == map->obj[index].hash)
+            // Maps of a world are joined seamlessly, doors only switch levels on their own.
+#ifndef WORLD_MODE
+            if (NAME_DOOR == map->obj[index].name)
             {
                 if (1 == map->obj[index].start_frame) // Door is open.
                 {
@@ -153,17 +169,19 @@ static bool handle_interaction(kero_t *kero, map_t *map, unsigned int *btn, SDL_
                     }
                     else
                     {
-                        kero->pos_x = (float)map->spawn_x;
-                        kero->pos_y = (float)map->spawn_y;
-                        kero->velocity_x = 0.f;
-                        kero->velocity_y = 0.f;
-                        kero->time_a = SDL_GetTicks();
+                        kero->pos_x = fix32_from_int(map->spawn_x);
+                        kero->pos_y = fix32_from_int(map->spawn_y);
+                        kero->velocity_x = 0;
+                        kero->velocity_y = 0;
+                        kero->time_a = get_ticks();
                         kero->time_b = kero->time_a;
                         kero->delta_time = 0;
+                        prepare_dialogue(map, ui, renderer);
                         return true;
                     }
                 }
             }
+#endif
         }
     }
 
@@ -180,41 +198,45 @@ static void handle_intersect(kero_t *kero, map_t *map, overlay_t *ui, SDL_Render
 
     // Build AABB once
     aabb_t kero_bb;
-    kero_bb.top = kero->pos_y - KERO_HALF;
-    kero_bb.bottom = kero->pos_y + KERO_HALF;
-    kero_bb.left = kero->pos_x - KERO_HALF;
-    kero_bb.right = kero->pos_x + KERO_HALF;
+    kero_bb.top = (float)(fix32_to_int(kero->pos_y) - KERO_HALF);
+    kero_bb.bottom = (float)(fix32_to_int(kero->pos_y) + KERO_HALF);
+    kero_bb.left = (float)(fix32_to_int(kero->pos_x) - KERO_HALF);
+    kero_bb.right = (float)(fix32_to_int(kero->pos_x) + KERO_HALF);
 
     int index = -1;
 
     if (object_intersects(kero_bb, map, &index))
     {
-        // Cache hash for faster comparison.
-        register Uint64 obj_hash = map->obj[index].hash;
-
-        if (H_COIN == obj_hash)
+        switch (map->obj[index].name)
         {
-            // Fast path: skip if already hidden.
-            if (!map->obj[index].is_hidden)
-            {
-                map->prev_coins = map->coins_left;
-                map->coins_left -= 1;
-                if (map->coins_left < 0)
+            case NAME_COIN:
+                // Fast path: skip if already hidden.
+                if (!map->obj[index].is_hidden)
                 {
-                    map->coins_left = 0;
+                    map->prev_coins = map->coins_left;
+                    map->coins_left -= 1;
+                    if (!kero->is_silent)
+                    {
+                        play_sound(SOUND_COIN, 256);
+                    }
+                    if (map->coins_left < 0)
+                    {
+                        map->coins_left = 0;
+                    }
+                    map->obj[index].is_hidden = true;
                 }
-                map->obj[index].is_hidden = true;
-            }
-        }
-        else if (H_BLOCK == obj_hash)
-        {
-            // Fast path: skip if dialogue already showing.
-            if (map->obj[index + 1].str && !map->show_dialogue)
-            {
-                map->show_dialogue = true;
-                map->keep_dialogue = false;
-                render_text_ex(map->obj[index + 1].str, true, 640, 146, map, ui, renderer);
-            }
+                break;
+            case NAME_BLOCK:
+                // Fast path: skip if dialogue already showing.
+                if (map->obj[index + 1].str && !map->show_dialogue)
+                {
+                    map->show_dialogue = true;
+                    map->keep_dialogue = false;
+                    render_text_ex(map->obj[index + 1].str, true, BLOCK_PORTRAIT_X, BLOCK_PORTRAIT_Y, map, ui, renderer);
+                }
+                break;
+            default:
+                break;
         }
     }
 }
@@ -246,7 +268,7 @@ static void handle_dash(kero_t *kero, unsigned int *btn)
         {
             kero->current_frame = 0;
             kero->time_since_last_frame = 0;
-            kero->velocity_x = ACCELERATION_DASH;
+            kero->velocity_x = ACCELERATION_DASH_FP;
         }
 
         kero->anim_fps = 15;
@@ -259,6 +281,10 @@ static void handle_dash(kero_t *kero, unsigned int *btn)
 static void handle_death(kero_t *kero)
 {
     set_kero_state(kero, STATE_DEAD);
+    if (!kero->is_silent)
+    {
+        play_sound(SOUND_DEATH, 256);
+    }
 
     kero->anim_fps = 15;
     kero->anim_length = 3;
@@ -278,45 +304,44 @@ static void handle_death(kero_t *kero)
 
 static void clamp_kero_position(kero_t *kero, map_t *map)
 {
-    if (kero->pos_y <= 0.f + KERO_HALF)
-    {
-        kero->pos_y = 0.f + KERO_HALF;
-        kero->velocity_y = 0.f;
-    }
-    if (kero->pos_x <= KERO_HALF)
+    // Open edges lead into a neighbouring world map and are left to the world.
+    if (!(map->open_edges & EDGE_TOP) && kero->pos_y <= fix32_from_int(KERO_HALF))
     {
-        kero->pos_x = KERO_HALF;
+        kero->pos_y = fix32_from_int(KERO_HALF);
+        kero->velocity_y = 0;
     }
-    else if (kero->pos_x >= map->width - KERO_HALF)
+    if (kero->pos_x <= fix32_from_int(KERO_HALF))
     {
-        kero->pos_x = (float)(map->width - KERO_HALF);
-    }
-    else
-    {
-        bool blocked_by_wall;
-        int index = get_tile_index((int)kero->pos_x, (int)kero->pos_y, map);
-
-        if (kero->heading)
+        if (!(map->open_edges & EDGE_LEFT))
         {
-            index += 1;
+            kero->pos_x = fix32_from_int(KERO_HALF);
         }
-        else
+    }
+    else if (kero->pos_x >= fix32_from_int(map->width - KERO_HALF))
+    {
+        if (!(map->open_edges & EDGE_RIGHT))
         {
-            index -= 1;
+            kero->pos_x = fix32_from_int(map->width - KERO_HALF);
         }
+    }
+    else if (kero->pos_y >= 0 && kero->pos_y < fix32_from_int(map->height))
+    {
+        // Look the neighbouring tile up through the world, so walls across a seam still block.
+        int pos_x = fix32_to_int(kero->pos_x);
+        int pos_y = fix32_to_int(kero->pos_y);
+        int wall_x = kero->heading ? pos_x + TILE_SIZE : pos_x - TILE_SIZE;
 
-        blocked_by_wall = map->tile_desc[index].is_wall;
-        if (blocked_by_wall)
+        if (get_tile_desc(wall_x, pos_y, map)->is_wall)
         {
             if (kero->heading)
             {
-                kero->pos_x = (float)(index % map->handle->width) * map->handle->tilewidth - KERO_HALF;
+                kero->pos_x = fix32_from_int(SNAP_TO_TILE(wall_x) - KERO_HALF);
             }
             else
             {
-                kero->pos_x = (float)((index % map->handle->width) + 1) * map->handle->tilewidth + KERO_HALF;
+                kero->pos_x = fix32_from_int(SNAP_TO_TILE(wall_x) + TILE_SIZE + KERO_HALF);
             }
-            kero->velocity_x = 0.f;
+            kero->velocity_x = 0;
         }
     }
 }
@@ -330,6 +355,11 @@ void destroy_kero(kero_t *kero)
             SDL_DestroyTexture(kero->sprite_texture);
             kero->sprite_texture = NULL;
         }
+
+#if defined SOFTWARE_RASTER
+        destroy_raster(kero->sprite_raster);
+        kero->sprite_raster = NULL;
+#endif
     }
 }
 
@@ -342,22 +372,38 @@ bool load_kero(kero_t **kero, map_t *map, SDL_Renderer *renderer)
         return false;
     }
 
-    (*kero)->pos_x = (float)map->spawn_x;
-    (*kero)->pos_y = (float)map->spawn_y;
+    (*kero)->pos_x = fix32_from_int(map->spawn_x);
+    (*kero)->pos_y = fix32_from_int(map->spawn_y);
     (*kero)->anim_fps = 1;
     (*kero)->repeat_anim = true;
     (*kero)->heading = 1;
     (*kero)->level = FIRST_LEVEL;
     (*kero)->life_count = 99;
     (*kero)->line_index = -1;
-    (*kero)->time_a = SDL_GetTicks();
+    (*kero)->time_a = get_ticks();
     (*kero)->time_b = (*kero)->time_a;
 
+    // Headless: physics only, no sprite and no sounds.
+    if (!renderer)
+    {
+        (*kero)->is_silent = true;
+        set_kero_state(*kero, STATE_IDLE);
+        return true;
+    }
+
+#if defined SOFTWARE_RASTER
+    if (!load_raster_from_file("kero.png", &(*kero)->sprite_raster))
+    {
+        SDL_Log("Error loading kero sprite raster");
+        return false;
+    }
+#else
     if (!load_texture_from_file("kero.png", &(*kero)->sprite_texture, renderer))
     {
         SDL_Log("Error loading kero sprite texture");
         return false;
     }
+#endif
 
     set_kero_state(*kero, STATE_IDLE);
 
@@ -402,18 +448,15 @@ void update_kero(kero_t *kero, map_t *map, overlay_t *ui, unsigned int *btn, SDL
     handle_dash(kero, btn);
 
     // Cache frequently accessed map properties for better performance
-    register int map_width = map->handle->width;
     register int map_height = map->height;
-    register int tile_height = map->handle->tileheight;
-    tile_desc_t *tile_desc = map->tile_desc; // Pointer for faster access
+    int pos_x = fix32_to_int(kero->pos_x);
+    int pos_y = fix32_to_int(kero->pos_y);
 
-    int index = get_tile_index((int)kero->pos_x, (int)kero->pos_y, map);
-
-    // Check ground status.
-    bool on_deadly_ground = tile_desc[index].is_deadly;
-    index += map_width;
-    bool on_solid_ground = tile_desc[index].is_solid && kero->state != STATE_JUMP;
-    bool at_bottom = kero->pos_y > map_height - KERO_HALF;
+    // Check ground status; the tile below may belong to a neighbouring world map.
+    bool on_deadly_ground = get_tile_desc(pos_x, pos_y, map)->is_deadly;
+    const tile_desc_t *ground = get_tile_desc(pos_x, pos_y + TILE_SIZE, map);
+    bool on_solid_ground = ground->is_solid && kero->state != STATE_JUMP;
+    bool at_bottom = kero->pos_y > fix32_from_int(map_height - KERO_HALF);
 
     // Vertical movement.
     if (on_deadly_ground)
@@ -429,17 +472,17 @@ void update_kero(kero_t *kero, map_t *map, overlay_t *ui, unsigned int *btn, SDL
     {
         if (STATE_FALL == kero->prev_state || STATE_JUMP == kero->prev_state)
         {
-            kero->velocity_x = 0.f; // Stop horizontal movement when landing.
+            kero->velocity_x = 0; // Stop horizontal movement when landing.
         }
         else if (STATE_DASH == kero->prev_state)
         {
             // Reset dash state when landing.
             set_kero_state(kero, STATE_IDLE);
-            kero->velocity_x = 0.f;
+            kero->velocity_x = 0;
         }
-        kero->velocity_y = 0.f;
+        kero->velocity_y = 0;
 
-        if (handle_interaction(kero, map, btn, renderer))
+        if (handle_interaction(kero, map, ui, btn, renderer))
         {
             return;
         }
@@ -456,19 +499,18 @@ void update_kero(kero_t *kero, map_t *map, overlay_t *ui, unsigned int *btn, SDL
     }
 
     // Update Y position.
-    if (kero->velocity_y != 0.f)
+    if (kero->velocity_y != 0)
     {
-        kero->pos_y += FP_MUL_CONST(kero->velocity_y, (float)kero->delta_time);
+        kero->pos_y += FP_MUL_TICKS(kero->velocity_y, kero->delta_time);
     }
     else
     {
-        // Use cached tile_height instead of map->handle->tileheight
-        kero->pos_y = (float)((int)(kero->pos_y / tile_height) * tile_height);
-        kero->pos_y += tile_desc[index].offset_top;
+        int ground_y = SNAP_TO_TILE(fix32_to_int(kero->pos_y));
+        kero->pos_y = fix32_from_int(ground_y + ground->offset_top);
     }
 
     // Out of bounds check.
-    if (kero->pos_y >= map_height + KERO_HALF)
+    if (kero->pos_y >= fix32_from_int(map_height + KERO_HALF))
     {
         kero->line_index++;
         if (kero->line_index >= DEATH_LINE_COUNT)
@@ -484,8 +526,8 @@ void update_kero(kero_t *kero, map_t *map, overlay_t *ui, unsigned int *btn, SDL
 
     // Horizontal input and state.
     // Cache velocity to avoid multiple memory accesses
-    register float vel_x = kero->velocity_x;
-    register float vel_y = kero->velocity_y;
+    register fix32_t vel_x = kero->velocity_x;
+    register fix32_t vel_y = kero->velocity_y;
 
     if (STATE_DASH != kero->state)
     {
@@ -499,26 +541,26 @@ void update_kero(kero_t *kero, map_t *map, overlay_t *ui, unsigned int *btn, SDL
             kero->heading = 1;
             set_kero_state(kero, STATE_RUN);
         }
-        else if (vel_x <= 0.f)
+        else if (vel_x <= 0)
         {
             set_kero_state(kero, STATE_IDLE);
         }
     }
-    else if (vel_x <= 0.f)
+    else if (vel_x <= 0)
     {
         set_kero_state(kero, STATE_IDLE);
     }
 
     // Horizontal movement.
-    float move = FP_MUL_CONST(vel_x, (float)kero->delta_time);
+    fix32_t move = FP_MUL_TICKS(vel_x, kero->delta_time);
     kero->sprite_offset_y = 0;
     if (kero->heading)
     {
-        kero->pos_x += (vel_x > 0.f) ? move : -move;
+        kero->pos_x += (vel_x > 0) ? move : -move;
     }
     else
     {
-        kero->pos_x += (vel_x > 0.f) ? -move : move;
+        kero->pos_x += (vel_x > 0) ? -move : move;
     }
 
     if (kero->wears_mask)
@@ -534,7 +576,7 @@ void update_kero(kero_t *kero, map_t *map, overlay_t *ui, unsigned int *btn, SDL
 
     // Animation state.
     // Use cached velocity values
-    if (vel_y < 0.f)
+    if (vel_y < 0)
     {
         if (STATE_DASH != kero->state)
         {
@@ -545,7 +587,7 @@ void update_kero(kero_t *kero, map_t *map, overlay_t *ui, unsigned int *btn, SDL
             kero->anim_offset_y = 2;
         }
     }
-    else if (vel_y > 0.f)
+    else if (vel_y > 0)
     {
         if (STATE_DASH != kero->state)
         {
@@ -575,24 +617,24 @@ void update_kero(kero_t *kero, map_t *map, overlay_t *ui, unsigned int *btn, SDL
     // Running state.
     // Check button state only once and cache result.
     bool moving_horizontal = CHECK_BIT_FAST(*btn, BTN_LEFT) || CHECK_BIT_FAST(*btn, BTN_RIGHT);
-    if (STATE_RUN == kero->state || (vel_y != 0.f))
+    if (STATE_RUN == kero->state || (vel_y != 0))
     {
         if (moving_horizontal && STATE_DASH != kero->state)
         {
-            vel_x += FP_MUL_INT_CONST(kero->delta_time, ACCELERATION_FP);
-            if (vel_x > MAX_SPEED)
+            vel_x += FP_MUL_TICKS(ACCELERATION_FP, kero->delta_time);
+            if (vel_x > MAX_SPEED_FP)
             {
-                vel_x = MAX_SPEED;
+                vel_x = MAX_SPEED_FP;
             }
         }
         else
         {
-            if (vel_x > 0.f)
+            if (vel_x > 0)
             {
-                vel_x -= FP_MUL_INT_CONST(kero->delta_time, DECELERATION_FP);
-                if (vel_x < 0.f)
+                vel_x -= FP_MUL_TICKS(DECELERATION_FP, kero->delta_time);
+                if (vel_x < 0)
                 {
-                    vel_x = 0.f;
+                    vel_x = 0;
                 }
             }
         }
@@ -603,6 +645,37 @@ void update_kero(kero_t *kero, map_t *map, overlay_t *ui, unsigned int *btn, SDL
     kero->velocity_y = vel_y;
 }
 
+bool is_kero_at_door(kero_t *kero, map_t *map)
+{
+    // Mirrors the checks update_kero() runs before handle_interaction(), so an up
+    // press in the next update uses the door. Doors open once no coins are left.
+    if (map->coins_left || STATE_DEAD == kero->state || STATE_JUMP == kero->state)
+    {
+        return false;
+    }
+
+    int pos_x = fix32_to_int(kero->pos_x);
+    int pos_y = fix32_to_int(kero->pos_y);
+    if (get_tile_desc(pos_x, pos_y, map)->is_deadly || kero->pos_y > fix32_from_int(map->height - KERO_HALF))
+    {
+        return false;
+    }
+
+    if (!get_tile_desc(pos_x, pos_y + TILE_SIZE, map)->is_solid)
+    {
+        return false;
+    }
+
+    aabb_t kero_bb;
+    kero_bb.top = (float)(pos_y - KERO_HALF);
+    kero_bb.bottom = (float)(pos_y + KERO_HALF);
+    kero_bb.left = (float)(pos_x - KERO_HALF);
+    kero_bb.right = (float)(pos_x + KERO_HALF);
+
+    int index = -1;
+    return object_intersects(kero_bb, map, &index) && NAME_DOOR == map->obj[index].name;
+}
+
 bool render_kero(kero_t *kero, SDL_Renderer *renderer, int cam_x, int cam_y)
 {
     SDL_FRect src;
@@ -612,8 +685,8 @@ bool render_kero(kero_t *kero, SDL_Renderer *renderer, int cam_x, int cam_y)
     src.h = KERO_SIZE;
 
     SDL_FRect dst;
-    dst.x = kero->pos_x - KERO_HALF - (float)cam_x;
-    dst.y = kero->pos_y - KERO_HALF - (float)cam_y;
+    dst.x = fix32_to_float(kero->pos_x) - KERO_HALF - (float)cam_x;
+    dst.y = fix32_to_float(kero->pos_y) - KERO_HALF - (float)cam_y;
     dst.w = KERO_SIZE;
     dst.h = KERO_SIZE;
 
@@ -627,3 +700,15 @@ bool render_kero(kero_t *kero, SDL_Renderer *renderer, int cam_x, int cam_y)
 
     return true;
 }
+
+#if defined SOFTWARE_RASTER
+void draw_kero(kero_t *kero, raster_t *frame, int cam_x, int cam_y)
+{
+    int src_x = (kero->current_frame + kero->anim_offset_x + kero->sprite_offset_x) * KERO_SIZE;
+    int src_y = (kero->anim_offset_y + kero->sprite_offset_y) * KERO_SIZE;
+    int dst_x = fix32_to_int(kero->pos_x) - KERO_HALF - cam_x;
+    int dst_y = fix32_to_int(kero->pos_y) - KERO_HALF - cam_y;
+
+    blit_raster(frame, kero->sprite_raster, src_x, src_y, KERO_SIZE, KERO_SIZE, dst_x, dst_y, !kero->heading);
+}
+#endif
@@ -13,6 +13,7 @@
 
 #include <SDL3/SDL.h>
 
+#include "fix32.h"
 #include "map.h"
 #include "overlay.h"
 
@@ -35,10 +36,11 @@ typedef enum kero_state
 typedef struct kero
 {
     // Hot variables (accessed every frame); keep together for cache locality.
-    float pos_x;      // 4 bytes; most frequently accessed.
-    float pos_y;      // 4 bytes
-    float velocity_x; // 4 bytes
-    float velocity_y; // 4 bytes
+    // 16.16 fixed point, so every platform steps bit-identically.
+    fix32_t pos_x;      // 4 bytes; most frequently accessed.
+    fix32_t pos_y;      // 4 bytes
+    fix32_t velocity_x; // 4 bytes
+    fix32_t velocity_y; // 4 bytes
 
     Uint64 delta_time; // 8 bytes; used in calculations.
 
@@ -75,9 +77,13 @@ typedef struct kero
     bool jump_lock;    // 1 byte
     bool wears_mask;   // 1 byte
     bool respawn_lock; // 1 byte
+    bool is_silent;    // 1 byte; headless instances play no sounds.
 
     // Pointers at end (accessed less frequently for setup/teardown).
     SDL_Texture *sprite_texture; // kero.png as GPU texture
+#if defined SOFTWARE_RASTER
+    raster_t *sprite_raster; // kero.png as CPU raster
+#endif
 
 } kero_t
 #ifdef __SYMBIAN32__
@@ -88,6 +94,10 @@ typedef struct kero
 void destroy_kero(kero_t *kero);
 bool load_kero(kero_t **kero, map_t *map, SDL_Renderer *renderer);
 void update_kero(kero_t *kero, map_t *map, overlay_t *ui, unsigned int *btn, SDL_Renderer *renderer, bool is_paused, bool *has_updated);
+bool is_kero_at_door(kero_t *kero, map_t *map);
 bool render_kero(kero_t *kero, SDL_Renderer *renderer, int cam_x, int cam_y);
+#if defined SOFTWARE_RASTER
+void draw_kero(kero_t *kero, raster_t *frame, int cam_x, int cam_y);
+#endif
 
 #endif // KERO_H
@@ -13,18 +13,247 @@
 #include <SDL3/SDL.h>
 #include <SDL3/SDL_main.h>
 
+#include "config.h"
 #include "core.h"
+#include "pacer.h"
+#include "save.h"
+#include "trace.h"
 
-core_t *core = NULL;
+#if defined BENCHMARK
+#include "actor.h"
+#include "audio.h"
+#include "batch.h"
+#include "map.h"
+#include "music.h"
+#include "pfs.h"
+#include "raster.h"
+#include "solver.h"
+#include "utils.h"
+#endif
 
 // This function runs once at startup.
 SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
 {
-    if (!init(&core))
+    const char *record_file = NULL;
+    const char *replay_file = NULL;
+    const char *expect_hash = NULL;
+    int target_fps = TARGET_FPS;
+#if defined BENCHMARK
+    const char *music_file = NULL;
+    const char *solve_file = NULL;
+    const char *batch_file = NULL;
+    const char *json_file = LEVEL_BENCH_FILE;
+    int actor_count = 0;
+    int voice_count = 0;
+    int resume_runs = 0;
+    int archive_runs = 0;
+    int level_runs = 0;
+    int image_runs = 0;
+    int raster_runs = 0;
+    int instance_count = BATCH_INSTANCES;
+#endif
+
+    for (int index = 1; index < argc; index += 1)
+    {
+        // Every option takes a value, so one given last has nothing to read.
+        if (index + 1 >= argc)
+        {
+            SDL_Log("Ignoring option without a value: %s", argv[index]);
+            break;
+        }
+
+        if (SDL_strcmp(argv[index], "--record") == 0)
+        {
+            record_file = argv[++index];
+        }
+        else if (SDL_strcmp(argv[index], "--replay") == 0)
+        {
+            replay_file = argv[++index];
+        }
+        else if (SDL_strcmp(argv[index], "--expect") == 0)
+        {
+            expect_hash = argv[++index];
+        }
+        else if (SDL_strcmp(argv[index], "--fps") == 0)
+        {
+            // 0 runs unpaced, as before the pacer existed.
+            target_fps = SDL_atoi(argv[++index]);
+        }
+#if defined BENCHMARK
+        // Benchmarks are only built in with -DBENCHMARK=ON.
+        else if (SDL_strcmp(argv[index], "--actors") == 0)
+        {
+            actor_count = SDL_atoi(argv[++index]);
+        }
+        else if (SDL_strcmp(argv[index], "--voices") == 0)
+        {
+            voice_count = SDL_atoi(argv[++index]);
+        }
+        else if (SDL_strcmp(argv[index], "--music") == 0)
+        {
+            music_file = argv[++index];
+        }
+        else if (SDL_strcmp(argv[index], "--resume") == 0)
+        {
+            resume_runs = SDL_atoi(argv[++index]);
+        }
+        else if (SDL_strcmp(argv[index], "--archive") == 0)
+        {
+            archive_runs = SDL_atoi(argv[++index]);
+        }
+        else if (SDL_strcmp(argv[index], "--levels") == 0)
+        {
+            level_runs = SDL_atoi(argv[++index]);
+        }
+        else if (SDL_strcmp(argv[index], "--images") == 0)
+        {
+            image_runs = SDL_atoi(argv[++index]);
+        }
+        else if (SDL_strcmp(argv[index], "--raster") == 0)
+        {
+            raster_runs = SDL_atoi(argv[++index]);
+        }
+        else if (SDL_strcmp(argv[index], "--solve") == 0)
+        {
+            solve_file = argv[++index];
+        }
+        else if (SDL_strcmp(argv[index], "--batch") == 0)
+        {
+            batch_file = argv[++index];
+        }
+        else if (SDL_strcmp(argv[index], "--instances") == 0)
+        {
+            instance_count = SDL_atoi(argv[++index]);
+        }
+        else if (SDL_strcmp(argv[index], "--json") == 0)
+        {
+            json_file = argv[++index];
+        }
+#endif
+        else
+        {
+            SDL_Log("Ignoring unrecognised option: %s", argv[index]);
+        }
+    }
+
+    bool is_headless = replay_file != NULL;
+
+#if defined BENCHMARK
+    if (level_runs > 0 || image_runs > 0)
+    {
+        // Before SDL allocates anything further, so load peaks are counted in full.
+        track_memory();
+    }
+
+    if (actor_count > 0 || voice_count > 0 || music_file || resume_runs > 0 || archive_runs > 0 || level_runs > 0 || image_runs > 0 || raster_runs > 0 || solve_file || batch_file)
+    {
+        is_headless = true;
+    }
+#endif
+
+    if (is_headless)
+    {
+        // Benchmarks run headless: no window system, no GPU, no vsync.
+        SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
+        SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
+        SDL_SetHint(SDL_HINT_AUDIO_DRIVER, "dummy");
+        SDL_SetHintWithPriority(SDL_HINT_RENDER_VSYNC, "0", SDL_HINT_OVERRIDE);
+    }
+
+    if (replay_file)
+    {
+        if (!start_replay(replay_file))
+        {
+            return SDL_APP_FAILURE;
+        }
+
+        if (expect_hash)
+        {
+            expect_state_hash((Uint32)SDL_strtoul(expect_hash, NULL, 16));
+        }
+    }
+    else if (record_file)
+    {
+        start_recording(record_file);
+    }
+
+    // SDL hands the core back to every callback; the app keeps no engine state of its own.
+    if (!init((core_t **)appstate))
     {
         SDL_Log("Failed to initialize core.");
         return SDL_APP_FAILURE;
     }
+    core_t *core = (core_t *)*appstate;
+
+    init_pacer(target_fps, IDLE_FPS);
+
+#if defined BENCHMARK
+    if (actor_count > 0)
+    {
+        // Scaling run for the actor passes; exits once the table is printed.
+        return benchmark_actors(actor_count) ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+    }
+
+    if (voice_count > 0)
+    {
+        // Mixer cost per voice count; the device stops pulling while it runs.
+        return benchmark_mixer(voice_count) ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+    }
+
+    if (music_file)
+    {
+        // Streams the packed track through the decoder without playing it.
+        return benchmark_music(music_file) ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+    }
+
+    if (resume_runs > 0)
+    {
+        // Fresh game versus snapshot resume, up to the first drawn frame.
+        return benchmark_resume(core, resume_runs) ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+    }
+
+    if (archive_runs > 0)
+    {
+        // Load and decode time of every packed entry with the codec it was packed with.
+        return benchmark_archive(archive_runs) ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+    }
+
+    if (level_runs > 0)
+    {
+        // Every shipped map, cold and warm, phase by phase; results go to a JSON file.
+        return benchmark_maps(core->renderer, level_runs, json_file) ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+    }
+
+    if (image_runs > 0)
+    {
+        // Decode and upload of every shipped image, with the memory peak of each load.
+        return benchmark_images(core->renderer, image_runs) ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+    }
+
+    if (raster_runs > 0)
+    {
+        // The same clipped, partly mirrored frame through the rasterizer and the renderer.
+        return benchmark_raster(core->renderer, raster_runs) ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+    }
+
+    if (solve_file)
+    {
+        // Plays every level from the intro through the real physics and records the route.
+        return solve_levels(core, solve_file) ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+    }
+
+    if (batch_file)
+    {
+        // Replays the trace in many headless instances at once, on one to all cores.
+        return run_batch(batch_file, instance_count) ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+    }
+#endif
+
+    // Traces must start from the intro, so neither recording nor replay resumes.
+    if (!replay_file && !record_file && !resume_game(core))
+    {
+        return SDL_APP_FAILURE;
+    }
 
     return SDL_APP_CONTINUE;
 }
@@ -32,10 +261,16 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
 // This function runs when a new event (Keypresses, etc) occurs.
 SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event)
 {
+    core_t *core = (core_t *)appstate;
+
     if (!core || !event)
     {
         return SDL_APP_CONTINUE;
     }
+    else if (is_replaying() && event->type != SDL_EVENT_QUIT)
+    {
+        return SDL_APP_CONTINUE;
+    }
     else
     {
         core->event = event;
@@ -52,6 +287,32 @@ SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event)
 // This function runs once per frame, and is the heart of the program.
 SDL_AppResult SDL_AppIterate(void *appstate)
 {
+    core_t *core = (core_t *)appstate;
+    Uint64 frame_start = SDL_GetTicksNS();
+
+    if (is_replaying())
+    {
+        unsigned int pressed = 0;
+        unsigned int released = 0;
+        if (!replay_input(&pressed, &released))
+        {
+            return report_replay() ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+        }
+
+        if (!apply_buttons(core, pressed, released))
+        {
+            return SDL_APP_SUCCESS;
+        }
+    }
+    else
+    {
+        // A recording stores the tick's input in process_input, before it is applied.
+        if (!process_input(core))
+        {
+            return SDL_APP_SUCCESS;
+        }
+    }
+
     if (!update(core))
     {
         return SDL_APP_SUCCESS;
@@ -62,15 +323,26 @@ SDL_AppResult SDL_AppIterate(void *appstate)
         return SDL_APP_SUCCESS;
     }
 
-#if !defined __SYMBIAN32__
-    SDL_Delay(1);
-#endif
+    if (is_replaying())
+    {
+        add_frame_time(SDL_GetTicksNS() - frame_start);
+        hash_state(core);
+        return SDL_APP_CONTINUE;
+    }
+
+    pace_frame(frame_start, is_idle(core));
     return SDL_APP_CONTINUE;
 }
 
 // This function runs once at shutdown.
 void SDL_AppQuit(void *appstate, SDL_AppResult result)
 {
+    core_t *core = (core_t *)appstate;
+
+    stop_recording();
+    stop_replay();
+    report_pacer();
+    report_input_latency();
     destroy(core);
     //  SDL will clean up the window/renderer for us.
 }
@@ -14,11 +14,9 @@
 #include "aabb.h"
 #include "map.h"
 #include "pfs.h"
+#include "raster.h"
 #include "utils.h"
-
-#if !defined __EMSCRIPTEN__
-#include "zlib.h"
-#endif
+#include "world.h"
 
 #if defined __SYMBIAN32__
 #define CUTE_TILED_SNPRINTF(ARGS...) (void)(ARGS)
@@ -27,108 +25,64 @@
 #define STRPOOL_EMBEDDED_STRNICMP    strncasecmp
 #endif
 
+// Parser allocations go through SDL, where the level benchmark can count them.
+#define CUTE_TILED_ALLOC(size, ctx) SDL_malloc(size)
+#define CUTE_TILED_FREE(mem, ctx)   SDL_free(mem)
+
 #define CUTE_TILED_IMPLEMENTATION
 #include "cute_tiled.h"
 
 #include "config.h"
 
-#define H_GRAVITY 0x0000d0b30d77f26b
+#if defined BENCHMARK
+static const char *phase_name[MAP_PHASE_COUNT] = {
+    "load_tiled_map",
+    "load_tiles",
+    "load_objects",
+    "load_animations",
+    "create_textures",
+    "load_tileset"
+};
+#endif
 
-#define H_IS_DEADLY   0x0377cc445c348313
-#define H_IS_SOLID    0x001ae728dd16b21b
-#define H_IS_WALL     0x0000d0b3a99dccd0
-#define H_OBJECTGROUP 0xc0b9d518970be349
-#define H_OFFSET_TOP  0x727241bd0a7e257e
-#define H_SPAWN       0x00000031105f18ee
-#define H_STR         0x000000000b88ab7e
-#define H_TILELAYER   0x0377d9f70e844fb0
+#if defined CUTE_TILED_SHARED_ERRORS
+static SDL_InitState tiled_init;
+static SDL_Mutex *tiled_mutex;
 
-static void destroy_tiled_map(map_t *map)
+static void lock_tiled(void)
 {
-    map->hash_id_objectgroup = 0;
-    map->hash_id_tilelayer = 0;
-
-    if (map->handle)
+    if (SDL_ShouldInit(&tiled_init))
     {
-        cute_tiled_free_map(map->handle);
+        tiled_mutex = SDL_CreateMutex();
+        SDL_SetInitialized(&tiled_init, true);
     }
-    map->handle = NULL;
+    SDL_LockMutex(tiled_mutex);
 }
 
-#if !defined __EMSCRIPTEN__
-static bool decompress_gz_buffer(Uint8 *compressed_data, size_t compressed_size, Uint8 **out_decompressed_data, uLongf *out_decompressed_size)
+static void unlock_tiled(void)
 {
-#if defined(__SYMBIAN32__)
-    // Smaller chunk size to reduce memory fragmentation on constrained hardware.
-    const size_t CHUNK_SIZE = 8192;
-#else
-    const size_t CHUNK_SIZE = 16384;
+    SDL_UnlockMutex(tiled_mutex);
+}
 #endif
 
-    // Pre-allocate based on estimated size to reduce realloc calls.
-    // Assume 3x compression ratio (typical for tiled maps).
-    size_t estimated_size = compressed_size * 3;
-
-    Uint8 *output = NULL;
-    size_t output_capacity = 0;
-    size_t output_size = 0;
-
-    z_stream strm = { 0 };
-    strm.next_in = compressed_data;
-    strm.avail_in = (uInt)compressed_size;
+static Uint64 end_phase(map_t *map, map_phase_t phase, Uint64 start)
+{
+    Uint64 now = SDL_GetTicksNS();
+    map->phase_ns[phase] = now - start;
+    return now;
+}
 
-    if (inflateInit2(&strm, 16 + MAX_WBITS) != Z_OK)
-    {
-        SDL_Log("inflateInit2 failed");
-        return false;
-    }
+static void destroy_tiled_map(map_t *map)
+{
+    map->hash_id_objectgroup = 0;
+    map->hash_id_tilelayer = 0;
 
-    output = (Uint8 *)SDL_malloc(estimated_size);
-    if (output)
+    if (map->handle)
     {
-        output_capacity = estimated_size;
+        cute_tiled_free_map(map->handle);
     }
-
-    int ret;
-    do
-    {
-        if (output_size + CHUNK_SIZE > output_capacity)
-        {
-            output_capacity += CHUNK_SIZE;
-            Uint8 *new_output = (Uint8 *)SDL_realloc(output, output_capacity);
-            if (!new_output)
-            {
-                SDL_Log("Failed to allocate memory during decompression");
-                SDL_free(output);
-                inflateEnd(&strm);
-                return false;
-            }
-            output = new_output;
-        }
-
-        strm.next_out = output + output_size;
-        strm.avail_out = (uInt)CHUNK_SIZE;
-
-        ret = inflate(&strm, Z_NO_FLUSH);
-        if (ret != Z_OK && ret != Z_STREAM_END)
-        {
-            SDL_Log("inflate failed with code: %d", ret);
-            SDL_free(output);
-            inflateEnd(&strm);
-            return false;
-        }
-
-        output_size += (CHUNK_SIZE - strm.avail_out);
-    } while (ret != Z_STREAM_END);
-
-    inflateEnd(&strm);
-
-    *out_decompressed_data = output;
-    *out_decompressed_size = (uLongf)output_size;
-
-    return true;
+    map->handle = NULL;
 }
-#endif
 
 static bool load_tiled_map(const char *file_name, map_t *map)
 {
@@ -146,35 +100,68 @@ static bool load_tiled_map(const char *file_name, map_t *map)
         return false;
     }
 
-    int buffer_size = 0;
+    int buffer_size = size_of_file(file_name);
 #if !defined __EMSCRIPTEN__
-    Uint8 *decompressed_data = NULL;
-    uLongf decompressed_size = 0;
-
-    if (decompress_gz_buffer(buffer, size_of_file(file_name), &decompressed_data, &decompressed_size))
+    // The packer may store a map as plain JSON under an archive codec instead of gzip.
+    if (buffer_size >= 18 && 0x1f == buffer[0] && 0x8b == buffer[1])
     {
-        SDL_Log("Decompressed to %lu bytes", decompressed_size);
-        SDL_free(buffer); // free original .gz buffer
-        buffer = decompressed_data;
-        buffer_size = decompressed_size;
-    }
-    else
-    {
-        SDL_Log("Decompression failed");
+        // The gzip trailer holds the unpacked size, so the output is allocated once.
+        const Uint8 *trailer = buffer + buffer_size - 4;
+        size_t size_hint = (size_t)trailer[0] | ((size_t)trailer[1] << 8) | ((size_t)trailer[2] << 16) | ((size_t)trailer[3] << 24);
+        size_t decompressed_size = 0;
+        Uint8 *decompressed_data = inflate_buffer(buffer, buffer_size, size_hint, &decompressed_size, PFS_WRAP_GZIP);
+
+        if (decompressed_data)
+        {
+            SDL_Log("Decompressed to %zu bytes", decompressed_size);
+            SDL_free(buffer); // free original .gz buffer
+            buffer = decompressed_data;
+            buffer_size = (int)decompressed_size;
+        }
+        else
+        {
+            SDL_Log("Decompression failed");
+        }
     }
-#else
-    buffer_size = size_of_file(file_name);
 #endif
 
+    // cute_tiled keeps its error state per thread, so parallel instances parse at the same
+    // time; only where that state is shared do they take turns.
+#if defined CUTE_TILED_SHARED_ERRORS
+    lock_tiled();
+#endif
     map->handle = cute_tiled_load_map_from_memory((const void *)buffer, buffer_size, NULL);
     if (!map->handle)
     {
-        SDL_free(buffer);
         SDL_Log("%s", cute_tiled_error_reason);
-        return false;
     }
+#if defined CUTE_TILED_SHARED_ERRORS
+    unlock_tiled();
+#endif
     SDL_free(buffer);
 
+    if (!map->handle)
+    {
+        return false;
+    }
+
+    // Tile math is specialised for TILE_SIZE at compile time and has no runtime fallback:
+    // a map built for another size is refused and needs a build with its TILE_SIZE.
+    cute_tiled_tileset_t *tileset = map->handle->tilesets;
+    if (!tileset || TILE_SIZE != map->handle->tilewidth || TILE_SIZE != map->handle->tileheight ||
+        TILE_SIZE != tileset->tilewidth || TILE_SIZE != tileset->tileheight || TILESET_COLUMNS != tileset->columns)
+    {
+        SDL_Log("%s: tiles must be %dx%d px in %d tileset columns", file_name, TILE_SIZE, TILE_SIZE, TILESET_COLUMNS);
+        destroy_tiled_map(map);
+        return false;
+    }
+
+    map->height = TILE_TO_POS(map->handle->height);
+    map->width = TILE_TO_POS(map->handle->width);
+
+    // Cache frequently accessed map dimensions to reduce pointer dereferences
+    map->cached_map_width = map->handle->width;
+
     Uint32 argb_color = map->handle->backgroundcolor;
     map->bg_r = (argb_color >> 16) & 0xFF;
     map->bg_g = (argb_color >> 8) & 0xFF;
@@ -183,7 +170,8 @@ static bool load_tiled_map(const char *file_name, map_t *map)
     cute_tiled_layer_t *layer = map->handle->layers;
     while (layer)
     {
-        if (H_TILELAYER == generate_hash((const unsigned char *)layer->type.ptr))
+        name_id_t type = lookup_name(layer->type.ptr);
+        if (NAME_TILELAYER == type)
         {
             if (!map->hash_id_tilelayer)
             {
@@ -192,7 +180,7 @@ static bool load_tiled_map(const char *file_name, map_t *map)
             }
             map->layer_count += 1;
         }
-        else if (H_OBJECTGROUP == generate_hash((const unsigned char *)layer->type.ptr))
+        else if (NAME_OBJECTGROUP == type)
         {
             if (!map->hash_id_objectgroup)
             {
@@ -210,7 +198,10 @@ static void destroy_textures(map_t *map)
 {
     if (map->tileset_texture)
     {
-        SDL_DestroyTexture(map->tileset_texture);
+        if (!map->shared_tileset)
+        {
+            SDL_DestroyTexture(map->tileset_texture);
+        }
         map->tileset_texture = NULL;
     }
 
@@ -219,6 +210,18 @@ static void destroy_textures(map_t *map)
         SDL_DestroyTexture(map->render_target);
         map->render_target = NULL;
     }
+
+#if defined SOFTWARE_RASTER
+    if (!map->shared_tileset)
+    {
+        destroy_raster(map->tileset_raster);
+    }
+    map->tileset_raster = NULL;
+    destroy_raster(map->raster);
+    map->raster = NULL;
+#endif
+
+    map->shared_tileset = false;
 }
 
 static bool create_textures(SDL_Renderer *renderer, map_t *map)
@@ -229,20 +232,19 @@ static bool create_textures(SDL_Renderer *renderer, map_t *map)
         return false;
     }
 
+#if defined SOFTWARE_RASTER
+    // Tiles are composed on the CPU, no render target needed.
+    destroy_raster(map->raster);
+    map->raster = NULL;
+
+    return create_raster(map->width, map->height, &map->raster);
+#else
     if (map->render_target)
     {
         SDL_DestroyTexture(map->render_target);
         map->render_target = NULL;
     }
 
-    map->height = map->handle->height * map->handle->tilesets->tileheight;
-    map->width = map->handle->width * map->handle->tilesets->tilewidth;
-
-    // Cache frequently accessed tileset dimensions to reduce pointer dereferences
-    map->cached_tilewidth = map->handle->tilesets->tilewidth;
-    map->cached_tileheight = map->handle->tilesets->tileheight;
-    map->cached_map_width = map->handle->width;
-
 #ifndef __DREAMCAST__
     SDL_PixelFormat pixel_format = SDL_PIXELFORMAT_XRGB4444;
 #else
@@ -262,6 +264,7 @@ static bool create_textures(SDL_Renderer *renderer, map_t *map)
     }
 
     return true;
+#endif
 }
 
 static inline int get_local_id(int gid, cute_tiled_map_t *map)
@@ -270,13 +273,11 @@ static inline int get_local_id(int gid, cute_tiled_map_t *map)
     return local_id >= 0 ? local_id : 0;
 }
 
-// Tileset is 512x512 with 16x16 tiles (32 columns): use bit ops instead of division/modulo.
-static inline void get_tile_position(int gid, int *pos_x, int *pos_y, cute_tiled_map_t *map)
+// TILESET_COLUMNS is a power of two, so unsigned modulo and division compile to a mask and a shift.
+static inline void get_tile_position(int local_id, int *pos_x, int *pos_y)
 {
-    register int local_id = get_local_id(gid, map);
-
-    *pos_x = (local_id & 31) << 4; // % 32 * 16
-    *pos_y = (local_id >> 5) << 4; // / 32 * 16
+    *pos_x = TILE_TO_POS((int)((Uint32)local_id % TILESET_COLUMNS));
+    *pos_y = TILE_TO_POS((int)((Uint32)local_id / TILESET_COLUMNS));
 }
 
 static inline void get_frame_position(int frame_index, int width, int height, int *pos_x, int *pos_y, int column_count)
@@ -291,33 +292,17 @@ static inline bool is_gid_valid(int gid, cute_tiled_map_t *map)
     return (gid != 0);
 }
 
-static bool set_object_animation(int gid, int *anim_length, int *id, cute_tiled_map_t *map)
+static int find_animation(int local_id, map_t *map)
 {
-    int local_id = get_local_id(gid, map);
-    cute_tiled_tileset_t *tileset = map->tilesets;
-    cute_tiled_tile_descriptor_t *tile = tileset->tiles;
-
-    while (tile)
+    for (int index = 0; index < map->anim_count; index += 1)
     {
-        if (tile->tile_index == local_id)
+        if (map->anim[index].tile_id == local_id)
         {
-            if (tile->animation)
-            {
-                if (anim_length)
-                {
-                    *anim_length = tile->frame_count;
-                }
-                if (id)
-                {
-                    *id = tile->animation->tileid;
-                }
-                return true;
-            }
+            return index;
         }
-        tile = tile->next;
     }
 
-    return false;
+    return -1;
 }
 
 static inline int remove_gid_flip_bits(int gid)
@@ -325,12 +310,8 @@ static inline int remove_gid_flip_bits(int gid)
     return cute_tiled_unset_flags(gid);
 }
 
-static bool tile_has_properties(int gid, cute_tiled_tile_descriptor_t **tile, cute_tiled_map_t *map)
+static bool tile_has_properties(int local_id, cute_tiled_tile_descriptor_t **tile)
 {
-    int local_id;
-
-    local_id = gid - map->tilesets->firstgid;
-
     while ((*tile))
     {
         if ((*tile)->tile_index == local_id)
@@ -377,24 +358,7 @@ cute_tiled_object_t *get_head_object(cute_tiled_layer_t *layer, map_t *map)
     return NULL;
 }
 
-static int get_next_object_id(int gid, int current_frame, cute_tiled_map_t *map)
-{
-    cute_tiled_tileset_t *tileset = map->tilesets;
-    cute_tiled_tile_descriptor_t *tile = tileset->tiles;
-
-    while (tile)
-    {
-        if (tile->tile_index == gid)
-        {
-            return tile->animation[current_frame].tileid;
-        }
-        tile = tile->next;
-    }
-
-    return 0;
-}
-
-static void load_property(const Uint64 name_hash, cute_tiled_property_t *properties, int property_count, map_t *map)
+static void load_property(const name_id_t name, cute_tiled_property_t *properties, int property_count, map_t *map)
 {
     // Early exit for empty properties or null pointer
     if (property_count == 0 || !properties)
@@ -405,14 +369,9 @@ static void load_property(const Uint64 name_hash, cute_tiled_property_t *propert
     // Linear search
     for (register int index = 0; index < property_count; index += 1)
     {
-        if (name_hash == generate_hash((const unsigned char *)properties[index].name.ptr))
+        // Unknown and null names map to NAME_UNKNOWN and never match.
+        if (name == lookup_name(properties[index].name.ptr))
         {
-            // Skip null property names
-            if (!properties[index].name.ptr)
-            {
-                return;
-            }
-
             // Handle property based on type
             switch (properties[index].type)
             {
@@ -436,7 +395,7 @@ static void load_property(const Uint64 name_hash, cute_tiled_property_t *propert
     }
 }
 
-static bool get_boolean_property(const Uint64 name_hash, cute_tiled_property_t *properties, int property_count, map_t *map)
+static bool get_boolean_property(const name_id_t name, cute_tiled_property_t *properties, int property_count, map_t *map)
 {
     // Early exit optimization for empty properties
     if (property_count == 0 || !properties)
@@ -445,11 +404,11 @@ static bool get_boolean_property(const Uint64 name_hash, cute_tiled_property_t *
     }
 
     map->boolean_property = false;
-    load_property(name_hash, properties, property_count, map);
+    load_property(name, properties, property_count, map);
     return map->boolean_property;
 }
 
-static float get_decimal_property(const Uint64 name_hash, cute_tiled_property_t *properties, int property_count, map_t *map)
+static float get_decimal_property(const name_id_t name, cute_tiled_property_t *properties, int property_count, map_t *map)
 {
     // Early exit optimization for empty properties
     if (property_count == 0 || !properties)
@@ -458,11 +417,11 @@ static float get_decimal_property(const Uint64 name_hash, cute_tiled_property_t
     }
 
     map->decimal_property = 0.0;
-    load_property(name_hash, properties, property_count, map);
+    load_property(name, properties, property_count, map);
     return map->decimal_property;
 }
 
-static int get_integer_property(const Uint64 name_hash, cute_tiled_property_t *properties, int property_count, map_t *map)
+static int get_integer_property(const name_id_t name, cute_tiled_property_t *properties, int property_count, map_t *map)
 {
     // Early exit optimization for empty properties
     if (property_count == 0 || !properties)
@@ -471,11 +430,11 @@ static int get_integer_property(const Uint64 name_hash, cute_tiled_property_t *p
     }
 
     map->integer_property = 0;
-    load_property(name_hash, properties, property_count, map);
+    load_property(name, properties, property_count, map);
     return map->integer_property;
 }
 
-static const char *get_string_property(const Uint64 name_hash, cute_tiled_property_t *properties, int property_count, map_t *map)
+static const char *get_string_property(const name_id_t name, cute_tiled_property_t *properties, int property_count, map_t *map)
 {
     // Early exit optimization for empty properties
     if (property_count == 0 || !properties)
@@ -484,7 +443,7 @@ static const char *get_string_property(const Uint64 name_hash, cute_tiled_proper
     }
 
     map->string_property = NULL;
-    load_property(name_hash, properties, property_count, map);
+    load_property(name, properties, property_count, map);
     return map->string_property;
 }
 
@@ -493,6 +452,152 @@ static int get_tile_property_count(cute_tiled_tile_descriptor_t *tile)
     return tile->property_count;
 }
 
+static void destroy_tile_layers(map_t *map)
+{
+    if (map->tile_layer)
+    {
+        for (int index = 0; index < map->tile_layer_count; index += 1)
+        {
+            SDL_free(map->tile_layer[index].cell);
+        }
+
+        SDL_free(map->tile_layer);
+        map->tile_layer = NULL;
+    }
+    map->tile_layer_count = 0;
+}
+
+static bool load_tile_layers(map_t *map)
+{
+    destroy_tile_layers(map);
+
+    if (!map->layer_count)
+    {
+        return true;
+    }
+
+    register int cell_total = map->handle->height * map->handle->width;
+    if (cell_total > 0x10000)
+    {
+        SDL_Log("Map has %d cells, more than 16-bit cell indices can address", cell_total);
+        return false;
+    }
+
+    map->tile_layer = (tile_layer_t *)SDL_calloc((size_t)map->layer_count, sizeof(struct tile_layer));
+    if (!map->tile_layer)
+    {
+        SDL_Log("Error allocating memory for tile layers");
+        return false;
+    }
+
+    cute_tiled_layer_t *layer = map->handle->layers;
+
+    while (layer && map->tile_layer_count < map->layer_count)
+    {
+        if (is_layer_of_type(TILE_LAYER, layer, map))
+        {
+            tile_layer_t *tile_layer = &map->tile_layer[map->tile_layer_count];
+            int *layer_content = layer->data;
+            int cell_count = 0;
+
+            tile_layer->layer = layer;
+            map->tile_layer_count += 1;
+
+            if (!layer_content || layer->data_count < cell_total)
+            {
+                SDL_Log("Tile layer %s is incomplete", layer->name.ptr);
+                return false;
+            }
+
+            for (register int index = 0; index < cell_total; index += 1)
+            {
+                if (layer_content[index])
+                {
+                    cell_count += 1;
+                }
+            }
+
+            if (cell_count)
+            {
+                tile_layer->cell = (tile_cell_t *)SDL_malloc((size_t)cell_count * sizeof(struct tile_cell));
+                if (!tile_layer->cell)
+                {
+                    SDL_Log("Error allocating memory for tile layer cells");
+                    return false;
+                }
+            }
+
+            // Cells are collected in storage order, which keeps them sorted by row. Flip
+            // bits and firstgid are removed once here, so nothing downstream has to.
+            for (register int index = 0; index < cell_total; index += 1)
+            {
+                if (layer_content[index])
+                {
+                    int local_id = get_local_id(remove_gid_flip_bits(layer_content[index]), map->handle);
+                    if (local_id > 0xffff)
+                    {
+                        SDL_Log("Tile %d in layer %s exceeds 16 bits", local_id, layer->name.ptr);
+                        return false;
+                    }
+
+                    tile_layer->cell[tile_layer->cell_count].index = (Uint16)index;
+                    tile_layer->cell[tile_layer->cell_count].id = (Uint16)local_id;
+                    tile_layer->cell_count += 1;
+                }
+            }
+
+            // The parser's 32-bit copy is not read again.
+            CUTE_TILED_FREE(layer->data, NULL);
+            layer->data = NULL;
+            layer->data_count = 0;
+        }
+        layer = layer->next;
+    }
+
+    return true;
+}
+
+// Local tile id at a cell index, or -1 for an empty cell.
+static int find_tile_cell(const tile_layer_t *tile_layer, int index)
+{
+    int low = 0;
+    int high = tile_layer->cell_count - 1;
+
+    while (low <= high)
+    {
+        int middle = (low + high) >> 1;
+        int cell_index = tile_layer->cell[middle].index;
+
+        if (cell_index == index)
+        {
+            return tile_layer->cell[middle].id;
+        }
+        else if (cell_index < index)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle - 1;
+        }
+    }
+
+    return -1;
+}
+
+static tile_layer_t *get_tile_layer(cute_tiled_layer_t *layer, map_t *map)
+{
+    for (int index = 0; index < map->tile_layer_count; index += 1)
+    {
+        if (map->tile_layer[index].layer == layer)
+        {
+            return &map->tile_layer[index];
+        }
+    }
+
+    return NULL;
+}
+
 static bool load_tiles(map_t *map)
 {
     if (map->tile_desc)
@@ -501,7 +606,10 @@ static bool load_tiles(map_t *map)
         map->tile_desc = NULL;
     }
 
-    cute_tiled_layer_t *layer = map->handle->layers;
+    if (!load_tile_layers(map))
+    {
+        return false;
+    }
 
     map->tile_desc_count = map->handle->height * map->handle->width;
 
@@ -516,55 +624,45 @@ static bool load_tiles(map_t *map)
         return false;
     }
 
-    // Use cached dimensions.
-    register int map_width = map->cached_map_width;
-    register int map_height = map->handle->height;
     cute_tiled_tileset_t *tileset = map->handle->tilesets;
 
-    while (layer)
+    for (int layer_index = 0; layer_index < map->tile_layer_count; layer_index += 1)
     {
-        if (is_layer_of_type(TILE_LAYER, layer, map))
+        tile_cell_t *cell = map->tile_layer[layer_index].cell;
+        register int cell_count = map->tile_layer[layer_index].cell_count;
+
+        for (int cell_index = 0; cell_index < cell_count; cell_index += 1)
         {
-            int *layer_content = layer->data;
-            for (int index_height = 0; index_height < map_height; index_height += 1)
+            cute_tiled_tile_descriptor_t *tile = tileset->tiles;
+
+            if (tile_has_properties(cell[cell_index].id, &tile))
             {
-                register int row_base = index_height * map_width;
-                for (int index_width = 0; index_width < map_width; index_width += 1)
-                {
-                    cute_tiled_tile_descriptor_t *tile = tileset->tiles;
-                    int gid = remove_gid_flip_bits(layer_content[row_base + index_width]);
+                int prop_cnt = get_tile_property_count(tile);
+                cute_tiled_property_t *props = tile->properties;
+                tile_desc_t *current_tile = &map->tile_desc[cell[cell_index].index];
 
-                    if (tile_has_properties(gid, &tile, map->handle))
+                for (int pi = 0; pi < prop_cnt; pi += 1)
+                {
+                    switch (lookup_name(props[pi].name.ptr))
                     {
-                        int prop_cnt = get_tile_property_count(tile);
-                        cute_tiled_property_t *props = tile->properties;
-                        tile_desc_t *current_tile = &map->tile_desc[row_base + index_width];
-
-                        for (int pi = 0; pi < prop_cnt; pi += 1)
-                        {
-                            Uint64 ph = generate_hash((const unsigned char *)props[pi].name.ptr);
-                            if (ph == H_IS_DEADLY)
-                            {
-                                current_tile->is_deadly = (bool)props[pi].data.boolean;
-                            }
-                            else if (ph == H_IS_SOLID)
-                            {
-                                current_tile->is_solid = (bool)props[pi].data.boolean;
-                            }
-                            else if (ph == H_IS_WALL)
-                            {
-                                current_tile->is_wall = (bool)props[pi].data.boolean;
-                            }
-                            else if (ph == H_OFFSET_TOP)
-                            {
-                                current_tile->offset_top = props[pi].data.integer;
-                            }
-                        }
+                        case NAME_IS_DEADLY:
+                            current_tile->is_deadly = (bool)props[pi].data.boolean;
+                            break;
+                        case NAME_IS_SOLID:
+                            current_tile->is_solid = (bool)props[pi].data.boolean;
+                            break;
+                        case NAME_IS_WALL:
+                            current_tile->is_wall = (bool)props[pi].data.boolean;
+                            break;
+                        case NAME_OFFSET_TOP:
+                            current_tile->offset_top = props[pi].data.integer;
+                            break;
+                        default:
+                            break;
                     }
                 }
             }
         }
-        layer = layer->next;
     }
 
     return true;
@@ -588,37 +686,46 @@ static bool load_tileset(map_t *map, SDL_Renderer *renderer)
 
     map->tileset_hash = generate_hash((const unsigned char *)file_name);
 
-    if (map->tileset_hash != map->prev_tileset_hash || !map->tileset_texture)
+#if defined SOFTWARE_RASTER
+    if (map->tileset_hash != map->prev_tileset_hash || !map->tileset_raster)
     {
         map->prev_tileset_hash = map->tileset_hash;
 
-        SDL_Surface *tileset_surface = NULL;
-        if (!load_surface_from_file((const char *)file_name, &tileset_surface))
+        if (!map->shared_tileset)
+        {
+            destroy_raster(map->tileset_raster);
+        }
+        map->tileset_raster = NULL;
+        map->shared_tileset = false;
+
+        if (!load_raster_from_file((const char *)file_name, &map->tileset_raster))
         {
             SDL_Log("Error loading tileset image '%s'", file_name);
             return false;
         }
+    }
+#else
+    if (map->tileset_hash != map->prev_tileset_hash || !map->tileset_texture)
+    {
+        map->prev_tileset_hash = map->tileset_hash;
 
         if (map->tileset_texture)
         {
-            SDL_DestroyTexture(map->tileset_texture);
+            if (!map->shared_tileset)
+            {
+                SDL_DestroyTexture(map->tileset_texture);
+            }
             map->tileset_texture = NULL;
+            map->shared_tileset = false;
         }
 
-        map->tileset_texture = SDL_CreateTextureFromSurface(renderer, tileset_surface);
-        SDL_DestroySurface(tileset_surface);
-
-        if (!map->tileset_texture)
+        if (!load_texture_from_file((const char *)file_name, &map->tileset_texture, renderer))
         {
-            SDL_Log("Error creating tileset texture: %s", SDL_GetError());
+            SDL_Log("Error loading tileset image '%s'", file_name);
             return false;
         }
-
-        if (!SDL_SetTextureScaleMode(map->tileset_texture, SDL_SCALEMODE_NEAREST))
-        {
-            SDL_Log("Couldn't set tileset texture scale mode: %s", SDL_GetError());
-        }
     }
+#endif
 
     return exit_code;
 }
@@ -636,15 +743,14 @@ static bool load_objects(map_t *map)
                 cute_tiled_object_t *object = get_head_object(layer, map);
                 while (object)
                 {
-                    // Use generate_hash instead of cached hash_id.
-                    Uint64 obj_name_hash = generate_hash((const unsigned char *)object->name.ptr);
+                    name_id_t obj_name = lookup_name(object->name.ptr);
 
-                    if (H_COIN == obj_name_hash)
+                    if (NAME_COIN == obj_name)
                     {
                         map->coins_left += 1;
                     }
 
-                    if (H_SPAWN == obj_name_hash)
+                    if (NAME_SPAWN == obj_name)
                     {
                         map->spawn_x = (int)object->x;
                         map->spawn_y = (int)object->y;
@@ -682,12 +788,9 @@ static bool load_objects(map_t *map)
                     cute_tiled_object_t *object = get_head_object(layer, map);
                     while (object)
                     {
-                        // Use generate_hash instead of cached hash_id
-                        Uint64 obj_name_hash = generate_hash((const unsigned char *)object->name.ptr);
-
-                        if (H_BLOCK == obj_name_hash)
+                        if (NAME_BLOCK == lookup_name(object->name.ptr))
                         {
-                            if (get_string_property(H_STR, object->properties, object->property_count, map))
+                            if (get_string_property(NAME_STR, object->properties, object->property_count, map))
                             {
                                 map->obj[index].str = SDL_strdup(map->string_property);
                             }
@@ -714,21 +817,113 @@ static bool load_objects(map_t *map)
     return true;
 }
 
-static inline int lookup_lgbtq_tile_id(int id)
-{
-    // Optimize range checks: use unsigned subtraction trick.
-    register unsigned int offset1 = id - 544;
-    return (offset1 <= 63) ? id - 64 : id;
-}
-
-void destroy_map(map_t *map)
+static void destroy_animations(map_t *map)
 {
-    if (!map)
+    if (map->anim_frame)
     {
-        return;
+        SDL_free(map->anim_frame);
+        map->anim_frame = NULL;
     }
+    map->anim_frame_count = 0;
 
-    // Free up allocated memory in reverse order.
+    if (map->anim)
+    {
+        SDL_free(map->anim);
+        map->anim = NULL;
+    }
+    map->anim_count = 0;
+}
+
+static bool load_animations(map_t *map)
+{
+    destroy_animations(map);
+
+    cute_tiled_tileset_t *tileset = map->handle->tilesets;
+    cute_tiled_tile_descriptor_t *tile = tileset->tiles;
+
+    while (tile)
+    {
+        if (tile->animation && tile->frame_count > 0)
+        {
+            map->anim_count += 1;
+            map->anim_frame_count += tile->frame_count;
+        }
+        tile = tile->next;
+    }
+
+    if (!map->anim_count)
+    {
+        return true;
+    }
+
+    map->anim = (anim_t *)SDL_calloc((size_t)map->anim_count, sizeof(struct anim));
+    map->anim_frame = (anim_frame_t *)SDL_calloc((size_t)map->anim_frame_count, sizeof(struct anim_frame));
+    if (!map->anim || !map->anim_frame)
+    {
+        SDL_Log("Error allocating memory for animation tables");
+        destroy_animations(map);
+        return false;
+    }
+
+    // Flatten every animated tile descriptor once, so the per-tick update
+    // never has to walk the descriptor list again.
+    int anim_index = 0;
+    int frame_index = 0;
+    tile = tileset->tiles;
+    while (tile)
+    {
+        if (tile->animation && tile->frame_count > 0)
+        {
+            anim_t *anim = &map->anim[anim_index];
+            anim->tile_id = tile->tile_index;
+            anim->first_frame = frame_index;
+            anim->frame_count = tile->frame_count;
+
+            for (int index = 0; index < tile->frame_count; index += 1)
+            {
+                anim_frame_t *frame = &map->anim_frame[frame_index];
+                frame->tile_id = tile->animation[index].tileid;
+                get_tile_position(frame->tile_id, &frame->src_x, &frame->src_y);
+
+                // Frames without an authored duration fall back to the global rate.
+                if (tile->animation[index].duration > 0)
+                {
+                    frame->duration = (Uint64)tile->animation[index].duration;
+                }
+                else
+                {
+                    frame->duration = 1000 / ANIM_FPS;
+                }
+                frame_index += 1;
+            }
+            anim_index += 1;
+        }
+        tile = tile->next;
+    }
+
+    SDL_Log("Loaded %d animation(s) with %d frame(s)", map->anim_count, map->anim_frame_count);
+
+    return true;
+}
+
+static inline int lookup_lgbtq_tile_id(int id)
+{
+    // Optimize range checks: use unsigned subtraction trick.
+    register unsigned int offset1 = id - 544;
+    return (offset1 <= 63) ? id - 64 : id;
+}
+
+void destroy_map(map_t *map)
+{
+    if (!map)
+    {
+        return;
+    }
+
+    // Free up allocated memory in reverse order.
+
+    // [7] Animations.
+    destroy_animations(map);
 
     // [6] Objects.
     if (map->obj)
@@ -754,6 +949,7 @@ void destroy_map(map_t *map)
         SDL_free(map->tile_desc);
         map->tile_desc = NULL;
     }
+    destroy_tile_layers(map);
 
     // [3] Textures & Surfaces.
     destroy_textures(map);
@@ -765,13 +961,14 @@ void destroy_map(map_t *map)
     SDL_free(map);
 }
 
-bool load_map(const char *file_name, map_t **map, SDL_Renderer *renderer)
+bool prepare_map(const char *file_name, map_t **map)
 {
     bool exit_code = true;
 
     SDL_Log("Loading map: %s", file_name);
 
     // Load map file and allocate required memory.
+    // Nothing in here touches the renderer, so it may run on a worker thread.
 
     // [1] Map.
     if (!*map)
@@ -804,26 +1001,21 @@ bool load_map(const char *file_name, map_t **map, SDL_Renderer *renderer)
         (*map)->spawn_x = 0;
         (*map)->spawn_y = 0;
         (*map)->static_tiles_rendered = false;
+        (*map)->static_started = false;
         (*map)->time_a = 0;
         (*map)->time_b = 0;
         (*map)->delta_time = 0;
-        (*map)->time_since_last_frame = 0;
     }
 
+    Uint64 start = SDL_GetTicksNS();
+
     // [2] Tiled map.
     if (!load_tiled_map(file_name, *map))
     {
         exit_code = false;
         goto exit;
     }
-
-    // [3] Textures & Surfaces.
-    if (!create_textures(renderer, *map))
-    {
-        SDL_Log("Error creating textures and surfaces for map");
-        exit_code = false;
-        goto exit;
-    }
+    start = end_phase(*map, MAP_PHASE_TILED, start);
 
     // [4] Tiles.
     if (!load_tiles(*map))
@@ -831,243 +1023,176 @@ bool load_map(const char *file_name, map_t **map, SDL_Renderer *renderer)
         exit_code = false;
         goto exit;
     }
+    start = end_phase(*map, MAP_PHASE_TILES, start);
 
-    // [5] Tileset.
-    if (!load_tileset(*map, renderer))
+    // [6] Objects.
+    if (!load_objects(*map))
     {
         exit_code = false;
         goto exit;
     }
+    start = end_phase(*map, MAP_PHASE_OBJECTS, start);
 
-    // [6] Objects.
-    if (!load_objects(*map))
+    // [7] Animations.
+    if (!load_animations(*map))
     {
         exit_code = false;
         goto exit;
     }
+    end_phase(*map, MAP_PHASE_ANIMATIONS, start);
 
 exit:
     if (!exit_code)
     {
         destroy_map(*map);
+        *map = NULL;
     }
 
     return exit_code;
 }
 
-bool render_map(map_t *map, SDL_Renderer *renderer, bool *has_updated)
+bool finish_map(map_t *map, SDL_Renderer *renderer)
 {
-    cute_tiled_layer_t *layer;
-    cute_tiled_layer_t *prev_layer = NULL;
-    *has_updated = false;
+    Uint64 start = SDL_GetTicksNS();
 
-    if (!map || !renderer)
+    // Headless instances simulate the map without ever drawing it.
+    if (!renderer)
     {
-        SDL_Log("Invalid parameters: map or renderer is NULL.");
-        return false;
+        return true;
     }
 
-    // Static tiles have already been rendered.
-    if (map->static_tiles_rendered)
+    // [3] Textures & Surfaces.
+    if (!create_textures(renderer, map))
     {
-        // Fast path: skip if no animated objects.
-        if (!map->obj_count)
-        {
-            return true;
-        }
-
-        map->time_b = map->time_a;
-        map->time_a = SDL_GetTicks();
-
-        if (map->time_a > map->time_b)
-        {
-            map->delta_time = map->time_a - map->time_b;
-        }
-        else
-        {
-            map->delta_time = map->time_b - map->time_a;
-        }
-
-        // Update and render objects.
-        map->time_since_last_frame += map->delta_time;
-
-        if (map->time_since_last_frame >= (1000 / ANIM_FPS))
-        {
-            map->time_since_last_frame = 0;
-            *has_updated = true;
-
-            // Use cached dimensions to reduce pointer dereferences.
-            register int tilewidth = map->cached_tilewidth;
-            register int tileheight = map->cached_tileheight;
-            register bool use_lgbtq = map->use_lgbtq_flag;
-            register bool no_coins = !map->coins_left;
-            register int obj_count = map->obj_count - 1;
-            obj_t *obj_array = map->obj;
-
-            SDL_FRect src_f = { .w = (float)tilewidth, .h = (float)tileheight };
-            SDL_FRect dst_f = { .w = (float)tilewidth, .h = (float)tileheight };
-
-            SDL_SetRenderTarget(renderer, map->render_target);
-
-            for (int index = 0; index < obj_count; index += 1)
-            {
-                obj_t *obj = &obj_array[index];
-
-                // Fast path: skip invalid GIDs immediately.
-                if (obj->gid <= 0)
-                {
-                    continue;
-                }
-
-                // Handle door state.
-                if (H_DOOR == obj->hash && no_coins)
-                {
-                    obj->start_frame = 1;
-                    obj->current_frame = 1;
-                }
+        SDL_Log("Error creating textures and surfaces for map");
+        return false;
+    }
+    start = end_phase(map, MAP_PHASE_TEXTURES, start);
 
-                int local_id;
+    // [5] Tileset.
+    if (!load_tileset(map, renderer))
+    {
+        return false;
+    }
+    end_phase(map, MAP_PHASE_TILESET, start);
 
-                if (use_lgbtq)
-                {
-                    local_id = lookup_lgbtq_tile_id(obj->id) + 1;
-                }
-                else
-                {
-                    local_id = obj->id + 1;
-                }
+    return true;
+}
 
-                dst_f.x = (float)obj->x;
-                dst_f.y = (float)obj->y;
+bool load_map(const char *file_name, map_t **map, SDL_Renderer *renderer)
+{
+    if (!prepare_map(file_name, map))
+    {
+        return false;
+    }
 
-                int tmp_x, tmp_y;
+    if (!finish_map(*map, renderer))
+    {
+        destroy_map(*map);
+        *map = NULL;
+        return false;
+    }
 
-                // Restore background tile first (for transparency simulation).
-                src_f.x = (float)obj->canvas_src_x;
-                src_f.y = (float)obj->canvas_src_y;
-                SDL_RenderTexture(renderer, map->tileset_texture, &src_f, &dst_f);
+    return true;
+}
 
-                // Draw object tile on top.
-                if (!obj->is_hidden)
-                {
-                    get_tile_position(local_id, &tmp_x, &tmp_y, map->handle);
-                    src_f.x = (float)tmp_x;
-                    src_f.y = (float)tmp_y;
-                    SDL_RenderTexture(renderer, map->tileset_texture, &src_f, &dst_f);
-                }
+static void draw_tile(map_t *map, SDL_Renderer *renderer, int src_x, int src_y, int dst_x, int dst_y)
+{
+    if (!renderer)
+    {
+        return;
+    }
 
-                // Always update animation frame (even if off-screen).
-                if (obj->anim_length && !obj->is_hidden)
-                {
-                    obj->current_frame += 1;
-                    if (obj->current_frame >= obj->anim_length + obj->start_frame)
-                    {
-                        obj->current_frame = obj->start_frame;
-                    }
-                }
+#if defined SOFTWARE_RASTER
+    blit_raster(map->raster, map->tileset_raster, src_x, src_y, TILE_SIZE, TILE_SIZE, dst_x, dst_y, false);
+#else
+    SDL_FRect src_f = { (float)src_x, (float)src_y, (float)TILE_SIZE, (float)TILE_SIZE };
+    SDL_FRect dst_f = { (float)dst_x, (float)dst_y, (float)TILE_SIZE, (float)TILE_SIZE };
 
-                obj->id = get_next_object_id(obj->gid, obj->current_frame, map->handle);
-            }
+    SDL_RenderTexture(renderer, map->tileset_texture, &src_f, &dst_f);
+#endif
+}
 
-            SDL_SetRenderTarget(renderer, NULL);
+// Draws the static layers into the map canvas and places the objects. A positive cell
+// budget stops after that many tiles; the next call resumes where this one left off.
+static void render_static_layers(map_t *map, SDL_Renderer *renderer, int cell_budget)
+{
+    if (!map->static_started)
+    {
+        if (renderer)
+        {
+#if defined SOFTWARE_RASTER
+            clear_raster(map->raster, map->bg_r, map->bg_g, map->bg_b);
+#else
+            SDL_SetRenderTarget(renderer, map->render_target);
+            SDL_SetRenderDrawColor(renderer, map->bg_r, map->bg_g, map->bg_b, 255);
+            SDL_RenderClear(renderer);
+#endif
         }
 
-        return true;
+        map->static_layer = map->handle->layers;
+        map->static_prev_layer = NULL;
+        map->static_cell = 0;
+        map->static_obj = 0;
+        map->static_started = true;
     }
+#ifndef SOFTWARE_RASTER
+    else if (renderer)
+    {
+        SDL_SetRenderTarget(renderer, map->render_target);
+    }
+#endif
 
-    // Static tiles have not been rendered yet. Do it once!
-    SDL_SetRenderTarget(renderer, map->render_target);
-    SDL_SetRenderDrawColor(renderer, map->bg_r, map->bg_g, map->bg_b, 255);
-    SDL_RenderClear(renderer);
-
-    int index = 0;
-    layer = map->handle->layers;
+    cute_tiled_layer_t *layer = map->static_layer;
+    cute_tiled_layer_t *prev_layer = map->static_prev_layer;
+    int index = map->static_obj;
+    bool is_budgeted = cell_budget > 0;
 
     while (layer)
     {
-        SDL_FRect dst_f = { 0 };
-        SDL_FRect src_f = { 0 };
-
         if (is_layer_of_type(TILE_LAYER, layer, map))
         {
-            if (layer->visible)
+            tile_layer_t *tile_layer = get_tile_layer(layer, map);
+            if (layer->visible && tile_layer && renderer)
             {
                 // Use cached dimensions to reduce pointer dereferences.
                 register int map_width = map->cached_map_width;
-                register int map_height = map->handle->height;
-                register int tilewidth = map->cached_tilewidth;
-                register int tileheight = map->cached_tileheight;
-                int *layer_content = layer->data;
-                int unroll_end = map_width & ~3;
+                register int cell_count = tile_layer->cell_count;
+                tile_cell_t *cell = tile_layer->cell;
+                int cell_index = map->static_cell;
 
-                src_f.w = dst_f.w = (float)tilewidth;
-                src_f.h = dst_f.h = (float)tileheight;
+                if (is_budgeted && cell_count - cell_index > cell_budget)
+                {
+                    cell_count = cell_index + cell_budget;
+                }
 
-                for (int index_height = 0; index_height < map_height; index_height += 1)
+                // Only non-empty cells are stored; walk them row by row.
+                for (; cell_index < cell_count; cell_index += 1)
                 {
-                    register float dst_y = (float)(index_height * tileheight);
-                    register int row_base = index_height * map_width;
-                    int index_width = 0;
+                    int tx, ty;
+                    int cell_at = cell[cell_index].index;
 
-                    for (; index_width < unroll_end; index_width += 4)
-                    {
-                        int base = row_base + index_width;
-                        int g0 = remove_gid_flip_bits(layer_content[base]);
-                        int g1 = remove_gid_flip_bits(layer_content[base + 1]);
-                        int g2 = remove_gid_flip_bits(layer_content[base + 2]);
-                        int g3 = remove_gid_flip_bits(layer_content[base + 3]);
-
-                        dst_f.y = dst_y;
-                        int tx, ty;
-                        if (g0)
-                        {
-                            dst_f.x = (float)(index_width * tilewidth);
-                            get_tile_position(g0, &tx, &ty, map->handle);
-                            src_f.x = (float)tx;
-                            src_f.y = (float)ty;
-                            SDL_RenderTexture(renderer, map->tileset_texture, &src_f, &dst_f);
-                        }
-                        if (g1)
-                        {
-                            dst_f.x = (float)((index_width + 1) * tilewidth);
-                            get_tile_position(g1, &tx, &ty, map->handle);
-                            src_f.x = (float)tx;
-                            src_f.y = (float)ty;
-                            SDL_RenderTexture(renderer, map->tileset_texture, &src_f, &dst_f);
-                        }
-                        if (g2)
-                        {
-                            dst_f.x = (float)((index_width + 2) * tilewidth);
-                            get_tile_position(g2, &tx, &ty, map->handle);
-                            src_f.x = (float)tx;
-                            src_f.y = (float)ty;
-                            SDL_RenderTexture(renderer, map->tileset_texture, &src_f, &dst_f);
-                        }
-                        if (g3)
-                        {
-                            dst_f.x = (float)((index_width + 3) * tilewidth);
-                            get_tile_position(g3, &tx, &ty, map->handle);
-                            src_f.x = (float)tx;
-                            src_f.y = (float)ty;
-                            SDL_RenderTexture(renderer, map->tileset_texture, &src_f, &dst_f);
-                        }
-                    }
+                    get_tile_position(cell[cell_index].id, &tx, &ty);
+                    draw_tile(map, renderer, tx, ty, TILE_TO_POS(cell_at % map_width), TILE_TO_POS(cell_at / map_width));
+                }
 
-                    for (; index_width < map_width; index_width += 1)
+                if (is_budgeted)
+                {
+                    cell_budget -= cell_index - map->static_cell;
+                    if (cell_index < tile_layer->cell_count)
                     {
-                        int gid = remove_gid_flip_bits(layer_content[row_base + index_width]);
-                        if (gid)
-                        {
-                            dst_f.x = (float)(index_width * tilewidth);
-                            dst_f.y = dst_y;
-                            int tx, ty;
-                            get_tile_position(gid, &tx, &ty, map->handle);
-                            src_f.x = (float)tx;
-                            src_f.y = (float)ty;
-                            SDL_RenderTexture(renderer, map->tileset_texture, &src_f, &dst_f);
-                        }
+                        // Out of budget: continue from this cell next time.
+                        map->static_cell = cell_index;
+                        map->static_layer = layer;
+                        map->static_prev_layer = prev_layer;
+                        map->static_obj = index;
+#ifndef SOFTWARE_RASTER
+                        SDL_SetRenderTarget(renderer, NULL);
+#endif
+                        return;
                     }
                 }
+                map->static_cell = 0;
 
                 const char *layer_name = layer->name.ptr;
                 SDL_Log("Render map layer: %s", layer_name);
@@ -1076,11 +1201,7 @@ bool render_map(map_t *map, SDL_Renderer *renderer, bool *has_updated)
         else if (is_layer_of_type(OBJECT_GROUP, layer, map))
         {
             cute_tiled_map_t *handle = map->handle;
-            register int tilewidth_obj = map->cached_tilewidth;
-            register int tileheight_obj = map->cached_tileheight;
             register int map_width_obj = map->cached_map_width;
-            src_f.w = dst_f.w = (float)tilewidth_obj;
-            src_f.h = dst_f.h = (float)tileheight_obj;
             cute_tiled_object_t *object = get_head_object(layer, map);
             while (object)
             {
@@ -1088,47 +1209,54 @@ bool render_map(map_t *map, SDL_Renderer *renderer, bool *has_updated)
 
                 if (gid)
                 {
-                    int anim_length = 0;
-                    int id = 0;
+                    int local_id = get_local_id(gid, handle);
+                    int anim_index = find_animation(local_id, map);
 
                     // Cache object position to avoid multiple pointer dereferences.
-                    dst_f.x = (float)object->x;
-                    dst_f.y = (float)object->y - tileheight_obj;
+                    int dst_x = (int)object->x;
+                    int dst_y = (int)(object->y - TILE_SIZE);
 
                     int tx, ty;
-                    get_tile_position(gid, &tx, &ty, handle);
-                    src_f.x = (float)tx;
-                    src_f.y = (float)ty;
-
-                    set_object_animation(gid, &anim_length, &id, handle);
-                    map->obj[index].gid = get_local_id(gid, handle);
-                    map->obj[index].id = id;
-                    map->obj[index].x = (int)dst_f.x;
-                    map->obj[index].y = (int)dst_f.y;
+                    get_tile_position(local_id, &tx, &ty);
+
+                    map->obj[index].gid = local_id;
+                    map->obj[index].id = local_id;
+                    map->obj[index].drawn_id = local_id;
+                    map->obj[index].x = dst_x;
+                    map->obj[index].y = dst_y;
                     map->obj[index].current_frame = 0;
-                    map->obj[index].anim_length = anim_length;
+                    map->obj[index].time_since_last_frame = 0;
+                    if (anim_index >= 0)
+                    {
+                        map->obj[index].first_frame = map->anim[anim_index].first_frame;
+                        map->obj[index].anim_length = map->anim[anim_index].frame_count;
+                    }
+                    else
+                    {
+                        map->obj[index].first_frame = -1;
+                        map->obj[index].anim_length = 0;
+                    }
                     map->obj[index].object_id = object->id;
-                    // Use generate_hash instead of cached hash_id.
-                    map->obj[index].hash = generate_hash((const unsigned char *)object->name.ptr);
+                    map->obj[index].name = lookup_name(object->name.ptr);
 
-                    if (H_DOOR == map->obj[index].hash)
+                    if (NAME_DOOR == map->obj[index].name)
                     {
                         map->obj[index].anim_length = 0;
                     }
 
-                    if (prev_layer)
+                    tile_layer_t *layer_below = prev_layer ? get_tile_layer(prev_layer, map) : NULL;
+                    if (layer_below)
                     {
-                        int iw = (int)dst_f.x / tilewidth_obj;
-                        int ih = (int)dst_f.y / tileheight_obj;
-                        int *layer_content_below = prev_layer->data;
-                        int gid_below = remove_gid_flip_bits(layer_content_below[(ih * map_width_obj) + iw]);
-                        if (gid_below)
+                        int iw = POS_TO_TILE(dst_x);
+                        int ih = POS_TO_TILE(dst_y);
+                        int id_below = find_tile_cell(layer_below, (ih * map_width_obj) + iw);
+                        if (id_below >= 0)
                         {
-                            get_tile_position(gid_below, &map->obj[index].canvas_src_x, &map->obj[index].canvas_src_y, handle);
+                            get_tile_position(id_below, &map->obj[index].canvas_src_x, &map->obj[index].canvas_src_y);
                         }
                     }
 
-                    SDL_RenderTexture(renderer, map->tileset_texture, &src_f, &dst_f);
+                    draw_tile(map, renderer, tx, ty, dst_x, dst_y);
                     index += 1;
                 }
 
@@ -1142,14 +1270,178 @@ bool render_map(map_t *map, SDL_Renderer *renderer, bool *has_updated)
         layer = layer->next;
     }
 
-    SDL_SetRenderTarget(renderer, NULL);
+#ifndef SOFTWARE_RASTER
+    if (renderer)
+    {
+        SDL_SetRenderTarget(renderer, NULL);
+    }
+#endif
 
+    map->static_layer = NULL;
     map->static_tiles_rendered = true;
+}
+
+bool render_map(map_t *map, SDL_Renderer *renderer, bool *has_updated)
+{
+    *has_updated = false;
+
+    // Without a renderer only the object state is kept up to date.
+    if (!map)
+    {
+        SDL_Log("Invalid parameters: map is NULL.");
+        return false;
+    }
+
+    // Static tiles have already been rendered.
+    if (map->static_tiles_rendered)
+    {
+        // Fast path: skip if no animated objects.
+        if (!map->obj_count)
+        {
+            return true;
+        }
+
+        map->time_b = map->time_a;
+        map->time_a = get_ticks();
+
+        if (map->time_a > map->time_b)
+        {
+            map->delta_time = map->time_a - map->time_b;
+        }
+        else
+        {
+            map->delta_time = map->time_b - map->time_a;
+        }
+
+        // Update and render objects.
+        register bool use_lgbtq = map->use_lgbtq_flag;
+        register bool no_coins = !map->coins_left;
+        register int obj_count = map->obj_count - 1;
+        register Uint64 delta_time = map->delta_time;
+        obj_t *obj_array = map->obj;
+        anim_frame_t *anim_frame = map->anim_frame;
+        bool target_set = false;
+
+        for (int index = 0; index < obj_count; index += 1)
+        {
+            obj_t *obj = &obj_array[index];
+
+            // Fast path: skip invalid GIDs immediately.
+            if (obj->gid <= 0)
+            {
+                continue;
+            }
+
+            // Handle door state.
+            if (NAME_DOOR == obj->name && no_coins)
+            {
+                obj->start_frame = 1;
+                obj->current_frame = 1;
+            }
+
+            int draw_x;
+            int draw_y;
+            int draw_id;
+
+            if (obj->first_frame >= 0)
+            {
+                anim_frame_t *frame = &anim_frame[obj->first_frame + obj->current_frame];
+
+                // Advance animation on its own per-frame timer (even if off-screen).
+                if (obj->anim_length && !obj->is_hidden)
+                {
+                    // Carry the overshoot so authored durations hold at low frame rates.
+                    obj->time_since_last_frame += delta_time;
+                    while (obj->time_since_last_frame >= frame->duration)
+                    {
+                        obj->time_since_last_frame -= frame->duration;
+                        obj->current_frame += 1;
+                        if (obj->current_frame >= obj->anim_length + obj->start_frame)
+                        {
+                            obj->current_frame = obj->start_frame;
+                        }
+                        frame = &anim_frame[obj->first_frame + obj->current_frame];
+                    }
+                }
+
+                obj->id = frame->tile_id;
+                draw_x = frame->src_x;
+                draw_y = frame->src_y;
+            }
+            else
+            {
+                get_tile_position(obj->id, &draw_x, &draw_y);
+            }
+
+            draw_id = obj->id;
+            if (use_lgbtq)
+            {
+                draw_id = lookup_lgbtq_tile_id(obj->id);
+                if (draw_id != obj->id)
+                {
+                    get_tile_position(draw_id, &draw_x, &draw_y);
+                }
+            }
+
+            if (obj->is_hidden)
+            {
+                draw_id = -1;
+            }
+
+            // Nothing changed since the last time this object was drawn.
+            if (draw_id == obj->drawn_id)
+            {
+                continue;
+            }
+
+            if (!target_set && renderer)
+            {
+#ifndef SOFTWARE_RASTER
+                SDL_SetRenderTarget(renderer, map->render_target);
+#endif
+                target_set = true;
+            }
+
+            // Restore background tile first (for transparency simulation).
+            draw_tile(map, renderer, obj->canvas_src_x, obj->canvas_src_y, obj->x, obj->y);
+
+            // Draw object tile on top.
+            if (!obj->is_hidden)
+            {
+                draw_tile(map, renderer, draw_x, draw_y, obj->x, obj->y);
+            }
+
+            obj->drawn_id = draw_id;
+        }
+
+        if (target_set)
+        {
+#ifndef SOFTWARE_RASTER
+            SDL_SetRenderTarget(renderer, NULL);
+#endif
+            *has_updated = true;
+        }
+
+        return true;
+    }
+
+    // Static tiles have not been rendered yet. Do it once!
+    render_static_layers(map, renderer, 0);
     *has_updated = true;
 
     return true;
 }
 
+bool prerender_map(map_t *map, SDL_Renderer *renderer, int cell_budget)
+{
+    if (!map->static_tiles_rendered)
+    {
+        render_static_layers(map, renderer, cell_budget);
+    }
+
+    return map->static_tiles_rendered;
+}
+
 bool object_intersects(aabb_t bb, map_t *map, int *index_ptr)
 {
     cute_tiled_layer_t *layer = map->handle->layers;
@@ -1197,7 +1489,170 @@ int get_tile_index(int pos_x, int pos_y, map_t *map)
     // Use cached dimensions to reduce pointer dereferences.
     register int map_width = map->cached_map_width;
     register int max_index = map->tile_desc_count - 1;
-    register int index = (pos_x >> 4) + ((pos_y >> 4) * map_width);
+    register int index = POS_TO_TILE(pos_x) + (POS_TO_TILE(pos_y) * map_width);
+
+    if (index < 0)
+    {
+        return 0;
+    }
 
     return (index > max_index) ? max_index : index;
 }
+
+const tile_desc_t *get_tile_desc(int pos_x, int pos_y, map_t *map)
+{
+    // Past an open edge the tile belongs to the neighbouring world map, once it is loaded.
+    if (map->world && (pos_x < 0 || pos_y < 0 || pos_x >= map->width || pos_y >= map->height))
+    {
+        const tile_desc_t *tile = get_world_tile(map->world, map->world_x + pos_x, map->world_y + pos_y);
+        if (tile)
+        {
+            return tile;
+        }
+    }
+
+    return &map->tile_desc[get_tile_index(pos_x, pos_y, map)];
+}
+
+#if defined BENCHMARK
+static int compare_ns(const void *a, const void *b)
+{
+    Uint64 lhs = *(const Uint64 *)a;
+    Uint64 rhs = *(const Uint64 *)b;
+
+    return (lhs > rhs) - (lhs < rhs);
+}
+
+static void write_timing(SDL_IOStream *io, const char *name, Uint64 *sample, int runs, bool is_last)
+{
+    Uint64 total = 0;
+    for (int run = 0; run < runs; run += 1)
+    {
+        total += sample[run];
+    }
+    SDL_qsort(sample, runs, sizeof(Uint64), compare_ns);
+
+    SDL_IOprintf(io, "        \"%s\": { \"mean_ms\": %.4f, \"p95_ms\": %.4f, \"max_ms\": %.4f }%s\n",
+                 name,
+                 (double)total / runs / 1000000.0,
+                 (double)sample[(runs - 1) * 95 / 100] / 1000000.0,
+                 (double)sample[runs - 1] / 1000000.0,
+                 is_last ? "" : ",");
+}
+
+bool benchmark_maps(SDL_Renderer *renderer, int runs, const char *json_file)
+{
+    // One row of samples per phase, plus the whole load_map() call.
+    Uint64 *sample = (Uint64 *)SDL_calloc((size_t)(MAP_PHASE_COUNT + 1) * runs, sizeof(Uint64));
+    if (!sample)
+    {
+        SDL_Log("Error allocating benchmark samples");
+        return false;
+    }
+
+    SDL_IOStream *io = SDL_IOFromFile(json_file, "w");
+    if (!io)
+    {
+        SDL_Log("Couldn't write %s: %s", json_file, SDL_GetError());
+        SDL_free(sample);
+        return false;
+    }
+
+    bool has_memory = get_memory_peak() >= 0;
+    bool exit_code = true;
+
+    SDL_IOprintf(io, "{\n  \"runs\": %d,\n  \"results\": [\n", runs);
+
+    for (int level = FIRST_LEVEL; exit_code && level <= LAST_LEVEL; level += 1)
+    {
+        char file_name[11] = { 0 };
+        SDL_snprintf(file_name, 11, "%03d.%s", level, MAP_SUFFIX);
+
+        // Cold: into a fresh map, as at game start. Warm: over the resident map, as on a level change.
+        for (int is_warm = 0; exit_code && is_warm <= 1; is_warm += 1)
+        {
+            map_t *map = NULL;
+            Sint64 peak = 0;
+
+            if (is_warm && !load_map(file_name, &map, renderer))
+            {
+                exit_code = false;
+                break;
+            }
+
+            for (int run = 0; run < runs; run += 1)
+            {
+                if (!is_warm)
+                {
+                    destroy_map(map);
+                    map = NULL;
+                }
+
+                Sint64 base = reset_memory_peak();
+                Uint64 start = SDL_GetTicksNS();
+                if (!load_map(file_name, &map, renderer))
+                {
+                    exit_code = false;
+                    break;
+                }
+                sample[(MAP_PHASE_COUNT * runs) + run] = SDL_GetTicksNS() - start;
+
+                if (has_memory && get_memory_peak() - base > peak)
+                {
+                    peak = get_memory_peak() - base;
+                }
+
+                for (int phase = 0; phase < MAP_PHASE_COUNT; phase += 1)
+                {
+                    sample[(phase * runs) + run] = map->phase_ns[phase];
+                }
+            }
+            destroy_map(map);
+
+            if (!exit_code)
+            {
+                break;
+            }
+
+            SDL_IOprintf(io, "%s    {\n      \"map\": \"%s\",\n      \"mode\": \"%s\",\n",
+                         (FIRST_LEVEL == level && !is_warm) ? "" : ",\n",
+                         file_name,
+                         is_warm ? "warm" : "cold");
+            if (has_memory)
+            {
+                SDL_IOprintf(io, "      \"peak_bytes\": %" SDL_PRIs64 ",\n", peak);
+            }
+            else
+            {
+                SDL_IOprintf(io, "      \"peak_bytes\": null,\n");
+            }
+            SDL_IOprintf(io, "      \"phases\": {\n");
+            for (int phase = 0; phase <= MAP_PHASE_COUNT; phase += 1)
+            {
+                write_timing(io, phase < MAP_PHASE_COUNT ? phase_name[phase] : "load_map", &sample[phase * runs], runs, MAP_PHASE_COUNT == phase);
+            }
+            SDL_IOprintf(io, "      }\n    }");
+
+            SDL_Log("%s %s: p50 %.3f ms, p95 %.3f ms",
+                    file_name,
+                    is_warm ? "warm" : "cold",
+                    (double)sample[(MAP_PHASE_COUNT * runs) + (runs - 1) / 2] / 1000000.0,
+                    (double)sample[(MAP_PHASE_COUNT * runs) + (runs - 1) * 95 / 100] / 1000000.0);
+        }
+    }
+
+    SDL_IOprintf(io, "\n  ]\n}\n");
+    if (!SDL_CloseIO(io))
+    {
+        exit_code = false;
+    }
+    SDL_free(sample);
+
+    if (exit_code)
+    {
+        SDL_Log("Level load timings written to %s", json_file);
+    }
+
+    return exit_code;
+}
+#endif
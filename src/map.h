@@ -15,10 +15,20 @@
 
 #include "aabb.h"
 #include "cute_tiled.h"
+#include "names.h"
+#include "raster.h"
 
-#define H_BLOCK 0x000000310f297fd0
-#define H_COIN  0x000000017c953f2e
-#define H_DOOR  0x000000017c95cc59
+typedef enum map_phase
+{
+    MAP_PHASE_TILED = 0,
+    MAP_PHASE_TILES,
+    MAP_PHASE_OBJECTS,
+    MAP_PHASE_ANIMATIONS,
+    MAP_PHASE_TEXTURES,
+    MAP_PHASE_TILESET,
+    MAP_PHASE_COUNT
+
+} map_phase_t;
 
 typedef struct tile_desc
 {
@@ -29,6 +39,38 @@ typedef struct tile_desc
 
 } tile_desc_t;
 
+typedef struct tile_cell
+{
+    Uint16 index; // Row-major cell index.
+    Uint16 id;    // Local tile id, flip bits removed.
+
+} tile_cell_t;
+
+typedef struct tile_layer
+{
+    cute_tiled_layer_t *layer;
+    tile_cell_t *cell; // Non-empty cells only, in row order.
+    int cell_count;
+
+} tile_layer_t;
+
+typedef struct anim_frame
+{
+    int tile_id;
+    int src_x;
+    int src_y;
+    Uint64 duration;
+
+} anim_frame_t;
+
+typedef struct anim
+{
+    int tile_id;
+    int first_frame;
+    int frame_count;
+
+} anim_t;
+
 typedef struct obj
 {
     int x;
@@ -36,14 +78,17 @@ typedef struct obj
     int canvas_src_x;
     int canvas_src_y;
     int anim_length;
+    int first_frame;
     int start_frame;
     int current_frame;
+    int drawn_id;
     int gid;
     int id;
     int object_id;
     char *str;
 
-    Uint64 hash;
+    name_id_t name;
+    Uint64 time_since_last_frame;
 
     bool is_hidden;
 
@@ -61,9 +106,23 @@ typedef struct map
 
     SDL_Texture *render_target;
     SDL_Texture *tileset_texture;
+    bool shared_tileset;
+
+#if defined SOFTWARE_RASTER
+    // CPU-side map canvas and tileset, used instead of the textures above.
+    raster_t *raster;
+    raster_t *tileset_raster;
+#endif
 
     bool static_tiles_rendered;
 
+    // Progress of the static pass, which a streamed world map spreads over several frames.
+    bool static_started;
+    cute_tiled_layer_t *static_layer;
+    cute_tiled_layer_t *static_prev_layer;
+    int static_cell;
+    int static_obj;
+
     Uint64 hash_id_objectgroup;
     Uint64 hash_id_tilelayer;
 
@@ -85,23 +144,39 @@ typedef struct map
     Uint64 time_a;
     Uint64 time_b;
     Uint64 delta_time;
-    Uint64 time_since_last_frame;
 
     Uint64 tileset_hash;
     Uint64 prev_tileset_hash;
 
-    // Cached tileset dimensions to reduce pointer dereferences in hot loops.
-    int cached_tilewidth;
-    int cached_tileheight;
+    // Cached map width to reduce pointer dereferences in hot loops.
     int cached_map_width;
 
     tile_desc_t *tile_desc;
     int tile_desc_count;
 
+    // Tile layers converted from cute_tiled's 32-bit cells at load time.
+    tile_layer_t *tile_layer;
+    int tile_layer_count;
+
+    // Flat animation tables, built once per map load.
+    anim_t *anim;
+    int anim_count;
+    anim_frame_t *anim_frame;
+    int anim_frame_count;
+
     bool use_lgbtq_flag;
     bool show_dialogue;
     bool keep_dialogue;
 
+    // Placement inside a world; zero when the map is played on its own.
+    struct world *world;
+    int world_x;
+    int world_y;
+    Uint8 open_edges;
+
+    // Duration of each phase of the most recent load, for benchmark_maps().
+    Uint64 phase_ns[MAP_PHASE_COUNT];
+
 #if defined(__SYMBIAN32__)
     // Track if any animated objects changed this frame.
     bool objects_dirty;
@@ -109,6 +184,15 @@ typedef struct map
 
 } map_t;
 
+typedef enum
+{
+    EDGE_LEFT = 0x01,
+    EDGE_RIGHT = 0x02,
+    EDGE_TOP = 0x04,
+    EDGE_BOTTOM = 0x08
+
+} map_edge_t;
+
 typedef enum
 {
     TILE_LAYER = 0,
@@ -117,9 +201,16 @@ typedef enum
 } layer_type;
 
 void destroy_map(map_t *map);
+bool prepare_map(const char *file_name, map_t **map);
+bool finish_map(map_t *map, SDL_Renderer *renderer);
 bool load_map(const char *file_name, map_t **map, SDL_Renderer *renderer);
 bool render_map(map_t *map, SDL_Renderer *renderer, bool *has_updated);
+bool prerender_map(map_t *map, SDL_Renderer *renderer, int cell_budget);
 int get_tile_index(int pos_x, int pos_y, map_t *map);
+const tile_desc_t *get_tile_desc(int pos_x, int pos_y, map_t *map);
 bool object_intersects(aabb_t bb, map_t *map, int *index_ptr);
+#if defined BENCHMARK
+bool benchmark_maps(SDL_Renderer *renderer, int runs, const char *json_file);
+#endif
 
 #endif // MAP_H
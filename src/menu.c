@@ -19,6 +19,11 @@ bool load_menu(core_t *nc)
 {
     unload_menu(nc);
 
+    if (nc->is_headless)
+    {
+        return true;
+    }
+
     if (!load_texture_from_file("splash.png", &nc->temp_a, nc->renderer))
     {
         SDL_Log("Unable to load title screen image: %s", SDL_GetError());
@@ -49,7 +54,7 @@ bool handle_menu_button_down(core_t *nc, button_t button)
         nc->btn = 0;
 
         unload_menu(nc);
-        if (!load_game(nc))
+        if (!load_game(nc, NULL))
         {
             SDL_Log("Failed to load game.");
             return false;
@@ -0,0 +1,412 @@
+/** @file music.c
+ *
+ *  A minimalist, cross-platform puzzle-platformer, designed
+ *  especially for the Nokia N-Gage.
+ *
+ *  Copyright (c) 2026, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <SDL3/SDL.h>
+#include <stdio.h>
+
+#include "config.h"
+#include "music.h"
+#include "pfs.h"
+
+#define WAVE_FORMAT_IMA_ADPCM 0x0011
+#define WAVE_ID_RIFF          0x46464952 // "RIFF"
+#define WAVE_ID_WAVE          0x45564157 // "WAVE"
+#define WAVE_ID_FMT           0x20746d66 // "fmt "
+#define WAVE_ID_DATA          0x61746164 // "data"
+
+#define MUSIC_BENCH_SECONDS 60
+#define MUSIC_BENCH_REQUEST 512 // Samples asked for per simulated audio callback.
+
+static const Sint8 ima_index[16] = { -1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8 };
+
+static const Sint16 ima_step[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45, 50, 55, 60,
+    66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371,
+    408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878,
+    2066, 2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845,
+    8630, 9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086,
+    29794, 32767
+};
+
+static SDL_AudioDeviceID audio_device = 0;
+static SDL_AudioStream *stream = NULL;
+
+// Game thread: the open archive entry and its read position.
+static FILE *track = NULL;
+static SDL_AudioSpec track_spec;
+static long data_start = 0;
+static Uint32 data_size = 0;
+static Uint32 data_left = 0;
+static int block_align = 0;
+static int samples_per_block = 0;
+static Uint8 block[MUSIC_BLOCK_MAX];
+static int fill_index = 0;
+
+// Double buffer: the game thread decodes into a buffer that is not full,
+// the audio thread drains a full one and hands it back.
+static Sint16 pcm[2][MUSIC_BUFFER_SAMPLES];
+static int pcm_length[2];
+static SDL_AtomicInt pcm_full[2];
+
+// Audio thread only.
+static int play_index = 0;
+static int play_position = 0;
+
+static bool read_u16(FILE *file, Uint16 *value)
+{
+    Uint8 bytes[2];
+
+    if (fread(bytes, 1, 2, file) != 2)
+    {
+        return false;
+    }
+    *value = (Uint16)(bytes[0] | (bytes[1] << 8));
+
+    return true;
+}
+
+static bool read_u32(FILE *file, Uint32 *value)
+{
+    Uint8 bytes[4];
+
+    if (fread(bytes, 1, 4, file) != 4)
+    {
+        return false;
+    }
+    *value = (Uint32)bytes[0] | ((Uint32)bytes[1] << 8) | ((Uint32)bytes[2] << 16) | ((Uint32)bytes[3] << 24);
+
+    return true;
+}
+
+static bool parse_track(const char *file_name)
+{
+    Uint32 id = 0;
+    Uint32 size = 0;
+    Uint16 format = 0;
+    Uint16 channels = 0;
+    Uint32 rate = 0;
+    Uint32 byte_rate = 0;
+    Uint16 align = 0;
+    Uint16 bits = 0;
+    bool has_format = false;
+
+    if (!read_u32(track, &id) || id != WAVE_ID_RIFF || !read_u32(track, &size) ||
+        !read_u32(track, &id) || id != WAVE_ID_WAVE)
+    {
+        SDL_Log("Invalid music track: %s", file_name);
+        return false;
+    }
+
+    while (read_u32(track, &id) && read_u32(track, &size))
+    {
+        if (WAVE_ID_FMT == id && size >= 16)
+        {
+            if (!read_u16(track, &format) || !read_u16(track, &channels) || !read_u32(track, &rate) ||
+                !read_u32(track, &byte_rate) || !read_u16(track, &align) || !read_u16(track, &bits))
+            {
+                break;
+            }
+            fseek(track, (long)(size - 16 + (size & 1)), SEEK_CUR);
+            has_format = true;
+        }
+        else if (WAVE_ID_DATA == id)
+        {
+            if (!has_format || WAVE_FORMAT_IMA_ADPCM != format || 1 != channels || align <= 4 || align > MUSIC_BLOCK_MAX)
+            {
+                SDL_Log("Music track %s must be mono IMA ADPCM with blocks of at most %d bytes", file_name, MUSIC_BLOCK_MAX);
+                return false;
+            }
+
+            track_spec.format = SDL_AUDIO_S16;
+            track_spec.channels = 1;
+            track_spec.freq = (int)rate;
+            block_align = align;
+            samples_per_block = ((align - 4) * 2) + 1;
+            data_start = ftell(track);
+            data_size = size;
+            data_left = size;
+            return true;
+        }
+        else
+        {
+            fseek(track, (long)(size + (size & 1)), SEEK_CUR);
+        }
+    }
+
+    SDL_Log("Truncated music track: %s", file_name);
+    return false;
+}
+
+static int decode_block(const Uint8 *src, int size, Sint16 *dst)
+{
+    if (size < 4)
+    {
+        return 0;
+    }
+
+    // Block header: initial predictor (also the first sample) and step index.
+    int predictor = (Sint16)(src[0] | (src[1] << 8));
+    int step_index = (src[2] > 88) ? 88 : src[2];
+    int count = 0;
+
+    dst[count++] = (Sint16)predictor;
+
+    for (int index = 4; index < size; index += 1)
+    {
+        // Low nibble first.
+        for (int shift = 0; shift < 8; shift += 4)
+        {
+            int nibble = (src[index] >> shift) & 0x0f;
+            int step = ima_step[step_index];
+            int diff = step >> 3;
+
+            if (nibble & 1)
+            {
+                diff += step >> 2;
+            }
+            if (nibble & 2)
+            {
+                diff += step >> 1;
+            }
+            if (nibble & 4)
+            {
+                diff += step;
+            }
+            predictor += (nibble & 8) ? -diff : diff;
+            predictor = (predictor > SDL_MAX_SINT16) ? SDL_MAX_SINT16 : (predictor < SDL_MIN_SINT16) ? SDL_MIN_SINT16 : predictor;
+
+            step_index += ima_index[nibble];
+            step_index = (step_index < 0) ? 0 : (step_index > 88) ? 88 : step_index;
+
+            dst[count++] = (Sint16)predictor;
+        }
+    }
+
+    return count;
+}
+
+static void fill_buffer(int index)
+{
+    int samples = 0;
+
+    while (samples + samples_per_block <= MUSIC_BUFFER_SAMPLES)
+    {
+        // The track loops; rewinding costs one seek.
+        if (0 == data_left)
+        {
+            fseek(track, data_start, SEEK_SET);
+            data_left = data_size;
+        }
+
+        int bytes = ((Uint32)block_align < data_left) ? block_align : (int)data_left;
+        int read = (int)fread(block, 1, bytes, track);
+        if (read <= 0)
+        {
+            break;
+        }
+        data_left -= (Uint32)bytes;
+
+        samples += decode_block(block, read, pcm[index] + samples);
+    }
+
+    pcm_length[index] = samples;
+}
+
+static void SDLCALL feed_music(void *userdata, SDL_AudioStream *audio_stream, int additional_amount, int total_amount)
+{
+    int samples = additional_amount / (int)sizeof(Sint16);
+
+    // Nothing is decoded or read here; an underrun just plays silence.
+    while (samples > 0 && SDL_GetAtomicInt(&pcm_full[play_index]))
+    {
+        int remaining = pcm_length[play_index] - play_position;
+        int count = (remaining < samples) ? remaining : samples;
+
+        SDL_PutAudioStreamData(audio_stream, pcm[play_index] + play_position, count * (int)sizeof(Sint16));
+        play_position += count;
+        samples -= count;
+
+        if (play_position >= pcm_length[play_index])
+        {
+            play_position = 0;
+            SDL_SetAtomicInt(&pcm_full[play_index], 0);
+            play_index ^= 1;
+        }
+    }
+}
+
+static bool open_track(const char *file_name, bool *is_packed)
+{
+    const SDL_AudioSpec device_spec = { SDL_AUDIO_S16, 1, AUDIO_FREQ };
+
+    stop_music();
+
+    track = open_binary_file_from_path(file_name);
+    *is_packed = (NULL != track);
+    if (!track)
+    {
+        // Music is optional; without a packed track the game stays silent.
+        SDL_LogDebug(SDL_LOG_CATEGORY_AUDIO, "Music %s not packed", file_name);
+        return false;
+    }
+
+    if (!parse_track(file_name))
+    {
+        stop_music();
+        return false;
+    }
+
+    stream = SDL_CreateAudioStream(&track_spec, &device_spec);
+    if (!stream || !SDL_SetAudioStreamGetCallback(stream, feed_music, NULL))
+    {
+        SDL_Log("Couldn't create music stream: %s", SDL_GetError());
+        stop_music();
+        return false;
+    }
+
+    return true;
+}
+
+void init_music(SDL_AudioDeviceID device)
+{
+    audio_device = device;
+}
+
+bool play_music(const char *file_name)
+{
+    bool is_packed = false;
+
+    if (!open_track(file_name, &is_packed))
+    {
+        return !is_packed;
+    }
+
+    // Both buffers are full before the device starts pulling.
+    update_music();
+
+    if (!SDL_BindAudioStream(audio_device, stream))
+    {
+        SDL_Log("Couldn't bind music stream: %s", SDL_GetError());
+        stop_music();
+        return false;
+    }
+
+    return true;
+}
+
+void update_music(void)
+{
+    if (!track)
+    {
+        return;
+    }
+
+    while (!SDL_GetAtomicInt(&pcm_full[fill_index]))
+    {
+        fill_buffer(fill_index);
+        SDL_SetAtomicInt(&pcm_full[fill_index], 1);
+        fill_index ^= 1;
+    }
+}
+
+void stop_music(void)
+{
+    // Destroying the stream waits for a running callback, so the buffers are free afterwards.
+    if (stream)
+    {
+        SDL_DestroyAudioStream(stream);
+        stream = NULL;
+    }
+
+    if (track)
+    {
+        fclose(track);
+        track = NULL;
+    }
+
+    SDL_SetAtomicInt(&pcm_full[0], 0);
+    SDL_SetAtomicInt(&pcm_full[1], 0);
+    fill_index = 0;
+    play_index = 0;
+    play_position = 0;
+}
+
+#if defined BENCHMARK
+bool benchmark_music(const char *file_name)
+{
+    bool is_packed = false;
+
+    if (!open_track(file_name, &is_packed))
+    {
+        SDL_Log("Couldn't open music track %s", file_name);
+        return false;
+    }
+
+    Sint64 total_samples = (Sint64)track_spec.freq * MUSIC_BENCH_SECONDS;
+    Sint64 decoded = 0;
+
+    SDL_Log("Streaming %d s of %s (%d Hz, %d byte blocks, %d KB buffered)",
+            MUSIC_BENCH_SECONDS, file_name, track_spec.freq, block_align,
+            (int)((sizeof(pcm) + sizeof(block)) / 1024));
+
+    // Read and decode throughput, as paid by the game thread.
+    Uint64 start = SDL_GetTicksNS();
+    while (decoded < total_samples)
+    {
+        fill_buffer(0);
+        if (!pcm_length[0])
+        {
+            break;
+        }
+        decoded += pcm_length[0];
+    }
+    Uint64 elapsed = SDL_GetTicksNS() - start;
+
+    SDL_Log("Decode:   %.2f Msamples/s, %.0fx realtime",
+            elapsed ? (double)decoded * 1000.0 / (double)elapsed : 0.0,
+            elapsed ? (double)decoded * SDL_NS_PER_SECOND / track_spec.freq / (double)elapsed : 0.0);
+
+    // Simulated device pulls against the double buffer; the stream is never bound.
+    Uint64 update_worst = 0;
+    Uint64 callback_worst = 0;
+    Uint64 callback_total = 0;
+    int callbacks = 0;
+
+    fseek(track, data_start, SEEK_SET);
+    data_left = data_size;
+    for (Sint64 played = 0; played < total_samples; played += MUSIC_BENCH_REQUEST)
+    {
+        start = SDL_GetTicksNS();
+        update_music();
+        elapsed = SDL_GetTicksNS() - start;
+        update_worst = (elapsed > update_worst) ? elapsed : update_worst;
+
+        start = SDL_GetTicksNS();
+        feed_music(NULL, stream, MUSIC_BENCH_REQUEST * (int)sizeof(Sint16), MUSIC_BENCH_REQUEST * (int)sizeof(Sint16));
+        elapsed = SDL_GetTicksNS() - start;
+        callback_worst = (elapsed > callback_worst) ? elapsed : callback_worst;
+        callback_total += elapsed;
+        callbacks += 1;
+
+        SDL_ClearAudioStream(stream);
+    }
+
+    SDL_Log("Callback: mean %.2f us, worst %.2f us over %d pulls of %d samples",
+            callbacks ? (double)callback_total / callbacks / 1000.0 : 0.0,
+            (double)callback_worst / 1000.0,
+            callbacks,
+            MUSIC_BENCH_REQUEST);
+    SDL_Log("Refill:   worst %.2f us per frame", (double)update_worst / 1000.0);
+
+    stop_music();
+
+    return true;
+}
+#endif
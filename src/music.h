@@ -0,0 +1,24 @@
+/** @file music.h
+ *
+ *  A minimalist, cross-platform puzzle-platformer, designed
+ *  especially for the Nokia N-Gage.
+ *
+ *  Copyright (c) 2026, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#ifndef MUSIC_H
+#define MUSIC_H
+
+#include <SDL3/SDL.h>
+
+void init_music(SDL_AudioDeviceID device);
+bool play_music(const char *file_name);
+void update_music(void);
+void stop_music(void);
+#if defined BENCHMARK
+bool benchmark_music(const char *file_name);
+#endif
+
+#endif // MUSIC_H
@@ -14,8 +14,13 @@
 #include "map.h"
 #include "overclock.h"
 #include "overlay.h"
+#include "trace.h"
 #include "utils.h"
 
+// Texts were written against the old glyph loop, which never showed this
+// cell: it landed on row five and was overdrawn. Keep it hidden.
+#define DIALOGUE_HIDDEN_CELL 94
+
 static void get_character_position(const unsigned char character, int *pos_x, int *pos_y)
 {
     int index = 0;
@@ -34,152 +39,321 @@ static void get_character_position(const unsigned char character, int *pos_x, in
     *pos_y = 146 + (index / 18) * 9;
 }
 
-void destroy_overlay(overlay_t *ui)
+static SDL_PixelFormat get_canvas_format(void)
 {
-    if (ui)
+#ifndef __DREAMCAST__
+    return SDL_PIXELFORMAT_XRGB4444;
+#else
+    return SDL_PIXELFORMAT_ARGB1555;
+#endif
+}
+
+static const SDL_FPoint *get_dialogue_layout(void)
+{
+    // 141 glyph cells: four short rows beside the portrait, three long ones below.
+    static const int row_length[7] = { 18, 18, 18, 18, 23, 23, 23 };
+    static SDL_FPoint cell[141];
+    static bool is_laid_out = false;
+
+    if (!is_laid_out)
     {
-        if (ui->digits)
+        int index = 0;
+        for (int row = 0; row < 7; row += 1)
         {
-            SDL_DestroyTexture(ui->digits);
-            ui->digits = NULL;
+            for (int column = 0; column < row_length[row]; column += 1)
+            {
+                cell[index].x = (float)((row < 4 ? 42 : 7) + (column * 7));
+                cell[index].y = (float)(6 + (row * 9));
+                index += 1;
+            }
         }
+        is_laid_out = true;
+    }
 
-        if (ui->surface)
+    return cell;
+}
+
+static bool build_dialogue(dialogue_t *entry, const char *text, int portrait_x, int portrait_y, overlay_t *ui, SDL_Renderer *renderer)
+{
+    const SDL_FPoint *cell = get_dialogue_layout();
+    SDL_FRect src_f;
+    SDL_FRect dst_f;
+
+    if (!entry->canvas)
+    {
+        entry->canvas = SDL_CreateTexture(renderer, get_canvas_format(), SDL_TEXTUREACCESS_TARGET, 176, 72);
+        if (!entry->canvas)
         {
-            SDL_DestroyTexture(ui->surface);
-            ui->surface = NULL;
+            SDL_Log("Error creating dialogue texture: %s", SDL_GetError());
+            return false;
         }
+        SDL_SetTextureScaleMode(entry->canvas, SDL_SCALEMODE_NEAREST);
+    }
+
+    SDL_SetRenderTarget(renderer, entry->canvas);
+
+    // Empty dialogue box.
+    src_f.x = 0.f;
+    src_f.y = 74.f;
+    src_f.w = 176.f;
+    src_f.h = 72.f;
+    dst_f.x = 0.f;
+    dst_f.y = 0.f;
+    dst_f.w = 176.f;
+    dst_f.h = 72.f;
+    SDL_RenderTexture(renderer, ui->surface, &src_f, &dst_f);
 
-        if (ui->dialogue_canvas)
+    // Draw portrait.
+    src_f.x = (float)portrait_x;
+    src_f.y = (float)portrait_y;
+    src_f.w = 31.f;
+    src_f.h = 31.f;
+    dst_f.x = 7.f;
+    dst_f.y = 7.f;
+    dst_f.w = 31.f;
+    dst_f.h = 31.f;
+    SDL_RenderTexture(renderer, ui->surface, &src_f, &dst_f);
+
+    // The empty box matches the space glyph, so only visible glyphs are drawn.
+    src_f.w = 7.f;
+    src_f.h = 9.f;
+    dst_f.w = 7.f;
+    dst_f.h = 9.f;
+    for (int index = 0; index < 141 && text[index] != '\0'; index += 1)
+    {
+        int char_pos_x, char_pos_y;
+
+        if (' ' == text[index] || DIALOGUE_HIDDEN_CELL == index)
         {
-            SDL_DestroyTexture(ui->dialogue_canvas);
-            ui->dialogue_canvas = NULL;
+            continue;
         }
 
-        if (ui->menu_canvas)
+        get_character_position(text[index], &char_pos_x, &char_pos_y);
+        src_f.x = (float)char_pos_x;
+        src_f.y = (float)char_pos_y;
+        dst_f.x = cell[index].x;
+        dst_f.y = cell[index].y;
+        SDL_RenderTexture(renderer, ui->surface, &src_f, &dst_f);
+    }
+
+    SDL_SetRenderTarget(renderer, NULL);
+
+    entry->portrait_x = portrait_x;
+    entry->portrait_y = portrait_y;
+
+    return true;
+}
+
+static dialogue_t *get_dialogue(const char *text, int portrait_x, int portrait_y, overlay_t *ui, SDL_Renderer *renderer)
+{
+    Uint64 hash = generate_hash((const unsigned char *)text);
+    dialogue_t *victim = NULL;
+
+    ui->dialogue_clock += 1;
+
+    for (int index = 0; index < DIALOGUE_CACHE; index += 1)
+    {
+        dialogue_t *entry = &ui->dialogue[index];
+
+        if (entry->canvas && entry->hash == hash && entry->portrait_x == portrait_x && entry->portrait_y == portrait_y)
         {
-            SDL_DestroyTexture(ui->menu_canvas);
-            ui->menu_canvas = NULL;
+            entry->last_used = ui->dialogue_clock;
+            return entry;
         }
 
-        if (ui->life_count_canvas)
+        // The box on screen is pinned. Otherwise prefer an unused slot, then the least recently shown one.
+        if (entry->canvas && entry->canvas == ui->dialogue_canvas)
         {
-            SDL_DestroyTexture(ui->life_count_canvas);
-            ui->life_count_canvas = NULL;
+            continue;
         }
-
-        if (ui->coin_count_canvas)
+        if (victim && !victim->canvas)
         {
-            SDL_DestroyTexture(ui->coin_count_canvas);
-            ui->coin_count_canvas = NULL;
+            continue;
         }
+        if (!victim || !entry->canvas || entry->last_used < victim->last_used)
+        {
+            victim = entry;
+        }
+    }
 
-        SDL_free(ui);
+    if (!build_dialogue(victim, text, portrait_x, portrait_y, ui, renderer))
+    {
+        return NULL;
     }
+
+    victim->hash = hash;
+    victim->last_used = ui->dialogue_clock;
+
+    return victim;
 }
 
-bool load_overlay(map_t *map, overlay_t **ui, SDL_Renderer *renderer)
+static void init_widget(hud_widget_t *widget, float x, float y, float w, float h)
 {
-    *ui = (overlay_t *)SDL_calloc(1, sizeof(overlay_t));
-    if (!*ui)
+    widget->bounds.x = x;
+    widget->bounds.y = y;
+    widget->bounds.w = w;
+    widget->bounds.h = h;
+    widget->value = -1;
+    widget->is_dirty = true;
+}
+
+static void set_widget_value(hud_widget_t *widget, int value)
+{
+    if (widget->value != value)
     {
-        SDL_Log("Failed to allocate memory for overlay");
-        return false;
+        widget->value = value;
+        widget->is_dirty = true;
     }
+}
 
-#ifndef __DREAMCAST__
-    SDL_PixelFormat pixel_format = SDL_PIXELFORMAT_XRGB4444;
-#else
-    SDL_PixelFormat pixel_format = SDL_PIXELFORMAT_ARGB1555;
-#endif
+// Copy a region of overlay.png into a widget, relative to its bounds.
+static void draw_into_widget(const hud_widget_t *widget, overlay_t *ui, SDL_Renderer *renderer, float src_x, float src_y, float w, float h, float dst_x, float dst_y)
+{
+    SDL_FRect src_f = { .x = src_x, .y = src_y, .w = w, .h = h };
+    SDL_FRect dst_f = { .x = widget->bounds.x + dst_x, .y = widget->bounds.y + dst_y, .w = w, .h = h };
 
-    if (!load_texture_from_file("overlay.png", &(*ui)->surface, renderer))
+    SDL_RenderTexture(renderer, ui->surface, &src_f, &dst_f);
+}
+
+static void draw_digit(const hud_widget_t *widget, overlay_t *ui, SDL_Renderer *renderer, int digit, float dst_x)
+{
+    // Digits sit in one 80x8 strip at (58, 0).
+    draw_into_widget(widget, ui, renderer, (float)(58 + (digit * 8)), 0.f, 8.f, 8.f, dst_x, 4.f);
+}
+
+static void draw_coin_widget(overlay_t *ui, SDL_Renderer *renderer, int coins, int coins_max)
+{
+    const hud_widget_t *widget = &ui->widget[HUD_COINS];
+
+    draw_into_widget(widget, ui, renderer, 0.f, 0.f, 54.f, 16.f, 0.f, 0.f);
+    draw_digit(widget, ui, renderer, coins, 16.f);
+    draw_digit(widget, ui, renderer, coins_max, 42.f);
+}
+
+static void draw_life_widget(overlay_t *ui, SDL_Renderer *renderer, int life_count)
+{
+    const hud_widget_t *widget = &ui->widget[HUD_LIVES];
+
+    draw_into_widget(widget, ui, renderer, 139.f, 0.f, 37.f, 16.f, 0.f, 0.f);
+
+    if (life_count < 10)
     {
-        SDL_Log("Error loading overlay image");
-        return false;
+        draw_digit(widget, ui, renderer, life_count, 27.f);
+    }
+    else
+    {
+        draw_digit(widget, ui, renderer, (life_count / 10) % 10, 19.f);
+        draw_digit(widget, ui, renderer, life_count % 10, 27.f);
     }
+}
+
+static void draw_menu_widget(overlay_t *ui, SDL_Renderer *renderer, float sel_dst_y)
+{
+    const hud_widget_t *widget = &ui->widget[HUD_MENU];
 
-    // Helper macro: create TARGET texture and blit a region of the overlay into it.
-    // coin_count_canvas: 55x16
-    (*ui)->coin_count_canvas = SDL_CreateTexture(renderer, pixel_format, SDL_TEXTUREACCESS_TARGET, 55, 16);
-    if (!(*ui)->coin_count_canvas)
+    // Restore left border strip.
+    draw_into_widget(widget, ui, renderer, 81.f, 19.f, 13.f, 42.f, 2.f, 2.f);
+
+    if (ui->menu_selection != ui->prev_selection)
     {
-        SDL_Log("Error creating coin counter texture: %s", SDL_GetError());
-        return false;
+        draw_into_widget(widget, ui, renderer, (float)ui->menu_canvas_offset, 16.f, 96.f, 48.f, 0.f, 0.f);
     }
-    SDL_SetTextureScaleMode((*ui)->coin_count_canvas, SDL_SCALEMODE_NEAREST);
 
-    // life_count_canvas: 38x16
-    (*ui)->life_count_canvas = SDL_CreateTexture(renderer, pixel_format, SDL_TEXTUREACCESS_TARGET, 38, 16);
-    if (!(*ui)->life_count_canvas)
+    if (is_overclock_enabled() && ui->menu_selection >= MENU_MHZ)
     {
-        SDL_Log("Error creating life counter texture: %s", SDL_GetError());
-        return false;
+        draw_into_widget(widget, ui, renderer, 58.f, 8.f, 24.f, 8.f, 20.f, 4.f);
     }
-    SDL_SetTextureScaleMode((*ui)->life_count_canvas, SDL_SCALEMODE_NEAREST);
 
-    // menu_canvas: 96x48
-    (*ui)->menu_canvas = SDL_CreateTexture(renderer, pixel_format, SDL_TEXTUREACCESS_TARGET, 96, 48);
-    if (!(*ui)->menu_canvas)
+    ui->current_frame += 1;
+    if (ui->current_frame >= 12)
     {
-        SDL_Log("Error creating menu texture: %s", SDL_GetError());
-        return false;
+        ui->current_frame = 0;
     }
-    SDL_SetTextureScaleMode((*ui)->menu_canvas, SDL_SCALEMODE_NEAREST);
 
-    SDL_SetRenderTarget(renderer, (*ui)->menu_canvas);
-    SDL_FRect src_f = { .x = 0.f, .y = 16.f, .w = 96.f, .h = 48.f };
-    SDL_FRect dst_f = { .x = 0.f, .y = 0.f, .w = 96.f, .h = 48.f };
-    SDL_RenderTexture(renderer, (*ui)->surface, &src_f, &dst_f);
-    SDL_SetRenderTarget(renderer, NULL);
+    draw_into_widget(widget, ui, renderer, (float)(ui->current_frame * 14), 64.f, 14.f, 10.f, 2.f, sel_dst_y);
+}
 
-    // dialogue_canvas: 176x72
-    (*ui)->dialogue_canvas = SDL_CreateTexture(renderer, pixel_format, SDL_TEXTUREACCESS_TARGET, 176, 72);
-    if (!(*ui)->dialogue_canvas)
+void destroy_overlay(overlay_t *ui)
+{
+    if (ui)
     {
-        SDL_Log("Error creating dialogue texture: %s", SDL_GetError());
+        for (int index = 0; index < DIALOGUE_CACHE; index += 1)
+        {
+            if (ui->dialogue[index].canvas)
+            {
+                SDL_DestroyTexture(ui->dialogue[index].canvas);
+                ui->dialogue[index].canvas = NULL;
+            }
+        }
+        ui->dialogue_canvas = NULL;
+
+        if (ui->hud_atlas)
+        {
+            SDL_DestroyTexture(ui->hud_atlas);
+            ui->hud_atlas = NULL;
+        }
+
+        if (ui->surface)
+        {
+            SDL_DestroyTexture(ui->surface);
+            ui->surface = NULL;
+        }
+
+        SDL_free(ui);
+    }
+}
+
+bool load_overlay(map_t *map, overlay_t **ui, SDL_Renderer *renderer)
+{
+    *ui = (overlay_t *)SDL_calloc(1, sizeof(overlay_t));
+    if (!*ui)
+    {
+        SDL_Log("Failed to allocate memory for overlay");
         return false;
     }
-    SDL_SetTextureScaleMode((*ui)->dialogue_canvas, SDL_SCALEMODE_NEAREST);
 
-    SDL_SetRenderTarget(renderer, (*ui)->dialogue_canvas);
-    src_f.x = 0.f;
-    src_f.y = 74.f;
-    src_f.w = 176.f;
-    src_f.h = 72.f;
-    dst_f.w = 176.f;
-    dst_f.h = 72.f;
-    SDL_RenderTexture(renderer, (*ui)->surface, &src_f, &dst_f);
-    SDL_SetRenderTarget(renderer, NULL);
+    // Headless: menu state only, nothing to draw into.
+    if (!renderer)
+    {
+        return true;
+    }
 
-    // digits: 80x8 sub-texture
-    (*ui)->digits = SDL_CreateTexture(renderer, pixel_format, SDL_TEXTUREACCESS_TARGET, 80, 8);
-    if (!(*ui)->digits)
+    if (!load_texture_from_file("overlay.png", &(*ui)->surface, renderer))
     {
-        SDL_Log("Error creating digits texture: %s", SDL_GetError());
+        SDL_Log("Error loading overlay image");
         return false;
     }
-    SDL_SetTextureScaleMode((*ui)->digits, SDL_SCALEMODE_NEAREST);
 
-    SDL_SetRenderTarget(renderer, (*ui)->digits);
-    src_f.x = 58.f;
-    src_f.y = 0.f;
-    src_f.w = 80.f;
-    src_f.h = 8.f;
-    dst_f.x = 0.f;
-    dst_f.y = 0.f;
-    dst_f.w = 80.f;
-    dst_f.h = 8.f;
-    SDL_RenderTexture(renderer, (*ui)->surface, &src_f, &dst_f);
+    // HUD atlas: 96x64, coin counter and life counter on top, menu below.
+    (*ui)->hud_atlas = SDL_CreateTexture(renderer, get_canvas_format(), SDL_TEXTUREACCESS_TARGET, 96, 64);
+    if (!(*ui)->hud_atlas)
+    {
+        SDL_Log("Error creating HUD texture: %s", SDL_GetError());
+        return false;
+    }
+    SDL_SetTextureScaleMode((*ui)->hud_atlas, SDL_SCALEMODE_NEAREST);
+
+    init_widget(&(*ui)->widget[HUD_COINS], 0.f, 0.f, 55.f, 16.f);
+    init_widget(&(*ui)->widget[HUD_LIVES], 55.f, 0.f, 38.f, 16.f);
+    init_widget(&(*ui)->widget[HUD_MENU], 0.f, 16.f, 96.f, 48.f);
+
+    SDL_SetRenderTarget(renderer, (*ui)->hud_atlas);
+    draw_into_widget(&(*ui)->widget[HUD_MENU], *ui, renderer, 0.f, 16.f, 96.f, 48.f, 0.f, 0.f);
     SDL_SetRenderTarget(renderer, NULL);
+    (*ui)->widget[HUD_MENU].is_dirty = false;
 
-    return true;
+    return prepare_dialogue(map, *ui, renderer);
 }
 
-bool render_overlay(int coins_left, int coins_max, int life_count, map_t *map, overlay_t *ui, SDL_Renderer *renderer)
+bool render_overlay(int coins_left, int coins_max, int life_count, bool is_paused, map_t *map, overlay_t *ui, SDL_Renderer *renderer)
 {
+    if (!renderer)
+    {
+        return true;
+    }
+
     ui->time_b = ui->time_a;
-    ui->time_a = SDL_GetTicks();
+    ui->time_a = get_ticks();
     ui->delta_time = (ui->time_a > ui->time_b)
                          ? ui->time_a - ui->time_b
                          : ui->time_b - ui->time_a;
@@ -209,91 +383,14 @@ bool render_overlay(int coins_left, int coins_max, int life_count, map_t *map, o
         life_count = 0;
     }
 
-    SDL_FRect src_f;
-    SDL_FRect dst_f;
-
-    // --- coin_count_canvas ---
-    SDL_SetRenderTarget(renderer, ui->coin_count_canvas);
-
-    src_f.x = 0.f;
-    src_f.y = 0.f;
-    src_f.w = 54.f;
-    src_f.h = 16.f;
-    dst_f.x = 0.f;
-    dst_f.y = 0.f;
-    dst_f.w = 54.f;
-    dst_f.h = 16.f;
-    SDL_RenderTexture(renderer, ui->surface, &src_f, &dst_f);
-
     int coins = coins_max - coins_left;
-    src_f.x = (float)(coins * 8);
-    src_f.y = 0.f;
-    src_f.w = 8.f;
-    src_f.h = 8.f;
-    dst_f.x = 16.f;
-    dst_f.y = 4.f;
-    dst_f.w = 8.f;
-    dst_f.h = 8.f;
-    SDL_RenderTexture(renderer, ui->digits, &src_f, &dst_f);
-
-    src_f.x = (float)(coins_max * 8);
-    dst_f.x = 42.f;
-    dst_f.y = 4.f;
-    SDL_RenderTexture(renderer, ui->digits, &src_f, &dst_f);
-
-    SDL_SetRenderTarget(renderer, NULL);
-
-    // --- life_count_canvas ---
-    SDL_SetRenderTarget(renderer, ui->life_count_canvas);
-
-    src_f.x = 139.f;
-    src_f.y = 0.f;
-    src_f.w = 37.f;
-    src_f.h = 16.f;
-    dst_f.x = 0.f;
-    dst_f.y = 0.f;
-    dst_f.w = 37.f;
-    dst_f.h = 16.f;
-    SDL_RenderTexture(renderer, ui->surface, &src_f, &dst_f);
-
-    if (life_count < 10)
-    {
-        src_f.x = (float)(life_count * 8);
-        src_f.y = 0.f;
-        src_f.w = 8.f;
-        src_f.h = 8.f;
-        dst_f.x = 27.f;
-        dst_f.y = 4.f;
-        dst_f.w = 8.f;
-        dst_f.h = 8.f;
-        SDL_RenderTexture(renderer, ui->digits, &src_f, &dst_f);
-    }
-    else
-    {
-        int life_first_digit = (life_count / 10) % 10;
-        int life_second_digit = life_count % 10;
-
-        src_f.x = (float)(life_first_digit * 8);
-        src_f.y = 0.f;
-        src_f.w = 8.f;
-        src_f.h = 8.f;
-        dst_f.x = 19.f;
-        dst_f.y = 4.f;
-        dst_f.w = 8.f;
-        dst_f.h = 8.f;
-        SDL_RenderTexture(renderer, ui->digits, &src_f, &dst_f);
-
-        src_f.x = (float)(life_second_digit * 8);
-        dst_f.x = 27.f;
-        SDL_RenderTexture(renderer, ui->digits, &src_f, &dst_f);
-    }
+    set_widget_value(&ui->widget[HUD_COINS], (coins * 10) + coins_max);
+    set_widget_value(&ui->widget[HUD_LIVES], life_count);
 
-    SDL_SetRenderTarget(renderer, NULL);
-
-    // --- menu_canvas ---
-    if (ui->menu_selection)
+    // The menu only animates while it is on screen.
+    float sel_dst_y = 4.f;
+    if (is_paused && ui->menu_selection)
     {
-        float sel_dst_y = 4.f;
         switch (ui->menu_selection)
         {
             default:
@@ -319,69 +416,55 @@ bool render_overlay(int coins_left, int coins_max, int life_count, map_t *map, o
                 break;
         }
 
+        set_widget_value(&ui->widget[HUD_MENU], ui->menu_selection);
+
         ui->time_since_last_frame += ui->delta_time;
         if (ui->time_since_last_frame >= (1000 / ANIM_FPS))
         {
-            SDL_SetRenderTarget(renderer, ui->menu_canvas);
-
-            // Restore left border strip.
-            src_f.x = 81.f;
-            src_f.y = 19.f;
-            src_f.w = 13.f;
-            src_f.h = 42.f;
-            dst_f.x = 2.f;
-            dst_f.y = 2.f;
-            dst_f.w = 13.f;
-            dst_f.h = 42.f;
-            SDL_RenderTexture(renderer, ui->surface, &src_f, &dst_f);
-
-            if (ui->menu_selection != ui->prev_selection)
-            {
-                src_f.x = (float)ui->menu_canvas_offset;
-                src_f.y = 16.f;
-                src_f.w = 96.f;
-                src_f.h = 48.f;
-                dst_f.x = 0.f;
-                dst_f.y = 0.f;
-                dst_f.w = 96.f;
-                dst_f.h = 48.f;
-                SDL_RenderTexture(renderer, ui->surface, &src_f, &dst_f);
-            }
+            ui->time_since_last_frame = 0;
+            ui->widget[HUD_MENU].is_dirty = true;
+        }
+    }
 
-            if (is_overclock_enabled() && ui->menu_selection >= MENU_MHZ)
-            {
-                src_f.x = 58.f;
-                src_f.y = 8.f;
-                src_f.w = 24.f;
-                src_f.h = 8.f;
-                dst_f.x = 20.f;
-                dst_f.y = 4.f;
-                dst_f.w = 24.f;
-                dst_f.h = 8.f;
-                SDL_RenderTexture(renderer, ui->surface, &src_f, &dst_f);
-            }
+    bool any_dirty = false;
+    for (int index = 0; index < HUD_WIDGET_COUNT; index += 1)
+    {
+        any_dirty = any_dirty || ui->widget[index].is_dirty;
+    }
 
-            ui->time_since_last_frame = 0;
-            ui->current_frame += 1;
-            if (ui->current_frame >= 12)
-            {
-                ui->current_frame = 0;
-            }
+    trace_stats.hud_updates += 1;
+    if (!any_dirty)
+    {
+        return true;
+    }
 
-            src_f.x = (float)(ui->current_frame * 14);
-            src_f.y = 64.f;
-            src_f.w = 14.f;
-            src_f.h = 10.f;
-            dst_f.x = 2.f;
-            dst_f.y = sel_dst_y;
-            dst_f.w = 14.f;
-            dst_f.h = 10.f;
-            SDL_RenderTexture(renderer, ui->surface, &src_f, &dst_f);
-
-            SDL_SetRenderTarget(renderer, NULL);
-        }
+    // One target switch for all stale widgets, none when nothing changed.
+    Uint64 target_switches = trace_stats.target_switches;
+    SDL_SetRenderTarget(renderer, ui->hud_atlas);
+
+    if (ui->widget[HUD_COINS].is_dirty)
+    {
+        draw_coin_widget(ui, renderer, coins, coins_max);
+        ui->widget[HUD_COINS].is_dirty = false;
+    }
+
+    if (ui->widget[HUD_LIVES].is_dirty)
+    {
+        draw_life_widget(ui, renderer, life_count);
+        ui->widget[HUD_LIVES].is_dirty = false;
+    }
+
+    if (ui->widget[HUD_MENU].is_dirty)
+    {
+        draw_menu_widget(ui, renderer, sel_dst_y);
+        ui->widget[HUD_MENU].is_dirty = false;
     }
 
+    SDL_SetRenderTarget(renderer, NULL);
+
+    // Counted by the renderer wrappers in trace.h, so only benchmark builds see a change.
+    trace_stats.hud_target_switches += trace_stats.target_switches - target_switches;
+
     return true;
 }
 
@@ -397,101 +480,46 @@ bool render_text(const char *text, bool alt_portrait, map_t *map, overlay_t *ui,
     }
 }
 
-bool render_text_ex(const char *text, bool alt_portrait, int portrait_x, int portrait_y, map_t *map, overlay_t *ui, SDL_Renderer *renderer)
+bool prepare_dialogue(map_t *map, overlay_t *ui, SDL_Renderer *renderer)
 {
-    const int char_width = 7;
-    const int char_height = 9;
-    const int start_x_row_0_to_3 = 42;
-    const int start_x_row_4_to_6 = 7;
-    const int start_y = 6;
-    const int line_height = 9;
-
-    SDL_FRect src_f;
-    SDL_FRect dst_f;
-
-    SDL_SetRenderTarget(renderer, ui->dialogue_canvas);
-
-    // Draw portrait.
-    src_f.x = (float)portrait_x;
-    src_f.y = (float)portrait_y;
-    src_f.w = 31.f;
-    src_f.h = 31.f;
-    dst_f.x = 7.f;
-    dst_f.y = 7.f;
-    dst_f.w = 31.f;
-    dst_f.h = 31.f;
-    SDL_RenderTexture(renderer, ui->surface, &src_f, &dst_f);
-
-    src_f.w = (float)char_width;
-    src_f.h = (float)char_height;
-    dst_f.x = (float)start_x_row_0_to_3;
-    dst_f.y = (float)start_y;
-    dst_f.w = (float)char_width;
-    dst_f.h = (float)char_height;
-
-    int index = 0;
-    int char_index = 0;
-    int char_pos_x, char_pos_y;
+    if (!renderer)
+    {
+        return true;
+    }
 
-    while (index < 141)
+    // Lay out the level's block texts up front, so touching one mid-jump costs a single blit.
+    // Only as many as leave a slot for the box on screen; the rest are laid out when shown,
+    // rather than evicting the ones prepared just before them.
+    int prepared = 0;
+    for (int index = 0; index < map->obj_count && prepared < DIALOGUE_CACHE - 1; index += 1)
     {
-        if (text[char_index] != '\0')
-        {
-            get_character_position(text[char_index], &char_pos_x, &char_pos_y);
-            char_index++;
-        }
-        else
+        if (map->obj[index].str)
         {
-            char_pos_x = 64;
-            char_pos_y = 146;
+            if (!get_dialogue(map->obj[index].str, BLOCK_PORTRAIT_X, BLOCK_PORTRAIT_Y, ui, renderer))
+            {
+                return false;
+            }
+            prepared += 1;
         }
+    }
 
-        src_f.x = (float)char_pos_x;
-        src_f.y = (float)char_pos_y;
-        SDL_RenderTexture(renderer, ui->surface, &src_f, &dst_f);
-
-        index++;
-
-        int row = 0;
-        if (index > 117)
-        {
-            row = 6;
-        }
-        else if (index > 93)
-        {
-            row = 5;
-        }
-        else if (index > 71)
-        {
-            row = 4;
-        }
-        else if (index > 53)
-        {
-            row = 3;
-        }
-        else if (index > 35)
-        {
-            row = 2;
-        }
-        else if (index > 17)
-        {
-            row = 1;
-        }
+    return true;
+}
 
-        dst_f.y = (float)(start_y + row * line_height);
+bool render_text_ex(const char *text, bool alt_portrait, int portrait_x, int portrait_y, map_t *map, overlay_t *ui, SDL_Renderer *renderer)
+{
+    if (!renderer)
+    {
+        return true;
+    }
 
-        if (index == 18 || index == 36 || index == 54 ||
-            index == 72 || index == 95 || index == 118)
-        {
-            dst_f.x = (float)(row < 4 ? start_x_row_0_to_3 : start_x_row_4_to_6);
-        }
-        else
-        {
-            dst_f.x += (float)char_width;
-        }
+    dialogue_t *entry = get_dialogue(text, portrait_x, portrait_y, ui, renderer);
+    if (!entry)
+    {
+        return false;
     }
 
-    SDL_SetRenderTarget(renderer, NULL);
+    ui->dialogue_canvas = entry->canvas;
 
     return true;
 }
@@ -13,8 +13,12 @@
 
 #include <SDL3/SDL.h>
 
+#include "config.h"
 #include "map.h"
 
+#define BLOCK_PORTRAIT_X 640
+#define BLOCK_PORTRAIT_Y 146
+
 typedef enum menu_selection
 {
     MENU_NONE = 0,
@@ -26,15 +30,47 @@ typedef enum menu_selection
 
 } menu_selection_t;
 
+typedef enum hud_widget_id
+{
+    HUD_COINS = 0,
+    HUD_LIVES,
+    HUD_MENU,
+    HUD_WIDGET_COUNT
+
+} hud_widget_id_t;
+
+// One retained HUD element: its region in the shared atlas and whether it is stale.
+typedef struct hud_widget
+{
+    SDL_FRect bounds;
+    int value; // Last value drawn; -1 until the first draw.
+    bool is_dirty;
+
+} hud_widget_t;
+
+// A dialogue box with its text already laid out, keyed by string and portrait.
+typedef struct dialogue
+{
+    SDL_Texture *canvas;
+    Uint64 hash;
+    Uint64 last_used;
+    int portrait_x;
+    int portrait_y;
+
+} dialogue_t;
+
 typedef struct overlay
 {
     SDL_Texture *surface; // overlay.png as GPU texture
-    SDL_Texture *digits;
 
-    SDL_Texture *coin_count_canvas;
-    SDL_Texture *life_count_canvas;
-    SDL_Texture *menu_canvas;
-    SDL_Texture *dialogue_canvas;
+    // Coin counter, life counter and pause menu share one render target.
+    SDL_Texture *hud_atlas;
+    hud_widget_t widget[HUD_WIDGET_COUNT];
+
+    SDL_Texture *dialogue_canvas; // Points into dialogue[]; not owned.
+
+    dialogue_t dialogue[DIALOGUE_CACHE];
+    Uint64 dialogue_clock;
 
     menu_selection_t prev_selection;
     menu_selection_t menu_selection;
@@ -47,20 +83,13 @@ typedef struct overlay
     int menu_canvas_offset;
     bool is_settings_menu;
 
-#if defined(__SYMBIAN32__)
-    // Dirty flags to track which UI elements need redraw.
-    bool coin_count_dirty;
-    bool life_count_dirty;
-    bool menu_dirty;
-    bool dialogue_dirty;
-#endif
-
 } overlay_t;
 
 void destroy_overlay(overlay_t *ui);
 bool load_overlay(map_t *map, overlay_t **ui, SDL_Renderer *renderer);
-bool render_overlay(int coins_left, int coins_max, int life_count, map_t *map, overlay_t *ui, SDL_Renderer *renderer);
+bool render_overlay(int coins_left, int coins_max, int life_count, bool is_paused, map_t *map, overlay_t *ui, SDL_Renderer *renderer);
 bool render_text(const char *text, bool alt_portrait, map_t *map, overlay_t *ui, SDL_Renderer *renderer);
+bool prepare_dialogue(map_t *map, overlay_t *ui, SDL_Renderer *renderer);
 bool render_text_ex(const char *text, bool alt_portrait, int portrait_x, int portrait_y, map_t *map, overlay_t *ui, SDL_Renderer *renderer);
 
 #endif // OVERLAY_H
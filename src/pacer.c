@@ -0,0 +1,101 @@
+/** @file pacer.c
+ *
+ *  A minimalist, cross-platform puzzle-platformer, designed
+ *  especially for the Nokia N-Gage.
+ *
+ *  Copyright (c) 2026, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <SDL3/SDL.h>
+
+#include "pacer.h"
+
+typedef enum pacer_mode
+{
+    PACER_ACTIVE = 0,
+    PACER_IDLE,
+    PACER_MODE_COUNT
+
+} pacer_mode_t;
+
+static Uint64 period[PACER_MODE_COUNT] = { 0 };
+static Uint64 deadline = 0;
+
+// Time spent updating and drawing versus wall time, for the CPU report.
+static Uint64 busy_ns[PACER_MODE_COUNT] = { 0 };
+static Uint64 wall_ns[PACER_MODE_COUNT] = { 0 };
+
+void init_pacer(int target_fps, int idle_fps)
+{
+    period[PACER_ACTIVE] = (target_fps > 0) ? SDL_NS_PER_SECOND / (Uint64)target_fps : 0;
+    period[PACER_IDLE] = (idle_fps > 0) ? SDL_NS_PER_SECOND / (Uint64)idle_fps : period[PACER_ACTIVE];
+    deadline = 0;
+
+    if (period[PACER_ACTIVE])
+    {
+        SDL_Log("Frame pacer: %d fps, %d fps while idle", target_fps, idle_fps > 0 ? idle_fps : target_fps);
+    }
+}
+
+void pace_frame(Uint64 frame_start, bool is_idle)
+{
+    pacer_mode_t mode = is_idle ? PACER_IDLE : PACER_ACTIVE;
+    Uint64 now = SDL_GetTicksNS();
+
+    busy_ns[mode] += now - frame_start;
+
+    if (!period[PACER_ACTIVE])
+    {
+        // Unpaced: the previous behaviour, kept for comparison runs.
+#if !defined __SYMBIAN32__
+        SDL_Delay(1);
+#endif
+        wall_ns[mode] += SDL_GetTicksNS() - frame_start;
+        return;
+    }
+
+    // An input event may wake an idle frame early; keep the deadline then.
+    if (now >= deadline)
+    {
+        deadline += period[mode];
+
+        // Resynchronise after a stall instead of rushing to catch up.
+        if (now >= deadline)
+        {
+            deadline = now + period[mode];
+        }
+    }
+
+    if (deadline > now)
+    {
+        if (is_idle)
+        {
+            // Nothing animates before the deadline, so sleep until it or the next input.
+            SDL_WaitEventTimeout(NULL, (Sint32)((deadline - now + SDL_NS_PER_MS - 1) / SDL_NS_PER_MS));
+        }
+        else
+        {
+            SDL_DelayPrecise(deadline - now);
+        }
+    }
+
+    wall_ns[mode] += SDL_GetTicksNS() - frame_start;
+}
+
+void report_pacer(void)
+{
+    static const char *mode_name[PACER_MODE_COUNT] = { "active", "idle" };
+
+    for (int mode = 0; mode < PACER_MODE_COUNT; mode += 1)
+    {
+        if (wall_ns[mode])
+        {
+            SDL_Log("CPU %-6s %5.1f%% busy over %.1f s",
+                    mode_name[mode],
+                    100.0 * (double)busy_ns[mode] / (double)wall_ns[mode],
+                    (double)wall_ns[mode] / SDL_NS_PER_SECOND);
+        }
+    }
+}
@@ -0,0 +1,20 @@
+/** @file pacer.h
+ *
+ *  A minimalist, cross-platform puzzle-platformer, designed
+ *  especially for the Nokia N-Gage.
+ *
+ *  Copyright (c) 2026, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#ifndef PACER_H
+#define PACER_H
+
+#include <SDL3/SDL.h>
+
+void init_pacer(int target_fps, int idle_fps);
+void pace_frame(Uint64 frame_start, bool is_idle);
+void report_pacer(void);
+
+#endif // PACER_H
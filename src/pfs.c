@@ -15,22 +15,47 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "pfs.h"
+
+#if !defined __EMSCRIPTEN__
+#include "zlib.h"
+#endif
+
 #define DATA_PATH_MAX_LEN 256
 
+// Each payload starts with a 32-bit word: the stored size in the low 24 bits,
+// the codec in the high 8 bits. Packs written before codecs existed read as stored.
+#define PFS_SIZE_MASK    0x00ffffff
+#define PFS_CODEC_SHIFT  24
+#define PFS_CODEC_HEADER 8 // Raw size and codec argument, ahead of encoded payloads.
+
+#define LZ_MIN_MATCH 4
+
 static char data_path[DATA_PATH_MAX_LEN];
 
+static const char *codec_name[PFS_CODEC_COUNT] = { "stored", "deflate", "lz" };
+
 void init_file_reader(void)
 {
     SDL_snprintf(data_path, DATA_PATH_MAX_LEN, "%sdata.pfs", SDL_GetBasePath());
 }
 
-size_t size_of_file(const char *path)
+typedef struct entry
 {
-    FILE *data_pack = fopen(data_path, "rb");
-    char buffer[80 + 1];
-    int32_t size = 0;
-    int32_t offset = 0;
+    int32_t offset;
+    uint32_t stored_size;
+    uint32_t raw_size;
+    uint32_t argument;
+    pfs_codec_t codec;
+
+} entry_t;
+
+// Leaves data_pack positioned at the first byte of the entry's (possibly encoded) data.
+static bool find_entry(FILE *data_pack, const char *path, entry_t *entry)
+{
+    char buffer[80 + 1] = { 0 };
     int16_t entries = 0;
+    uint32_t word = 0;
 
     fread(&entries, 2, 1, data_pack);
 
@@ -38,7 +63,7 @@ size_t size_of_file(const char *path)
     {
         uint8_t string_size = 0;
 
-        fread(&offset, 4, 1, data_pack);
+        fread(&entry->offset, 4, 1, data_pack);
         fread(&string_size, 1, 1, data_pack);
 
         if (string_size > 80)
@@ -47,113 +72,488 @@ size_t size_of_file(const char *path)
         }
 
         fread(&buffer, string_size + 1, 1, data_pack);
+        buffer[string_size] = '\0';
 
-        if (!SDL_strncmp(buffer, path, string_size))
+        if (!SDL_strcmp(buffer, path))
         {
             goto found;
         }
     }
 
+    return false;
+
 found:
-    if (offset == 0)
+    if (entry->offset == 0)
     {
         printf("failed to load %s\n", path);
         exit(-1);
     }
 
-    fseek(data_pack, offset, SEEK_SET);
-    fread(&size, 4, 1, data_pack);
-    fclose(data_pack);
+    fseek(data_pack, entry->offset, SEEK_SET);
+    fread(&word, 4, 1, data_pack);
+
+    entry->stored_size = word & PFS_SIZE_MASK;
+    entry->codec = (pfs_codec_t)(word >> PFS_CODEC_SHIFT);
+    entry->raw_size = entry->stored_size;
+    entry->argument = 0;
 
-    return size;
+    if (entry->codec != PFS_STORED)
+    {
+        if (entry->stored_size < PFS_CODEC_HEADER)
+        {
+            return false;
+        }
+        fread(&entry->raw_size, 4, 1, data_pack);
+        fread(&entry->argument, 4, 1, data_pack);
+        entry->stored_size -= PFS_CODEC_HEADER;
+    }
+
+    return true;
 }
 
-uint8_t *load_binary_file_from_path(const char *path)
+// Byte-oriented LZ77: a token holds literal and match lengths (4 bits each, 15 continues
+// in 255-runs), then the literals, then a 16-bit match offset. The stream may sit at the
+// end of the output buffer and decode over itself; the packer stores the margin needed.
+static bool decode_lz(const Uint8 *src, size_t src_size, Uint8 *dst, size_t dst_size)
 {
-    FILE *data_pack = fopen(data_path, "rb");
-    int32_t offset = 0;
-    int16_t entries = 0;
-    char buffer[80 + 1] = { 0 };
-    int32_t size = 0;
-    uint8_t *to_return;
+    const Uint8 *ip = src;
+    const Uint8 *ip_end = src + src_size;
+    Uint8 *op = dst;
+    Uint8 *op_end = dst + dst_size;
 
-    fread(&entries, 2, 1, data_pack);
+    while (ip < ip_end)
+    {
+        unsigned int token = *ip++;
+        size_t length = token >> 4;
 
-    for (int c = 0; c < entries; ++c)
+        if (15 == length)
+        {
+            unsigned int step;
+            do
+            {
+                if (ip >= ip_end)
+                {
+                    return false;
+                }
+                step = *ip++;
+                length += step;
+            } while (255 == step);
+        }
+
+        if (length > (size_t)(ip_end - ip) || length > (size_t)(op_end - op))
+        {
+            return false;
+        }
+
+        // Decoding in place, the output trails the input, so this may overlap.
+        SDL_memmove(op, ip, length);
+        op += length;
+        ip += length;
+
+        // The last sequence carries literals only.
+        if (ip >= ip_end)
+        {
+            break;
+        }
+
+        if (ip_end - ip < 2)
+        {
+            return false;
+        }
+
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+
+        length = (token & 15) + LZ_MIN_MATCH;
+        if (15 + LZ_MIN_MATCH == length)
+        {
+            unsigned int step;
+            do
+            {
+                if (ip >= ip_end)
+                {
+                    return false;
+                }
+                step = *ip++;
+                length += step;
+            } while (255 == step);
+        }
+
+        if (0 == offset || offset > (size_t)(op - dst) || length > (size_t)(op_end - op))
+        {
+            return false;
+        }
+
+        const Uint8 *match = op - offset;
+        if (offset >= length)
+        {
+            SDL_memcpy(op, match, length);
+            op += length;
+        }
+        else
+        {
+            // Overlapping match: repeats the last offset bytes.
+            while (length--)
+            {
+                *op++ = *match++;
+            }
+        }
+    }
+
+    return op == op_end;
+}
+
+#if !defined __EMSCRIPTEN__
+// One inflate state per thread, reset between streams so its window and tables are reused.
+static SDL_TLSID inflate_stream;
+
+static voidpf alloc_zlib(voidpf opaque, uInt items, uInt size)
+{
+    return SDL_malloc((size_t)items * size);
+}
+
+static void free_zlib(voidpf opaque, voidpf address)
+{
+    SDL_free(address);
+}
+
+static void SDLCALL destroy_inflate_stream(void *value)
+{
+    z_stream *stream = (z_stream *)value;
+
+    inflateEnd(stream);
+    SDL_free(stream);
+}
+
+static z_stream *get_inflate_stream(int window_bits)
+{
+    z_stream *stream = (z_stream *)SDL_GetTLS(&inflate_stream);
+    if (stream)
     {
-        int8_t string_size = 0;
+        return (inflateReset2(stream, window_bits) == Z_OK) ? stream : NULL;
+    }
 
-        fread(&offset, 4, 1, data_pack);
-        fread(&string_size, 1, 1, data_pack);
+    stream = (z_stream *)SDL_calloc(1, sizeof(z_stream));
+    if (!stream)
+    {
+        return NULL;
+    }
 
-        if (string_size > 80)
+    stream->zalloc = alloc_zlib;
+    stream->zfree = free_zlib;
+    if (inflateInit2(stream, window_bits) != Z_OK)
+    {
+        SDL_free(stream);
+        return NULL;
+    }
+
+    if (!SDL_SetTLS(&inflate_stream, stream, destroy_inflate_stream))
+    {
+        destroy_inflate_stream(stream);
+        return NULL;
+    }
+    return stream;
+}
+
+uint8_t *inflate_buffer(const uint8_t *src, size_t src_size, size_t size_hint, size_t *out_size, pfs_wrap_t wrap)
+{
+    static const int window_bits[PFS_WRAP_COUNT] = { -MAX_WBITS, MAX_WBITS, 16 + MAX_WBITS };
+
+    if (wrap >= PFS_WRAP_COUNT)
+    {
+        return NULL;
+    }
+
+    z_stream *stream = get_inflate_stream(window_bits[wrap]);
+    if (!stream)
+    {
+        SDL_Log("Failed to set up inflate stream");
+        return NULL;
+    }
+
+    size_t capacity = size_hint ? size_hint : src_size * 3 + 1;
+    size_t size = 0;
+    uint8_t *output = (uint8_t *)SDL_malloc(capacity);
+    if (!output)
+    {
+        return NULL;
+    }
+
+    stream->next_in = (Bytef *)src;
+    stream->avail_in = (uInt)src_size;
+
+    int ret;
+    do
+    {
+        if (size == capacity)
         {
-            string_size = 80;
+            // The hint was short: grow by half rather than by a fixed chunk.
+            capacity += capacity / 2 + 1;
+            uint8_t *grown = (uint8_t *)SDL_realloc(output, capacity);
+            if (!grown)
+            {
+                SDL_free(output);
+                return NULL;
+            }
+            output = grown;
         }
 
-        fread(&buffer, string_size + 1, 1, data_pack);
+        stream->next_out = output + size;
+        stream->avail_out = (uInt)(capacity - size);
+
+        ret = inflate(stream, Z_NO_FLUSH);
+        size = capacity - stream->avail_out;
 
-        if (!SDL_strncmp(buffer, path, string_size))
+        // Out of input with room to spare means the stream is truncated.
+        if ((ret != Z_OK && ret != Z_STREAM_END && !(Z_BUF_ERROR == ret && size == capacity)) ||
+            (Z_OK == ret && 0 == stream->avail_in && size < capacity))
         {
-            goto found;
+            SDL_Log("inflate failed with code: %d", ret);
+            SDL_free(output);
+            return NULL;
+        }
+    } while (ret != Z_STREAM_END);
+
+    *out_size = size;
+    return output;
+}
+#endif
+
+static uint8_t *read_entry(FILE *data_pack, const entry_t *entry)
+{
+    uint8_t *to_return = NULL;
+
+    switch (entry->codec)
+    {
+        case PFS_STORED:
+            to_return = (uint8_t *)SDL_calloc(1, entry->stored_size);
+            if (to_return)
+            {
+                fread(to_return, sizeof(uint8_t), entry->stored_size, data_pack);
+            }
+            return to_return;
+
+        case PFS_LZ:
+        {
+            // One allocation: the encoded data is read into its tail and decoded in place.
+            size_t capacity = entry->raw_size + entry->argument;
+            if (capacity < entry->stored_size)
+            {
+                return NULL;
+            }
+
+            to_return = (uint8_t *)SDL_malloc(capacity ? capacity : 1);
+            if (!to_return)
+            {
+                return NULL;
+            }
+
+            uint8_t *src = to_return + capacity - entry->stored_size;
+            if (fread(src, 1, entry->stored_size, data_pack) != entry->stored_size ||
+                !decode_lz(src, entry->stored_size, to_return, entry->raw_size))
+            {
+                SDL_free(to_return);
+                return NULL;
+            }
+            return to_return;
         }
+
+#if !defined __EMSCRIPTEN__
+        case PFS_DEFLATE:
+        {
+            uint8_t *src = (uint8_t *)SDL_malloc(entry->stored_size ? entry->stored_size : 1);
+            size_t raw_size = 0;
+
+            if (src && fread(src, 1, entry->stored_size, data_pack) == entry->stored_size)
+            {
+                to_return = inflate_buffer(src, entry->stored_size, entry->raw_size, &raw_size, PFS_WRAP_ZLIB);
+            }
+            SDL_free(src);
+
+            if (to_return && raw_size != entry->raw_size)
+            {
+                SDL_free(to_return);
+                to_return = NULL;
+            }
+            return to_return;
+        }
+#endif
+
+        default:
+            return NULL;
     }
+}
 
-    return NULL;
+size_t size_of_file(const char *path)
+{
+    FILE *data_pack = fopen(data_path, "rb");
+    entry_t entry;
 
-found:
-    if (offset == 0)
+    if (!find_entry(data_pack, path, &entry))
     {
         printf("failed to load %s\n", path);
         exit(-1);
     }
+    fclose(data_pack);
 
-    fseek(data_pack, offset, SEEK_SET);
+    // The decoded size: what load_binary_file_from_path hands out.
+    return entry.raw_size;
+}
+
+uint8_t *load_binary_file_from_path(const char *path)
+{
+    FILE *data_pack = fopen(data_path, "rb");
+    entry_t entry;
+    uint8_t *to_return;
 
-    fread(&size, 4, 1, data_pack);
-    to_return = (uint8_t *)SDL_calloc(1, size);
+    if (!find_entry(data_pack, path, &entry))
+    {
+        fclose(data_pack);
+        return NULL;
+    }
 
-    fread(to_return, sizeof(uint8_t), size, data_pack);
+    to_return = read_entry(data_pack, &entry);
     fclose(data_pack);
 
+    if (!to_return)
+    {
+        SDL_Log("Couldn't decode %s (%s)", path, entry.codec < PFS_CODEC_COUNT ? codec_name[entry.codec] : "unknown codec");
+    }
+
     return to_return;
 }
 
 FILE *open_binary_file_from_path(const char *path)
 {
     FILE *data_pack = fopen(data_path, "rb");
-    int32_t offset = 0;
+    entry_t entry;
+
+    if (!find_entry(data_pack, path, &entry))
+    {
+        fclose(data_pack);
+        return NULL;
+    }
+
+    // Streaming reads the payload as it sits in the pack.
+    if (entry.codec != PFS_STORED)
+    {
+        SDL_Log("%s is encoded and can't be streamed", path);
+        fclose(data_pack);
+        return NULL;
+    }
+
+    return data_pack;
+}
+
+#if defined BENCHMARK
+bool for_each_entry(pfs_entry_callback callback, void *userdata)
+{
+    FILE *data_pack = fopen(data_path, "rb");
+    char name[80 + 1] = { 0 };
     int16_t entries = 0;
-    char buffer[85];
-    int32_t size = 0;
+    bool exit_code = true;
 
+    if (!data_pack)
+    {
+        SDL_Log("Couldn't open %s", data_path);
+        return false;
+    }
     fread(&entries, 2, 1, data_pack);
 
-    for (int c = 0; c < entries; ++c)
+    // Directory entries are read one by one; the callback opens the pack itself, as the game does.
+    for (int c = 0; c < entries && exit_code; ++c)
     {
-        int8_t string_size = 0;
+        int32_t offset = 0;
+        uint8_t string_size = 0;
 
         fread(&offset, 4, 1, data_pack);
         fread(&string_size, 1, 1, data_pack);
-        fread(&buffer, string_size + 1, 1, data_pack);
+        if (string_size > 80)
+        {
+            string_size = 80;
+        }
+        fread(name, string_size + 1, 1, data_pack);
+        name[string_size] = '\0';
+
+        exit_code = callback(name, userdata);
+    }
+    fclose(data_pack);
+
+    return exit_code;
+}
+
+typedef struct archive_bench
+{
+    int runs;
+    Uint64 stored_total;
+    Uint64 raw_total;
+    Uint64 time_total;
 
-        if (!strcmp(buffer, path))
+} archive_bench_t;
+
+static bool benchmark_entry(const char *name, void *userdata)
+{
+    archive_bench_t *bench = (archive_bench_t *)userdata;
+    entry_t entry;
+
+    FILE *probe = fopen(data_path, "rb");
+    if (!probe || !find_entry(probe, name, &entry))
+    {
+        if (probe)
         {
-            goto found;
+            fclose(probe);
         }
+        return false;
     }
+    fclose(probe);
 
-    return NULL;
+    Uint64 best = SDL_MAX_UINT64;
+    for (int run = 0; run < bench->runs; run += 1)
+    {
+        Uint64 start = SDL_GetTicksNS();
+        uint8_t *data = load_binary_file_from_path(name);
+        Uint64 elapsed = SDL_GetTicksNS() - start;
 
-found:
-    if (offset == 0)
+        if (!data)
+        {
+            return false;
+        }
+        SDL_free(data);
+
+        bench->time_total += elapsed;
+        best = (elapsed < best) ? elapsed : best;
+    }
+
+    bench->stored_total += entry.stored_size;
+    bench->raw_total += entry.raw_size;
+
+    SDL_Log("%-20s %-8s %8u %8u %8.3f %8.2f",
+            name,
+            entry.codec < PFS_CODEC_COUNT ? codec_name[entry.codec] : "?",
+            (unsigned)entry.stored_size,
+            (unsigned)entry.raw_size,
+            (double)best / 1000000.0,
+            best ? (double)entry.raw_size * 1000.0 / (double)best : 0.0);
+
+    return true;
+}
+
+bool benchmark_archive(int runs)
+{
+    archive_bench_t bench = { runs, 0, 0, 0 };
+
+    SDL_Log("Archive load over %d run(s): entry, codec, stored bytes, raw bytes, best ms, MB/s", runs);
+
+    if (!for_each_entry(benchmark_entry, &bench))
     {
-        printf("failed to load %s\n", path);
-        exit(-1);
+        return false;
     }
 
-    fseek(data_pack, offset, SEEK_SET);
-    fread(&size, 4, 1, data_pack);
+    SDL_Log("Total: %llu stored bytes, %llu raw bytes, mean %.3f ms per pass",
+            (unsigned long long)bench.stored_total,
+            (unsigned long long)bench.raw_total,
+            (double)bench.time_total / runs / 1000000.0);
 
-    return data_pack;
+    return true;
 }
+#endif
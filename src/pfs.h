@@ -12,10 +12,44 @@
 #ifndef PFS_H
 #define PFS_H
 
+#include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
+
+// Per-entry payload encoding; tools/packer.cpp picks one for every asset.
+typedef enum pfs_codec
+{
+    PFS_STORED = 0,
+    PFS_DEFLATE,
+    PFS_LZ,
+    PFS_CODEC_COUNT
+
+} pfs_codec_t;
+
+// Header in front of a deflate stream handed to inflate_buffer.
+typedef enum pfs_wrap
+{
+    PFS_WRAP_RAW = 0,
+    PFS_WRAP_ZLIB,
+    PFS_WRAP_GZIP,
+    PFS_WRAP_COUNT
+
+} pfs_wrap_t;
 
 void init_file_reader(void);
 size_t size_of_file(const char *path);
 uint8_t *load_binary_file_from_path(const char *path);
+FILE *open_binary_file_from_path(const char *path);
+#if defined BENCHMARK
+// Called with the name of every packed entry, in pack order; returning false stops the walk.
+typedef bool (*pfs_entry_callback)(const char *name, void *userdata);
+
+bool for_each_entry(pfs_entry_callback callback, void *userdata);
+bool benchmark_archive(int runs);
+#endif
+
+#if !defined __EMSCRIPTEN__
+uint8_t *inflate_buffer(const uint8_t *src, size_t src_size, size_t size_hint, size_t *out_size, pfs_wrap_t wrap);
+#endif
 
 #endif // PFS_H
@@ -0,0 +1,431 @@
+/** @file raster.c
+ *
+ *  A minimalist, cross-platform puzzle-platformer, designed
+ *  especially for the Nokia N-Gage.
+ *
+ *  Copyright (c) 2026, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <SDL3/SDL.h>
+
+#if defined __SSE2__
+#include <emmintrin.h>
+#elif defined __ARM_NEON
+#include <arm_neon.h>
+#endif
+
+#include "config.h"
+#include "raster.h"
+#include "utils.h"
+
+static Uint16 to_xrgb4444(Uint8 r, Uint8 g, Uint8 b)
+{
+    return (Uint16)(((r >> 4) << 8) | ((g >> 4) << 4) | (b >> 4));
+}
+
+static void copy_span_masked(Uint16 *dst, const Uint16 *src, const Uint16 *mask, int count)
+{
+#if defined __SSE2__
+    // Eight pixels per step: dst = (src & mask) | (dst & ~mask).
+    while (count >= 8)
+    {
+        __m128i s = _mm_loadu_si128((const __m128i *)src);
+        __m128i m = _mm_loadu_si128((const __m128i *)mask);
+        __m128i d = _mm_loadu_si128((const __m128i *)dst);
+        _mm_storeu_si128((__m128i *)dst, _mm_or_si128(_mm_and_si128(s, m), _mm_andnot_si128(m, d)));
+        dst += 8;
+        src += 8;
+        mask += 8;
+        count -= 8;
+    }
+#elif defined __ARM_NEON
+    while (count >= 8)
+    {
+        uint16x8_t s = vld1q_u16(src);
+        uint16x8_t m = vld1q_u16(mask);
+        uint16x8_t d = vld1q_u16(dst);
+        vst1q_u16(dst, vbslq_u16(m, s, d));
+        dst += 8;
+        src += 8;
+        mask += 8;
+        count -= 8;
+    }
+#endif
+
+    while (count > 0)
+    {
+        *dst = (Uint16)((*src & *mask) | (*dst & ~*mask));
+        dst += 1;
+        src += 1;
+        mask += 1;
+        count -= 1;
+    }
+}
+
+static void copy_span_flipped(Uint16 *dst, const Uint16 *src, const Uint16 *mask, int count)
+{
+    // src and mask point at the rightmost source pixel and walk backwards.
+    if (mask)
+    {
+        for (int index = 0; index < count; index += 1)
+        {
+            dst[index] = (Uint16)((src[-index] & mask[-index]) | (dst[index] & ~mask[-index]));
+        }
+    }
+    else
+    {
+        for (int index = 0; index < count; index += 1)
+        {
+            dst[index] = src[-index];
+        }
+    }
+}
+
+void destroy_raster(raster_t *raster)
+{
+    if (raster)
+    {
+        SDL_free(raster->pixels);
+        SDL_free(raster->mask);
+        SDL_free(raster);
+    }
+}
+
+bool create_raster(int width, int height, raster_t **raster)
+{
+    *raster = (raster_t *)SDL_calloc(1, sizeof(raster_t));
+    if (!*raster)
+    {
+        SDL_Log("Error allocating memory for raster");
+        return false;
+    }
+
+    (*raster)->pixels = (Uint16 *)SDL_calloc((size_t)width * height, sizeof(Uint16));
+    if (!(*raster)->pixels)
+    {
+        SDL_Log("Error allocating memory for %dx%d raster", width, height);
+        destroy_raster(*raster);
+        *raster = NULL;
+        return false;
+    }
+
+    (*raster)->width = width;
+    (*raster)->height = height;
+    (*raster)->pitch = width;
+
+    return true;
+}
+
+bool load_raster_from_file(const char *file_name, raster_t **raster)
+{
+    int width, height;
+
+    Uint8 *image = load_pixels_from_file(file_name, &width, &height);
+    if (!image)
+    {
+        return false;
+    }
+
+    if (!create_raster(width, height, raster))
+    {
+        SDL_free(image);
+        return false;
+    }
+
+    (*raster)->mask = (Uint16 *)SDL_malloc((size_t)width * height * sizeof(Uint16));
+    if (!(*raster)->mask)
+    {
+        SDL_Log("Error allocating memory for raster mask");
+        SDL_free(image);
+        destroy_raster(*raster);
+        *raster = NULL;
+        return false;
+    }
+
+    // Bake the magenta colour key and the alpha channel into one mask up front.
+    for (int y = 0; y < height; y += 1)
+    {
+        const Uint8 *row = image + ((size_t)y * width * 4);
+        Uint16 *pixels = (*raster)->pixels + (y * (*raster)->pitch);
+        Uint16 *mask = (*raster)->mask + (y * (*raster)->pitch);
+
+        for (int x = 0; x < width; x += 1)
+        {
+            Uint8 r = row[(x * 4) + 0];
+            Uint8 g = row[(x * 4) + 1];
+            Uint8 b = row[(x * 4) + 2];
+            Uint8 a = row[(x * 4) + 3];
+            bool is_keyed = (0xff == r && 0x00 == g && 0xff == b) || a < 0x80;
+
+            pixels[x] = to_xrgb4444(r, g, b);
+            mask[x] = is_keyed ? 0x0000 : 0xffff;
+        }
+    }
+
+    SDL_free(image);
+    return true;
+}
+
+void clear_raster(raster_t *raster, Uint8 r, Uint8 g, Uint8 b)
+{
+    Uint16 colour = to_xrgb4444(r, g, b);
+    int count = raster->pitch * raster->height;
+
+    for (int index = 0; index < count; index += 1)
+    {
+        raster->pixels[index] = colour;
+    }
+}
+
+void blit_raster(raster_t *dst, const raster_t *src, int src_x, int src_y, int width, int height, int dst_x, int dst_y, bool flip_x)
+{
+    // Clamp to the source first. A flipped blit reads its source right to left, so
+    // columns cut on one side of the source come off the other side of the destination.
+    if (src_x < 0)
+    {
+        if (!flip_x)
+        {
+            dst_x -= src_x;
+        }
+        width += src_x;
+        src_x = 0;
+    }
+    if (src_x + width > src->width)
+    {
+        if (flip_x)
+        {
+            dst_x += (src_x + width) - src->width;
+        }
+        width = src->width - src_x;
+    }
+    if (src_y < 0)
+    {
+        dst_y -= src_y;
+        height += src_y;
+        src_y = 0;
+    }
+    if (src_y + height > src->height)
+    {
+        height = src->height - src_y;
+    }
+
+    // Then against the destination.
+    if (dst_x < 0)
+    {
+        if (!flip_x)
+        {
+            src_x -= dst_x;
+        }
+        width += dst_x;
+        dst_x = 0;
+    }
+    if (dst_x + width > dst->width)
+    {
+        if (flip_x)
+        {
+            src_x += (dst_x + width) - dst->width;
+        }
+        width = dst->width - dst_x;
+    }
+    if (dst_y < 0)
+    {
+        src_y -= dst_y;
+        height += dst_y;
+        dst_y = 0;
+    }
+    if (dst_y + height > dst->height)
+    {
+        height = dst->height - dst_y;
+    }
+
+    if (width <= 0 || height <= 0)
+    {
+        return;
+    }
+
+    Uint16 *dst_row = dst->pixels + (dst_y * dst->pitch) + dst_x;
+    const Uint16 *src_row = src->pixels + (src_y * src->pitch) + src_x;
+    const Uint16 *mask_row = src->mask ? src->mask + (src_y * src->pitch) + src_x : NULL;
+
+    for (int y = 0; y < height; y += 1)
+    {
+        if (flip_x)
+        {
+            copy_span_flipped(dst_row, src_row + width - 1, mask_row ? mask_row + width - 1 : NULL, width);
+        }
+        else if (mask_row)
+        {
+            copy_span_masked(dst_row, src_row, mask_row, width);
+        }
+        else
+        {
+            SDL_memcpy(dst_row, src_row, (size_t)width * sizeof(Uint16));
+        }
+
+        dst_row += dst->pitch;
+        src_row += src->pitch;
+        if (mask_row)
+        {
+            mask_row += src->pitch;
+        }
+    }
+}
+
+bool upload_raster(const raster_t *raster, SDL_Texture *texture)
+{
+    if (!SDL_UpdateTexture(texture, NULL, raster->pixels, raster->pitch * (int)sizeof(Uint16)))
+    {
+        SDL_Log("Couldn't upload raster: %s", SDL_GetError());
+        return false;
+    }
+
+    return true;
+}
+
+#if defined BENCHMARK
+static int compare_ns(const void *a, const void *b)
+{
+    Uint64 lhs = *(const Uint64 *)a;
+    Uint64 rhs = *(const Uint64 *)b;
+
+    return (lhs > rhs) - (lhs < rhs);
+}
+
+// Places one screen of tiles, half a tile off the grid so every edge of the frame is
+// clipped, with every third tile mirrored.
+static void get_bench_tile(int index, int tile_count, SDL_FRect *src, SDL_FRect *dst, bool *flip_x)
+{
+    int columns = (SCREEN_W / TILE_SIZE) + 2;
+    int id = ((index * 7) + (index / columns) * 13) % tile_count;
+
+    src->x = (float)TILE_TO_POS(id % TILESET_COLUMNS);
+    src->y = (float)TILE_TO_POS(id / TILESET_COLUMNS);
+    src->w = (float)TILE_SIZE;
+    src->h = (float)TILE_SIZE;
+    dst->x = (float)(TILE_TO_POS(index % columns) - (TILE_SIZE / 2));
+    dst->y = (float)(TILE_TO_POS(index / columns) - (TILE_SIZE / 2));
+    dst->w = (float)TILE_SIZE;
+    dst->h = (float)TILE_SIZE;
+    *flip_x = 0 == index % 3;
+}
+
+bool benchmark_raster(SDL_Renderer *renderer, int runs)
+{
+    int blit_count = ((SCREEN_W / TILE_SIZE) + 2) * ((SCREEN_H / TILE_SIZE) + 2);
+    raster_t *tileset = NULL;
+    raster_t *frame = NULL;
+    SDL_Texture *tileset_texture = NULL;
+    SDL_Texture *target = NULL;
+    SDL_Surface *readback = NULL;
+    bool exit_code = false;
+
+    Uint64 *sample = (Uint64 *)SDL_calloc(runs * 2, sizeof(Uint64));
+    if (!sample)
+    {
+        SDL_Log("Failed to allocate memory for raster benchmark");
+        return false;
+    }
+    Uint64 *sdl_sample = sample + runs;
+
+    if (!load_raster_from_file("tileset.png", &tileset) ||
+        !create_raster(SCREEN_W, SCREEN_H, &frame) ||
+        !load_texture_from_file("tileset.png", &tileset_texture, renderer))
+    {
+        goto cleanup;
+    }
+
+    target = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_XRGB8888, SDL_TEXTUREACCESS_TARGET, SCREEN_W, SCREEN_H);
+    if (!target)
+    {
+        SDL_Log("Could not create render target: %s", SDL_GetError());
+        goto cleanup;
+    }
+
+    int tile_count = POS_TO_TILE(tileset->width) * POS_TO_TILE(tileset->height);
+
+    for (int run = 0; run < runs; run += 1)
+    {
+        Uint64 start = SDL_GetTicksNS();
+        clear_raster(frame, 0, 0, 0);
+        for (int index = 0; index < blit_count; index += 1)
+        {
+            SDL_FRect src, dst;
+            bool flip_x;
+
+            get_bench_tile(index, tile_count, &src, &dst, &flip_x);
+            blit_raster(frame, tileset, (int)src.x, (int)src.y, TILE_SIZE, TILE_SIZE, (int)dst.x, (int)dst.y, flip_x);
+        }
+        sample[run] = SDL_GetTicksNS() - start;
+
+        // Reading a pixel back waits for the renderer to finish the frame.
+        start = SDL_GetTicksNS();
+        SDL_SetRenderTarget(renderer, target);
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+        SDL_RenderClear(renderer);
+        for (int index = 0; index < blit_count; index += 1)
+        {
+            SDL_FRect src, dst;
+            bool flip_x;
+
+            get_bench_tile(index, tile_count, &src, &dst, &flip_x);
+            SDL_RenderTextureRotated(renderer, tileset_texture, &src, &dst, 0.0, NULL, flip_x ? SDL_FLIP_HORIZONTAL : SDL_FLIP_NONE);
+        }
+        SDL_DestroySurface(readback);
+        readback = SDL_RenderReadPixels(renderer, NULL);
+        SDL_SetRenderTarget(renderer, NULL);
+        sdl_sample[run] = SDL_GetTicksNS() - start;
+
+        if (!readback)
+        {
+            SDL_Log("Couldn't read back the render target: %s", SDL_GetError());
+            goto cleanup;
+        }
+    }
+
+    // Both frames at the raster's colour depth; any difference is a clipping or flip bug.
+    int mismatches = 0;
+    for (int y = 0; y < SCREEN_H; y += 1)
+    {
+        for (int x = 0; x < SCREEN_W; x += 1)
+        {
+            Uint8 r, g, b, a;
+            SDL_ReadSurfacePixel(readback, x, y, &r, &g, &b, &a);
+            if (frame->pixels[(y * frame->pitch) + x] != to_xrgb4444(r, g, b))
+            {
+                mismatches += 1;
+            }
+        }
+    }
+
+    SDL_qsort(sample, runs, sizeof(Uint64), compare_ns);
+    SDL_qsort(sdl_sample, runs, sizeof(Uint64), compare_ns);
+
+    SDL_Log("Frame of %d tile blits over %d run(s): path, p50 ms, p95 ms", blit_count, runs);
+    SDL_Log("%-20s %8.3f %8.3f", "software raster",
+            (double)sample[(runs - 1) / 2] / 1000000.0,
+            (double)sample[(runs - 1) * 95 / 100] / 1000000.0);
+    SDL_Log("%-20s %8.3f %8.3f", SDL_GetRendererName(renderer),
+            (double)sdl_sample[(runs - 1) / 2] / 1000000.0,
+            (double)sdl_sample[(runs - 1) * 95 / 100] / 1000000.0);
+    SDL_Log("Mismatched pixels:   %d of %d", mismatches, SCREEN_W * SCREEN_H);
+
+    exit_code = true;
+
+cleanup:
+    SDL_DestroySurface(readback);
+    if (target)
+    {
+        SDL_DestroyTexture(target);
+    }
+    if (tileset_texture)
+    {
+        SDL_DestroyTexture(tileset_texture);
+    }
+    destroy_raster(frame);
+    destroy_raster(tileset);
+    SDL_free(sample);
+    return exit_code;
+}
+#endif
@@ -0,0 +1,37 @@
+/** @file raster.h
+ *
+ *  A minimalist, cross-platform puzzle-platformer, designed
+ *  especially for the Nokia N-Gage.
+ *
+ *  Copyright (c) 2026, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#ifndef RASTER_H
+#define RASTER_H
+
+#include <SDL3/SDL.h>
+
+// CPU-side XRGB4444 image; sources with a colour key carry a per-pixel mask.
+typedef struct raster
+{
+    Uint16 *pixels;
+    Uint16 *mask; // 0xffff where opaque, 0x0000 where keyed out; NULL if fully opaque.
+    int width;
+    int height;
+    int pitch; // In pixels.
+
+} raster_t;
+
+void destroy_raster(raster_t *raster);
+bool create_raster(int width, int height, raster_t **raster);
+bool load_raster_from_file(const char *file_name, raster_t **raster);
+void clear_raster(raster_t *raster, Uint8 r, Uint8 g, Uint8 b);
+void blit_raster(raster_t *dst, const raster_t *src, int src_x, int src_y, int width, int height, int dst_x, int dst_y, bool flip_x);
+bool upload_raster(const raster_t *raster, SDL_Texture *texture);
+#if defined BENCHMARK
+bool benchmark_raster(SDL_Renderer *renderer, int runs);
+#endif
+
+#endif // RASTER_H
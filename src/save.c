@@ -0,0 +1,351 @@
+/** @file save.c
+ *
+ *  A minimalist, cross-platform puzzle-platformer, designed
+ *  especially for the Nokia N-Gage.
+ *
+ *  Copyright (c) 2026, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <SDL3/SDL.h>
+
+#include "config.h"
+#include "core.h"
+#include "game.h"
+#include "save.h"
+#include "trace.h"
+
+#define SAVE_MAGIC   0x5641534b // KSAV
+#define SAVE_VERSION 2 // Version 1 named maps .tmj.gz.
+
+typedef struct snapshot
+{
+    char map_name[16];
+
+    Sint32 level;
+    Sint32 life_count;
+    Sint32 pos_x;
+    Sint32 pos_y;
+    Sint32 velocity_x;
+    Sint32 velocity_y;
+    Sint32 heading;
+    Sint32 coins_left;
+    Sint32 obj_count;
+
+    Uint8 wears_mask;
+    Uint8 use_lgbtq_flag;
+
+} snapshot_t;
+
+static bool get_save_path(const char *file_name, char *path, size_t size)
+{
+    char *pref_path = SDL_GetPrefPath(SAVE_ORG, SAVE_APP);
+    if (!pref_path)
+    {
+        SDL_Log("Couldn't get pref path: %s", SDL_GetError());
+        return false;
+    }
+
+    SDL_snprintf(path, size, "%s%s", pref_path, file_name);
+    SDL_free(pref_path);
+
+    return true;
+}
+
+static void get_map_name(core_t *nc, char *name, size_t size)
+{
+    if (nc->world)
+    {
+        SDL_snprintf(name, size, "%s", nc->world->entry[nc->world->active].file_name);
+    }
+    else
+    {
+        SDL_snprintf(name, size, "%03d.%s", nc->kero->level, MAP_SUFFIX);
+    }
+}
+
+static bool write_snapshot(core_t *nc, const char *file_name)
+{
+    char path[256] = { 0 };
+    char temp_path[256] = { 0 };
+    char map_name[16] = { 0 };
+    map_t *map = nc->map;
+    kero_t *kero = nc->kero;
+
+    if (!get_save_path(file_name, path, sizeof(path)))
+    {
+        return false;
+    }
+    SDL_snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+
+    get_map_name(nc, map_name, sizeof(map_name));
+    Uint8 name_length = (Uint8)SDL_strlen(map_name);
+
+    // Written aside and renamed, so a kill mid-write never leaves a torn snapshot.
+    SDL_IOStream *io = SDL_IOFromFile(temp_path, "wb");
+    if (!io)
+    {
+        SDL_Log("Couldn't write snapshot %s: %s", temp_path, SDL_GetError());
+        return false;
+    }
+
+    bool exit_code = SDL_WriteU32LE(io, SAVE_MAGIC) &&
+                     SDL_WriteU32LE(io, SAVE_VERSION) &&
+                     SDL_WriteU8(io, name_length) &&
+                     SDL_WriteIO(io, map_name, name_length) == name_length &&
+                     SDL_WriteS32LE(io, kero->level) &&
+                     SDL_WriteS32LE(io, kero->life_count) &&
+                     SDL_WriteS32LE(io, kero->pos_x) &&
+                     SDL_WriteS32LE(io, kero->pos_y) &&
+                     SDL_WriteS32LE(io, kero->velocity_x) &&
+                     SDL_WriteS32LE(io, kero->velocity_y) &&
+                     SDL_WriteS32LE(io, kero->heading) &&
+                     SDL_WriteU8(io, kero->wears_mask) &&
+                     SDL_WriteU8(io, map->use_lgbtq_flag) &&
+                     SDL_WriteS32LE(io, map->coins_left) &&
+                     SDL_WriteS32LE(io, map->obj_count);
+
+    // Collected coins, one bit per object; the door state follows from the coin count.
+    for (int index = 0; exit_code && index < map->obj_count; index += 8)
+    {
+        Uint8 bits = 0;
+        for (int bit = 0; bit < 8 && index + bit < map->obj_count; bit += 1)
+        {
+            if (map->obj[index + bit].is_hidden)
+            {
+                bits |= (Uint8)(1 << bit);
+            }
+        }
+        exit_code = SDL_WriteU8(io, bits);
+    }
+
+    if (!SDL_CloseIO(io))
+    {
+        exit_code = false;
+    }
+
+    if (!exit_code || !SDL_RenamePath(temp_path, path))
+    {
+        SDL_Log("Error writing snapshot %s: %s", path, SDL_GetError());
+        SDL_RemovePath(temp_path);
+        return false;
+    }
+
+    return true;
+}
+
+static bool read_header(SDL_IOStream *io, snapshot_t *snapshot)
+{
+    Uint32 magic = 0;
+    Uint32 version = 0;
+    Uint8 name_length = 0;
+
+    if (!SDL_ReadU32LE(io, &magic) || !SDL_ReadU32LE(io, &version) || !SDL_ReadU8(io, &name_length) ||
+        magic != SAVE_MAGIC || version != SAVE_VERSION || name_length >= sizeof(snapshot->map_name) ||
+        SDL_ReadIO(io, snapshot->map_name, name_length) != name_length)
+    {
+        return false;
+    }
+    snapshot->map_name[name_length] = '\0';
+
+    return SDL_ReadS32LE(io, &snapshot->level) &&
+           SDL_ReadS32LE(io, &snapshot->life_count) &&
+           SDL_ReadS32LE(io, &snapshot->pos_x) &&
+           SDL_ReadS32LE(io, &snapshot->pos_y) &&
+           SDL_ReadS32LE(io, &snapshot->velocity_x) &&
+           SDL_ReadS32LE(io, &snapshot->velocity_y) &&
+           SDL_ReadS32LE(io, &snapshot->heading) &&
+           SDL_ReadU8(io, &snapshot->wears_mask) &&
+           SDL_ReadU8(io, &snapshot->use_lgbtq_flag) &&
+           SDL_ReadS32LE(io, &snapshot->coins_left) &&
+           SDL_ReadS32LE(io, &snapshot->obj_count);
+}
+
+static void restore_coins(SDL_IOStream *io, const snapshot_t *snapshot, map_t *map)
+{
+    // A map edited since the snapshot was taken starts over with all coins.
+    if (snapshot->obj_count != map->obj_count)
+    {
+        SDL_Log("Snapshot of %s does not match the map, coins are reset", snapshot->map_name);
+        return;
+    }
+
+    for (int index = 0; index < map->obj_count; index += 8)
+    {
+        Uint8 bits = 0;
+        if (!SDL_ReadU8(io, &bits))
+        {
+            return;
+        }
+
+        for (int bit = 0; bit < 8 && index + bit < map->obj_count; bit += 1)
+        {
+            map->obj[index + bit].is_hidden = (bits >> bit) & 1;
+        }
+    }
+
+    map->coins_left = snapshot->coins_left;
+    map->prev_coins = snapshot->coins_left;
+}
+
+static bool read_snapshot(core_t *nc, const char *file_name, bool *has_resumed)
+{
+    char path[256] = { 0 };
+    snapshot_t snapshot;
+
+    *has_resumed = false;
+    SDL_zero(snapshot);
+
+    if (!get_save_path(file_name, path, sizeof(path)))
+    {
+        return true;
+    }
+
+    SDL_IOStream *io = SDL_IOFromFile(path, "rb");
+    if (!io)
+    {
+        // No snapshot: start from the intro as usual.
+        return true;
+    }
+
+    if (!read_header(io, &snapshot))
+    {
+        SDL_Log("Discarding invalid snapshot: %s", path);
+        SDL_CloseIO(io);
+        SDL_RemovePath(path);
+        return true;
+    }
+
+    SDL_Log("Resuming %s", snapshot.map_name);
+
+    // Straight to the game; intro and menu never load.
+    nc->state = STATE_GAME;
+    nc->btn = 0;
+    if (!load_game(nc, snapshot.map_name))
+    {
+        // A snapshot that no longer loads must not keep the game from starting.
+        SDL_Log("Discarding snapshot of %s", snapshot.map_name);
+        SDL_CloseIO(io);
+        SDL_RemovePath(path);
+        unload_game(nc);
+        nc->state = STATE_INTRO;
+        return true;
+    }
+
+    kero_t *kero = nc->kero;
+    kero->level = snapshot.level;
+    kero->life_count = snapshot.life_count;
+    kero->prev_life_count = snapshot.life_count;
+    kero->pos_x = snapshot.pos_x;
+    kero->pos_y = snapshot.pos_y;
+    kero->velocity_x = snapshot.velocity_x;
+    kero->velocity_y = snapshot.velocity_y;
+    kero->heading = snapshot.heading;
+    kero->wears_mask = snapshot.wears_mask;
+
+    nc->map->use_lgbtq_flag = snapshot.use_lgbtq_flag;
+    restore_coins(io, &snapshot, nc->map);
+    SDL_CloseIO(io);
+
+    // Come back paused, so the player is not dropped into motion.
+    nc->is_paused = true;
+    nc->ui->prev_selection = nc->ui->menu_selection;
+    nc->ui->menu_selection = MENU_RESUME;
+
+    *has_resumed = true;
+    return true;
+}
+
+bool save_game(core_t *nc)
+{
+    // Traces start from the intro; a recorded or replayed run never touches the snapshot.
+    if (!nc || nc->is_headless || STATE_GAME != nc->state || !nc->map || !nc->kero || is_replaying() || is_recording())
+    {
+        return true;
+    }
+
+    return write_snapshot(nc, SAVE_FILE);
+}
+
+void discard_save(core_t *nc)
+{
+    char path[256] = { 0 };
+
+    if (!nc || nc->is_headless || is_replaying() || is_recording())
+    {
+        return;
+    }
+
+    // Quitting ends the run, so the next launch starts at the intro again.
+    if (get_save_path(SAVE_FILE, path, sizeof(path)))
+    {
+        SDL_RemovePath(path);
+    }
+}
+
+bool resume_game(core_t *nc)
+{
+    bool has_resumed = false;
+
+    return read_snapshot(nc, SAVE_FILE, &has_resumed);
+}
+
+#if defined BENCHMARK
+bool benchmark_resume(core_t *nc, int runs)
+{
+    char path[256] = { 0 };
+    bool has_resumed = false;
+    Uint64 cold_total = 0;
+    Uint64 cold_best = SDL_MAX_UINT64;
+    Uint64 resume_total = 0;
+    Uint64 resume_best = SDL_MAX_UINT64;
+
+    for (int run = 0; run < runs; run += 1)
+    {
+        // Cold path cost after intro and menu: what every start used to pay.
+        Uint64 start = SDL_GetTicksNS();
+        nc->state = STATE_GAME;
+        if (!load_game(nc, NULL) || !update(nc) || !draw_scene(nc))
+        {
+            return false;
+        }
+        Uint64 cold = SDL_GetTicksNS() - start;
+
+        if (!write_snapshot(nc, SAVE_BENCH_FILE))
+        {
+            return false;
+        }
+        unload_game(nc);
+        nc->state = STATE_INTRO;
+
+        // Resume path: snapshot read, level load, first playable frame.
+        start = SDL_GetTicksNS();
+        if (!read_snapshot(nc, SAVE_BENCH_FILE, &has_resumed) || !has_resumed || !update(nc) || !draw_scene(nc))
+        {
+            return false;
+        }
+        Uint64 resume = SDL_GetTicksNS() - start;
+
+        unload_game(nc);
+        nc->state = STATE_INTRO;
+        nc->is_paused = false;
+
+        cold_total += cold;
+        cold_best = (cold < cold_best) ? cold : cold_best;
+        resume_total += resume;
+        resume_best = (resume < resume_best) ? resume : resume_best;
+    }
+
+    if (get_save_path(SAVE_BENCH_FILE, path, sizeof(path)))
+    {
+        SDL_RemovePath(path);
+    }
+
+    SDL_Log("Time to playable over %d run(s)", runs);
+    SDL_Log("Fresh game:  mean %.3f ms, best %.3f ms, plus intro and menu", (double)cold_total / runs / 1000000.0, (double)cold_best / 1000000.0);
+    SDL_Log("Resume:      mean %.3f ms, best %.3f ms", (double)resume_total / runs / 1000000.0, (double)resume_best / 1000000.0);
+
+    return true;
+}
+#endif
@@ -0,0 +1,25 @@
+/** @file save.h
+ *
+ *  A minimalist, cross-platform puzzle-platformer, designed
+ *  especially for the Nokia N-Gage.
+ *
+ *  Copyright (c) 2026, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#ifndef SAVE_H
+#define SAVE_H
+
+#include <SDL3/SDL.h>
+
+#include "core.h"
+
+bool save_game(core_t *nc);
+bool resume_game(core_t *nc);
+void discard_save(core_t *nc);
+#if defined BENCHMARK
+bool benchmark_resume(core_t *nc, int runs);
+#endif
+
+#endif // SAVE_H
@@ -0,0 +1,573 @@
+/** @file solver.c
+ *
+ *  A minimalist, cross-platform puzzle-platformer, designed
+ *  especially for the Nokia N-Gage.
+ *
+ *  Copyright (c) 2026, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <SDL3/SDL.h>
+
+#include "config.h"
+#include "core.h"
+#include "kero.h"
+#include "map.h"
+#include "solver.h"
+#include "trace.h"
+#include "utils.h"
+
+#define SOLVER_STEP_TICKS    4         // Ticks an input combination is held for.
+#define SOLVER_STEP_PX       6         // Distance kero covers per step at full speed.
+#define SOLVER_CELL_SHIFT    2         // 4x4 pixel cells tell states apart.
+#define SOLVER_SPEED_SHIFT   12        // Velocity buckets of 1/16 pixel per millisecond.
+#define SOLVER_MAX_NODES     (1 << 17) // Roughly 23 MB of kero snapshots.
+#define SOLVER_VISITED_SIZE  (1 << 18) // Power of two, twice the node limit.
+#define SOLVER_MAX_COINS     32
+#define SOLVER_DOOR_TICKS    4
+
+#define BUTTON(button) (1u << (button))
+
+// Worlds join maps without doors, so there is nothing to route between.
+#if !defined WORLD_MODE
+typedef struct node
+{
+    kero_t kero;
+    Uint32 coins; // Collected coins, one bit per entry of coin_index.
+    int parent;
+    int steps;
+    int cost; // Steps taken plus the estimate of steps left; lowest is expanded first.
+    int action;
+
+} node_t;
+
+// Dashes only happen in the air, so they pair with a direction.
+static const unsigned int action_btn[] = {
+    0,
+    BUTTON(BTN_LEFT),
+    BUTTON(BTN_RIGHT),
+    BUTTON(BTN_7),
+    BUTTON(BTN_7) | BUTTON(BTN_LEFT),
+    BUTTON(BTN_7) | BUTTON(BTN_RIGHT),
+    BUTTON(BTN_5) | BUTTON(BTN_LEFT),
+    BUTTON(BTN_5) | BUTTON(BTN_RIGHT),
+};
+
+#define ACTION_COUNT (int)(sizeof(action_btn) / sizeof(action_btn[0]))
+
+static node_t *nodes = NULL;
+static int node_count = 0;
+static int node_capacity = 0;
+
+static int *heap = NULL;
+static int heap_count = 0;
+
+static Uint64 *visited = NULL;
+
+static int coin_index[SOLVER_MAX_COINS];
+static int coin_count = 0;
+static bool has_door = false;
+static int door_x = 0;
+static int door_y = 0;
+
+static int start_coins_left = 0;
+static int start_prev_coins = 0;
+static bool start_show_dialogue = false;
+static bool start_keep_dialogue = false;
+
+static unsigned int held_btn = 0;
+
+static bool is_cheaper(int lhs, int rhs)
+{
+    // Ties go to the older node, so every run expands the same order.
+    if (nodes[lhs].cost != nodes[rhs].cost)
+    {
+        return nodes[lhs].cost < nodes[rhs].cost;
+    }
+    return lhs < rhs;
+}
+
+static void push_heap(int index)
+{
+    int child = heap_count;
+    heap_count += 1;
+
+    while (child > 0)
+    {
+        int parent = (child - 1) / 2;
+        if (!is_cheaper(index, heap[parent]))
+        {
+            break;
+        }
+        heap[child] = heap[parent];
+        child = parent;
+    }
+    heap[child] = index;
+}
+
+static int pop_heap(void)
+{
+    int top = heap[0];
+    int last = heap[heap_count - 1];
+    int parent = 0;
+
+    heap_count -= 1;
+
+    for (;;)
+    {
+        int child = parent * 2 + 1;
+        if (child >= heap_count)
+        {
+            break;
+        }
+        if (child + 1 < heap_count && is_cheaper(heap[child + 1], heap[child]))
+        {
+            child += 1;
+        }
+        if (!is_cheaper(heap[child], last))
+        {
+            break;
+        }
+        heap[parent] = heap[child];
+        parent = child;
+    }
+    if (heap_count > 0)
+    {
+        heap[parent] = last;
+    }
+
+    return top;
+}
+
+static bool add_node(const node_t *node)
+{
+    if (node_count >= node_capacity)
+    {
+        if (node_capacity >= SOLVER_MAX_NODES)
+        {
+            return false;
+        }
+
+        int capacity = node_capacity ? node_capacity * 2 : 4096;
+        node_t *resized_nodes = (node_t *)SDL_realloc(nodes, sizeof(node_t) * capacity);
+        if (!resized_nodes)
+        {
+            SDL_Log("Error allocating memory for solver states");
+            return false;
+        }
+        nodes = resized_nodes;
+
+        int *resized_heap = (int *)SDL_realloc(heap, sizeof(int) * capacity);
+        if (!resized_heap)
+        {
+            SDL_Log("Error allocating memory for solver states");
+            return false;
+        }
+        heap = resized_heap;
+        node_capacity = capacity;
+    }
+
+    nodes[node_count] = *node;
+    push_heap(node_count);
+    node_count += 1;
+    return true;
+}
+
+static void hash_value(Uint64 *hash, Sint32 value)
+{
+    Uint32 bits = (Uint32)value;
+
+    for (int shift = 0; shift < 32; shift += 8)
+    {
+        *hash ^= (bits >> shift) & 0xff;
+        *hash *= 0x100000001b3;
+    }
+}
+
+// States within the same cell, speed bucket and pose are treated as one.
+static bool mark_visited(const node_t *node)
+{
+    Uint64 key = 0xcbf29ce484222325; // FNV-1a offset basis.
+
+    hash_value(&key, fix32_to_int(node->kero.pos_x) >> SOLVER_CELL_SHIFT);
+    hash_value(&key, fix32_to_int(node->kero.pos_y) >> SOLVER_CELL_SHIFT);
+    hash_value(&key, node->kero.velocity_x >> SOLVER_SPEED_SHIFT);
+    hash_value(&key, node->kero.velocity_y >> SOLVER_SPEED_SHIFT);
+    hash_value(&key, node->kero.state);
+    hash_value(&key, node->kero.heading);
+    hash_value(&key, node->kero.jump_lock);
+    hash_value(&key, (Sint32)node->coins);
+
+    // Zero marks a free slot.
+    if (!key)
+    {
+        key = 1;
+    }
+
+    Uint32 slot = (Uint32)key & (SOLVER_VISITED_SIZE - 1);
+    while (visited[slot])
+    {
+        if (visited[slot] == key)
+        {
+            return false;
+        }
+        slot = (slot + 1) & (SOLVER_VISITED_SIZE - 1);
+    }
+    visited[slot] = key;
+    return true;
+}
+
+static void restore_node(const node_t *node, core_t *nc)
+{
+    int collected = 0;
+
+    *nc->kero = node->kero;
+
+    for (int index = 0; index < coin_count; index += 1)
+    {
+        bool is_collected = (node->coins >> index) & 1u;
+        nc->map->obj[coin_index[index]].is_hidden = is_collected;
+        collected += is_collected;
+    }
+
+    nc->map->coins_left = start_coins_left - collected;
+    nc->map->prev_coins = start_prev_coins;
+    nc->map->show_dialogue = start_show_dialogue;
+    nc->map->keep_dialogue = start_keep_dialogue;
+
+    // kero->time_a holds the clock of its last update.
+    set_virtual_ticks(node->kero.time_a);
+}
+
+static Uint32 get_collected(map_t *map)
+{
+    Uint32 coins = 0;
+
+    for (int index = 0; index < coin_count; index += 1)
+    {
+        if (map->obj[coin_index[index]].is_hidden)
+        {
+            coins |= 1u << index;
+        }
+    }
+
+    return coins;
+}
+
+// Distance to the nearest coin left, or to the door if there is one, plus a full crossing per coin left.
+static int estimate_steps(const node_t *node, map_t *map)
+{
+    int pos_x = fix32_to_int(node->kero.pos_x);
+    int pos_y = fix32_to_int(node->kero.pos_y);
+    int nearest = SDL_MAX_SINT32;
+    int coins_left = 0;
+
+    for (int index = 0; index < coin_count; index += 1)
+    {
+        if (!((node->coins >> index) & 1u))
+        {
+            obj_t *coin = &map->obj[coin_index[index]];
+            int distance = SDL_abs(coin->x - pos_x) + SDL_abs(coin->y - pos_y);
+
+            nearest = (distance < nearest) ? distance : nearest;
+            coins_left += 1;
+        }
+    }
+
+    if (!coins_left)
+    {
+        nearest = has_door ? SDL_abs(door_x - pos_x) + SDL_abs(door_y - pos_y) : 0;
+    }
+
+    return (nearest + coins_left * (map->width + map->height)) / SOLVER_STEP_PX;
+}
+
+static bool is_goal(node_t *node, Uint32 all_coins, map_t *map)
+{
+    if (node->coins != all_coins)
+    {
+        return false;
+    }
+
+    return !has_door || is_kero_at_door(&node->kero, map);
+}
+
+static bool play_tick(core_t *nc, unsigned int btn)
+{
+    // The same steps as a replayed frame, so the trace plays back identically.
+    unsigned int pressed = btn & ~held_btn;
+    unsigned int released = held_btn & ~btn;
+    held_btn = btn;
+
+    record_input(btn, NULL, NULL);
+    advance_virtual_ticks();
+
+    return apply_buttons(nc, pressed, released) && update(nc);
+}
+
+static bool prepare_level(map_t *map, bool is_last)
+{
+    has_door = false;
+    coin_count = 0;
+
+    for (int index = 0; index < map->obj_count; index += 1)
+    {
+        obj_t *obj = &map->obj[index];
+
+        if (NAME_COIN == obj->name && !obj->is_hidden)
+        {
+            if (coin_count >= SOLVER_MAX_COINS)
+            {
+                SDL_Log("More than %d coins, can't solve map", SOLVER_MAX_COINS);
+                return false;
+            }
+            coin_index[coin_count] = index;
+            coin_count += 1;
+        }
+        else if (NAME_DOOR == obj->name)
+        {
+            door_x = obj->x;
+            door_y = obj->y;
+            has_door = true;
+        }
+    }
+
+    // The last map may end the game without a door; collecting its coins is enough.
+    if (!has_door && !is_last)
+    {
+        SDL_Log("Map has no door");
+        return false;
+    }
+
+    start_coins_left = map->coins_left;
+    start_prev_coins = map->prev_coins;
+    start_show_dialogue = map->show_dialogue;
+    start_keep_dialogue = map->keep_dialogue;
+
+    node_count = 0;
+    heap_count = 0;
+    SDL_memset(visited, 0, sizeof(Uint64) * SOLVER_VISITED_SIZE);
+
+    return true;
+}
+
+// Best-first search over held input combinations, stepping the real physics.
+static int search_level(core_t *nc, int *expanded)
+{
+    Uint32 all_coins = coin_count ? (Uint32)(((Uint64)1 << coin_count) - 1) : 0;
+    bool has_updated = false;
+    node_t root;
+
+    SDL_zero(root);
+    root.kero = *nc->kero;
+    root.coins = get_collected(nc->map);
+    root.parent = -1;
+    root.action = -1;
+    root.cost = estimate_steps(&root, nc->map);
+
+    mark_visited(&root);
+    if (!add_node(&root))
+    {
+        return -1;
+    }
+
+    *expanded = 0;
+    while (heap_count > 0)
+    {
+        int current = pop_heap();
+        node_t parent = nodes[current];
+
+        *expanded += 1;
+
+        for (int action = 0; action < ACTION_COUNT; action += 1)
+        {
+            node_t child;
+
+            restore_node(&parent, nc);
+            for (int tick = 0; tick < SOLVER_STEP_TICKS; tick += 1)
+            {
+                unsigned int btn = action_btn[action];
+
+                advance_virtual_ticks();
+                update_kero(nc->kero, nc->map, nc->ui, &btn, nc->renderer, false, &has_updated);
+                if (STATE_DEAD == nc->kero->state)
+                {
+                    break;
+                }
+            }
+
+            // A route that costs a life is no route.
+            if (STATE_DEAD == nc->kero->state)
+            {
+                continue;
+            }
+
+            child.kero = *nc->kero;
+            child.coins = get_collected(nc->map);
+            child.parent = current;
+            child.steps = parent.steps + 1;
+            child.cost = child.steps + estimate_steps(&child, nc->map);
+            child.action = action;
+
+            if (!mark_visited(&child))
+            {
+                continue;
+            }
+
+            if (!add_node(&child))
+            {
+                SDL_Log("Gave up after %d states", node_count);
+                return -1;
+            }
+
+            if (is_goal(&child, all_coins, nc->map))
+            {
+                return node_count - 1;
+            }
+        }
+    }
+
+    SDL_Log("No route left to try after %d states", node_count);
+    return -1;
+}
+
+static bool solve_level(core_t *nc, bool is_last)
+{
+    Uint64 start = SDL_GetTicksNS();
+    int expanded = 0;
+    int level = nc->kero->level;
+
+    if (!prepare_level(nc->map, is_last))
+    {
+        return false;
+    }
+
+    int goal = search_level(nc, &expanded);
+    if (goal < 0)
+    {
+        SDL_Log("Level %d: unsolved", level);
+        return false;
+    }
+
+    int step_count = nodes[goal].steps;
+    int *route = (int *)SDL_malloc(sizeof(int) * (step_count ? step_count : 1));
+    if (!route)
+    {
+        SDL_Log("Error allocating memory for route");
+        return false;
+    }
+
+    for (int index = goal; nodes[index].parent >= 0; index = nodes[index].parent)
+    {
+        route[nodes[index].steps - 1] = nodes[index].action;
+    }
+
+    // Play the route for real from where the search started; this is what gets recorded.
+    restore_node(&nodes[0], nc);
+    for (int step = 0; step < step_count; step += 1)
+    {
+        for (int tick = 0; tick < SOLVER_STEP_TICKS; tick += 1)
+        {
+            if (!play_tick(nc, action_btn[route[step]]))
+            {
+                SDL_free(route);
+                return false;
+            }
+        }
+    }
+    SDL_free(route);
+
+    if (STATE_DEAD == nc->kero->state || nc->map->coins_left || (has_door && !is_kero_at_door(nc->kero, nc->map)))
+    {
+        SDL_Log("Level %d: route diverged on playback", level);
+        return false;
+    }
+
+    if (!is_last)
+    {
+        for (int tick = 0; tick < SOLVER_DOOR_TICKS && nc->kero->level == level; tick += 1)
+        {
+            if (!play_tick(nc, BUTTON(BTN_UP)))
+            {
+                return false;
+            }
+        }
+
+        if (nc->kero->level == level)
+        {
+            SDL_Log("Level %d: door didn't open", level);
+            return false;
+        }
+    }
+
+    SDL_Log("Level %d: %d steps (%d ticks), %d of %d states expanded, %.1f ms",
+            level,
+            step_count,
+            step_count * SOLVER_STEP_TICKS,
+            expanded,
+            node_count,
+            (double)(SDL_GetTicksNS() - start) / 1000000.0);
+
+    return true;
+}
+
+#endif
+
+bool solve_levels(core_t *nc, const char *file_name)
+{
+#if defined WORLD_MODE
+    SDL_Log("The solver plays maps through their doors, which worlds don't use");
+    return false;
+#else
+    bool exit_code = true;
+
+    visited = (Uint64 *)SDL_malloc(sizeof(Uint64) * SOLVER_VISITED_SIZE);
+    if (!visited)
+    {
+        SDL_Log("Error allocating memory for solver states");
+        return false;
+    }
+
+    held_btn = 0;
+    set_virtual_ticks(0);
+    start_recording(file_name);
+
+    // Traces start at the intro: it hands over to the menu, where a press starts a new game.
+    exit_code = play_tick(nc, 0) && play_tick(nc, BUTTON(BTN_7)) && play_tick(nc, 0);
+    if (exit_code && STATE_GAME != nc->state)
+    {
+        SDL_Log("Menu didn't start a game");
+        exit_code = false;
+    }
+
+    for (int level = FIRST_LEVEL; exit_code && level <= LAST_LEVEL; level += 1)
+    {
+        exit_code = solve_level(nc, LAST_LEVEL == level);
+    }
+
+    if (exit_code)
+    {
+        SDL_Log("Solved levels %d to %d", FIRST_LEVEL, LAST_LEVEL);
+    }
+
+    // Written either way; a partial trace shows where the route broke.
+    if (!stop_recording())
+    {
+        exit_code = false;
+    }
+    stop_virtual_ticks();
+
+    SDL_free(nodes);
+    SDL_free(heap);
+    SDL_free(visited);
+    nodes = NULL;
+    heap = NULL;
+    visited = NULL;
+    node_count = 0;
+    node_capacity = 0;
+    heap_count = 0;
+
+    return exit_code;
+#endif
+}
@@ -0,0 +1,20 @@
+/** @file solver.h
+ *
+ *  A minimalist, cross-platform puzzle-platformer, designed
+ *  especially for the Nokia N-Gage.
+ *
+ *  Copyright (c) 2026, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include <SDL3/SDL.h>
+
+#include "core.h"
+
+bool solve_levels(core_t *nc, const char *file_name);
+
+#endif // SOLVER_H
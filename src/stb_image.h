@@ -358,6 +358,10 @@ RECENT REVISION HISTORY:
 //   - If you use STBI_NO_PNG (or _ONLY_ without PNG), and you still
 //     want the zlib decoder to be available, #define STBI_SUPPORT_ZLIB
 //
+//   - To decode PNG data with another inflate, #define STBI_ZLIB_DECODE to a
+//     function with the signature of stbi_zlib_decode_malloc_guesssize_headerflag.
+//     The built-in zlib decoder is then left out unless STBI_SUPPORT_ZLIB is set.
+//
 //  - If you define STBI_MAX_DIMENSIONS, stb_image will reject images greater
 //    than that size (in either width or height) without further processing.
 //    This is to let programs in the wild set an upper bound to prevent
@@ -583,6 +587,11 @@ STBIDEF int   stbi_zlib_decode_noheader_buffer(char *obuffer, int olen, const ch
 #define STBI_NO_ZLIB
 #endif
 
+// The PNG decoder only needs the built-in inflate when no external one is supplied.
+#if defined(STBI_ZLIB_DECODE) && !defined(STBI_SUPPORT_ZLIB) && !defined(STBI_NO_ZLIB)
+#define STBI_NO_ZLIB
+#endif
+
 
 #include <stdarg.h>
 #include <stddef.h> // ptrdiff_t on osx
@@ -5204,7 +5213,11 @@ static int stbi__parse_png_file(stbi__png *z, int scan, int req_comp)
             // initial guess for decoded data size to avoid unnecessary reallocs
             bpl = (s->img_x * z->depth + 7) / 8; // bytes per line, per component
             raw_len = bpl * s->img_y * s->img_n /* pixels */ + s->img_y /* filter mode per row */;
+#ifdef STBI_ZLIB_DECODE
+            z->expanded = (stbi_uc *) STBI_ZLIB_DECODE((char *) z->idata, ioff, raw_len, (int *) &raw_len, !is_iphone);
+#else
             z->expanded = (stbi_uc *) stbi_zlib_decode_malloc_guesssize_headerflag((char *) z->idata, ioff, raw_len, (int *) &raw_len, !is_iphone);
+#endif
             if (z->expanded == NULL) return 0; // zlib should set error
             STBI_FREE(z->idata); z->idata = NULL;
             if ((req_comp == s->img_n+1 && req_comp != 3 && !pal_img_n) || has_trans)
@@ -0,0 +1,673 @@
+/** @file trace.c
+ *
+ *  A minimalist, cross-platform puzzle-platformer, designed
+ *  especially for the Nokia N-Gage.
+ *
+ *  Copyright (c) 2026, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <SDL3/SDL.h>
+
+#include "trace.h"
+
+// Allocation sizes are asked of the C library, so tracking needs its size query.
+#if !defined BENCHMARK
+// Memory tracking only serves the benchmarks.
+#elif defined __linux__ && !defined __ANDROID__
+#include <malloc.h>
+#define ALLOCATION_SIZE(ptr) malloc_usable_size(ptr)
+#elif defined __APPLE__
+#include <malloc/malloc.h>
+#define ALLOCATION_SIZE(ptr) malloc_size(ptr)
+#elif defined _WIN32
+#include <malloc.h>
+#define ALLOCATION_SIZE(ptr) _msize(ptr)
+#endif
+
+#define TRACE_MAGIC   0x4352544b // KTRC
+#define TRACE_VERSION 2 // Version 1 has no per-tick deltas and replays at TRACE_TICK_MS.
+
+typedef struct trace_event
+{
+    Uint32 tick;
+    Uint32 btn;
+
+} trace_event_t;
+
+struct trace
+{
+    trace_event_t *events;
+    int event_count;
+    int event_capacity;
+    int next_event;
+
+    // Clock advance of every tick, so a replay steps the same frames as the recording.
+    Uint16 *delta;
+    Uint32 delta_capacity;
+    Uint64 wall_ticks;
+
+    char path[256];
+    bool recording;
+    bool replaying;
+    bool simulating;
+    Uint32 tick;
+    Uint32 tick_count;
+    unsigned int last_btn;
+    Uint64 virtual_ticks;
+
+    Uint32 state_hash;
+    Uint32 expected_hash;
+    bool has_expected_hash;
+};
+
+trace_stats_t trace_stats = { 0 };
+
+// Threads without a trace of their own, i.e. the app itself, share this one.
+static trace_t main_trace = { .state_hash = 0x811c9dc5 }; // FNV-1a offset basis.
+static SDL_TLSID bound_trace;
+
+static Uint64 latency[TRACE_LATENCY_SAMPLES];
+static int latency_count = 0;
+static Uint64 latency_total = 0;
+static Uint64 latency_events = 0;
+
+static Uint64 *frame_time = NULL;
+static int frame_count = 0;
+static int frame_capacity = 0;
+
+#if defined ALLOCATION_SIZE
+static SDL_malloc_func original_malloc;
+static SDL_calloc_func original_calloc;
+static SDL_realloc_func original_realloc;
+static SDL_free_func original_free;
+#endif
+#if defined BENCHMARK
+static SDL_AtomicInt memory_in_use;
+static SDL_AtomicInt memory_peak;
+static bool is_tracking_memory = false;
+#endif
+
+static trace_t *get_trace(void)
+{
+    trace_t *trace = (trace_t *)SDL_GetTLS(&bound_trace);
+    return trace ? trace : &main_trace;
+}
+
+static bool push_event(trace_t *trace, Uint32 event_tick, Uint32 btn)
+{
+    if (trace->event_count >= trace->event_capacity)
+    {
+        int capacity = trace->event_capacity ? trace->event_capacity * 2 : 256;
+        trace_event_t *resized = (trace_event_t *)SDL_realloc(trace->events, sizeof(trace_event_t) * capacity);
+        if (!resized)
+        {
+            SDL_Log("Error allocating memory for input trace");
+            return false;
+        }
+        trace->events = resized;
+        trace->event_capacity = capacity;
+    }
+
+    trace->events[trace->event_count].tick = event_tick;
+    trace->events[trace->event_count].btn = btn;
+    trace->event_count += 1;
+    return true;
+}
+
+static bool push_delta(trace_t *trace, Uint32 delta)
+{
+    if (trace->tick >= trace->delta_capacity)
+    {
+        Uint32 capacity = trace->delta_capacity ? trace->delta_capacity * 2 : 1024;
+        Uint16 *resized = (Uint16 *)SDL_realloc(trace->delta, sizeof(Uint16) * capacity);
+        if (!resized)
+        {
+            SDL_Log("Error allocating memory for input trace");
+            return false;
+        }
+        trace->delta = resized;
+        trace->delta_capacity = capacity;
+    }
+
+    trace->delta[trace->tick] = (Uint16)SDL_min(delta, 0xffff);
+    return true;
+}
+
+static void clear_events(trace_t *trace)
+{
+    SDL_free(trace->events);
+    trace->events = NULL;
+    trace->event_count = 0;
+    trace->event_capacity = 0;
+    SDL_free(trace->delta);
+    trace->delta = NULL;
+    trace->delta_capacity = 0;
+    trace->next_event = 0;
+    trace->tick = 0;
+    trace->tick_count = 0;
+    trace->last_btn = 0;
+}
+
+static int compare_frame_time(const void *a, const void *b)
+{
+    Uint64 lhs = *(const Uint64 *)a;
+    Uint64 rhs = *(const Uint64 *)b;
+
+    return (lhs > rhs) - (lhs < rhs);
+}
+
+trace_t *create_trace(void)
+{
+    trace_t *trace = (trace_t *)SDL_calloc(1, sizeof(trace_t));
+    if (!trace)
+    {
+        SDL_Log("Failed to allocate memory for input trace");
+        return NULL;
+    }
+
+    trace->state_hash = 0x811c9dc5;
+    return trace;
+}
+
+void destroy_trace(trace_t *trace)
+{
+    if (trace && trace != &main_trace)
+    {
+        clear_events(trace);
+        SDL_free(trace);
+    }
+}
+
+void bind_trace(trace_t *trace)
+{
+    // Every trace call on this thread goes to the bound trace; NULL falls back to the app's.
+    SDL_SetTLS(&bound_trace, trace, NULL);
+}
+
+Uint64 get_ticks(void)
+{
+    trace_t *trace = get_trace();
+
+    // Recordings and replays run on a virtual clock that only moves once per tick, so
+    // every call within a frame sees the same time in both.
+    if (trace->recording || trace->replaying || trace->simulating)
+    {
+        return trace->virtual_ticks;
+    }
+
+    return SDL_GetTicks();
+}
+
+void set_virtual_ticks(Uint64 ticks)
+{
+    trace_t *trace = get_trace();
+
+    // Simulation outside a replay, e.g. the solver, steps the game on the same clock.
+    trace->virtual_ticks = ticks;
+    trace->simulating = true;
+}
+
+void advance_virtual_ticks(void)
+{
+    get_trace()->virtual_ticks += TRACE_TICK_MS;
+}
+
+void stop_virtual_ticks(void)
+{
+    get_trace()->simulating = false;
+}
+
+bool start_recording(const char *file_name)
+{
+    trace_t *trace = get_trace();
+
+    clear_events(trace);
+    SDL_snprintf(trace->path, sizeof(trace->path), "%s", file_name);
+    trace->recording = true;
+
+    // A replay starts its clock at zero, so the recording does too.
+    if (!trace->simulating)
+    {
+        trace->virtual_ticks = 0;
+        trace->wall_ticks = SDL_GetTicks();
+    }
+
+    SDL_Log("Recording input trace to %s", trace->path);
+    return true;
+}
+
+void record_input(unsigned int btn, unsigned int *pressed, unsigned int *released)
+{
+    trace_t *trace = get_trace();
+
+    // Edges against the last recorded level, exactly what replay_input() will return.
+    if (pressed)
+    {
+        *pressed = btn & ~trace->last_btn;
+    }
+    if (released)
+    {
+        *released = trace->last_btn & ~btn;
+    }
+
+    if (!trace->recording)
+    {
+        return;
+    }
+
+    // Simulations, e.g. the solver, step the clock themselves by a fixed tick.
+    Uint32 delta = TRACE_TICK_MS;
+    if (!trace->simulating)
+    {
+        Uint64 now = SDL_GetTicks();
+        delta = (Uint32)SDL_min(now - trace->wall_ticks, 0xffff);
+        trace->wall_ticks = now;
+        trace->virtual_ticks += delta;
+    }
+
+    if (!push_delta(trace, delta))
+    {
+        trace->recording = false;
+        return;
+    }
+
+    // Only changes are stored; a trace of idle play stays tiny.
+    if (0 == trace->tick || btn != trace->last_btn)
+    {
+        if (!push_event(trace, trace->tick, (Uint32)btn))
+        {
+            trace->recording = false;
+            return;
+        }
+        trace->last_btn = btn;
+    }
+
+    trace->tick += 1;
+}
+
+bool stop_recording(void)
+{
+    trace_t *trace = get_trace();
+
+    if (!trace->recording)
+    {
+        return true;
+    }
+    trace->recording = false;
+
+    SDL_IOStream *io = SDL_IOFromFile(trace->path, "wb");
+    if (!io)
+    {
+        SDL_Log("Couldn't write input trace %s: %s", trace->path, SDL_GetError());
+        clear_events(trace);
+        return false;
+    }
+
+    bool exit_code = SDL_WriteU32LE(io, TRACE_MAGIC) &&
+                     SDL_WriteU32LE(io, TRACE_VERSION) &&
+                     SDL_WriteU32LE(io, trace->tick) &&
+                     SDL_WriteU32LE(io, (Uint32)trace->event_count);
+
+    for (int index = 0; exit_code && index < trace->event_count; index += 1)
+    {
+        exit_code = SDL_WriteU32LE(io, trace->events[index].tick) && SDL_WriteU32LE(io, trace->events[index].btn);
+    }
+
+    for (Uint32 index = 0; exit_code && index < trace->tick; index += 1)
+    {
+        exit_code = SDL_WriteU16LE(io, trace->delta[index]);
+    }
+
+    if (!SDL_CloseIO(io))
+    {
+        exit_code = false;
+    }
+
+    if (exit_code)
+    {
+        SDL_Log("Recorded %u ticks, %d input change(s)", trace->tick, trace->event_count);
+    }
+    else
+    {
+        SDL_Log("Error writing input trace %s: %s", trace->path, SDL_GetError());
+    }
+
+    clear_events(trace);
+    return exit_code;
+}
+
+bool is_recording(void)
+{
+    return get_trace()->recording;
+}
+
+bool start_replay(const char *file_name)
+{
+    trace_t *trace = get_trace();
+    Uint32 magic = 0;
+    Uint32 version = 0;
+    Uint32 count = 0;
+
+    clear_events(trace);
+
+    SDL_IOStream *io = SDL_IOFromFile(file_name, "rb");
+    if (!io)
+    {
+        SDL_Log("Couldn't open input trace %s: %s", file_name, SDL_GetError());
+        return false;
+    }
+
+    if (!SDL_ReadU32LE(io, &magic) || !SDL_ReadU32LE(io, &version) ||
+        !SDL_ReadU32LE(io, &trace->tick_count) || !SDL_ReadU32LE(io, &count) ||
+        magic != TRACE_MAGIC || version < 1 || version > TRACE_VERSION)
+    {
+        SDL_Log("Invalid input trace: %s", file_name);
+        SDL_CloseIO(io);
+        return false;
+    }
+
+    for (Uint32 index = 0; index < count; index += 1)
+    {
+        Uint32 event_tick = 0;
+        Uint32 btn = 0;
+
+        if (!SDL_ReadU32LE(io, &event_tick) || !SDL_ReadU32LE(io, &btn) || !push_event(trace, event_tick, btn))
+        {
+            SDL_Log("Truncated input trace: %s", file_name);
+            SDL_CloseIO(io);
+            clear_events(trace);
+            return false;
+        }
+    }
+
+    if (version >= 2)
+    {
+        trace->delta = (Uint16 *)SDL_malloc(sizeof(Uint16) * SDL_max(trace->tick_count, 1));
+        if (!trace->delta)
+        {
+            SDL_Log("Error allocating memory for input trace");
+            SDL_CloseIO(io);
+            clear_events(trace);
+            return false;
+        }
+        trace->delta_capacity = trace->tick_count;
+
+        for (Uint32 index = 0; index < trace->tick_count; index += 1)
+        {
+            if (!SDL_ReadU16LE(io, &trace->delta[index]))
+            {
+                SDL_Log("Truncated input trace: %s", file_name);
+                SDL_CloseIO(io);
+                clear_events(trace);
+                return false;
+            }
+        }
+    }
+    SDL_CloseIO(io);
+
+    if (trace == &main_trace)
+    {
+        SDL_zero(trace_stats);
+    }
+    trace->state_hash = 0x811c9dc5;
+    trace->virtual_ticks = 0;
+    trace->replaying = true;
+
+    SDL_Log("Replaying %u ticks from %s", trace->tick_count, file_name);
+    return true;
+}
+
+bool is_replaying(void)
+{
+    return get_trace()->replaying;
+}
+
+bool replay_input(unsigned int *pressed, unsigned int *released)
+{
+    trace_t *trace = get_trace();
+    unsigned int btn = trace->last_btn;
+
+    if (!trace->replaying || trace->tick >= trace->tick_count)
+    {
+        return false;
+    }
+
+    while (trace->next_event < trace->event_count && trace->events[trace->next_event].tick <= trace->tick)
+    {
+        btn = trace->events[trace->next_event].btn;
+        trace->next_event += 1;
+    }
+
+    // Edges rather than levels: game code may clear held buttons itself.
+    *pressed = btn & ~trace->last_btn;
+    *released = trace->last_btn & ~btn;
+    trace->last_btn = btn;
+
+    trace->virtual_ticks += trace->delta ? trace->delta[trace->tick] : TRACE_TICK_MS;
+    trace->tick += 1;
+    return true;
+}
+
+void add_frame_time(Uint64 ns)
+{
+    if (frame_count >= frame_capacity)
+    {
+        int capacity = frame_capacity ? frame_capacity * 2 : 1024;
+        Uint64 *resized = (Uint64 *)SDL_realloc(frame_time, sizeof(Uint64) * capacity);
+        if (!resized)
+        {
+            return;
+        }
+        frame_time = resized;
+        frame_capacity = capacity;
+    }
+
+    frame_time[frame_count] = ns;
+    frame_count += 1;
+}
+
+void add_state_hash(Sint32 value)
+{
+    trace_t *trace = get_trace();
+    Uint32 bits = (Uint32)value;
+
+    // Byte-wise FNV-1a, so the hash does not depend on host endianness.
+    for (int shift = 0; shift < 32; shift += 8)
+    {
+        trace->state_hash ^= (bits >> shift) & 0xff;
+        trace->state_hash *= 0x01000193;
+    }
+}
+
+Uint32 get_state_hash(void)
+{
+    return get_trace()->state_hash;
+}
+
+void expect_state_hash(Uint32 hash)
+{
+    trace_t *trace = get_trace();
+
+    trace->expected_hash = hash;
+    trace->has_expected_hash = true;
+}
+
+bool report_replay(void)
+{
+    trace_t *trace = get_trace();
+    bool exit_code = true;
+
+    SDL_Log("State hash:    0x%08" SDL_PRIx32, trace->state_hash);
+    if (trace->has_expected_hash && trace->expected_hash != trace->state_hash)
+    {
+        SDL_Log("State hash mismatch, expected 0x%08" SDL_PRIx32, trace->expected_hash);
+        exit_code = false;
+    }
+
+    if (!frame_count)
+    {
+        SDL_Log("Replay produced no frames");
+        return exit_code;
+    }
+
+    SDL_qsort(frame_time, frame_count, sizeof(Uint64), compare_frame_time);
+
+    Uint64 total = 0;
+    for (int index = 0; index < frame_count; index += 1)
+    {
+        total += frame_time[index];
+    }
+
+    SDL_Log("Frames:        %d", frame_count);
+    SDL_Log("Frame time:    mean %.3f ms, p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms",
+            (double)total / frame_count / 1000000.0,
+            (double)frame_time[(frame_count - 1) * 50 / 100] / 1000000.0,
+            (double)frame_time[(frame_count - 1) * 90 / 100] / 1000000.0,
+            (double)frame_time[(frame_count - 1) * 99 / 100] / 1000000.0,
+            (double)frame_time[frame_count - 1] / 1000000.0);
+#if defined BENCHMARK
+    SDL_Log("Draw calls:    %" SDL_PRIu64 " (%.1f per frame)", trace_stats.draw_calls, (double)trace_stats.draw_calls / frame_count);
+    SDL_Log("Presents:      %" SDL_PRIu64, trace_stats.presents);
+    SDL_Log("Target swaps:  %" SDL_PRIu64 " (%.1f per frame)", trace_stats.target_switches, (double)trace_stats.target_switches / frame_count);
+    if (trace_stats.hud_updates)
+    {
+        SDL_Log("HUD swaps:     %" SDL_PRIu64 " (%.2f per HUD update)", trace_stats.hud_target_switches, (double)trace_stats.hud_target_switches / trace_stats.hud_updates);
+    }
+#else
+    SDL_Log("Build with -DBENCHMARK=ON to count draw calls and presents");
+#endif
+
+    return exit_code;
+}
+
+void stop_replay(void)
+{
+    trace_t *trace = get_trace();
+
+    trace->replaying = false;
+    clear_events(trace);
+
+    // Frame times are only collected for the app's own replay.
+    if (trace == &main_trace)
+    {
+        SDL_free(frame_time);
+        frame_time = NULL;
+        frame_count = 0;
+        frame_capacity = 0;
+    }
+}
+
+void add_input_latency(Uint64 ns)
+{
+    // Keeps the most recent samples; totals cover the whole session.
+    latency[latency_events % TRACE_LATENCY_SAMPLES] = ns;
+    if (latency_count < TRACE_LATENCY_SAMPLES)
+    {
+        latency_count += 1;
+    }
+    latency_total += ns;
+    latency_events += 1;
+}
+
+void report_input_latency(void)
+{
+    if (!latency_events)
+    {
+        return;
+    }
+
+    SDL_qsort(latency, latency_count, sizeof(Uint64), compare_frame_time);
+
+    SDL_Log("Input to present: %" SDL_PRIu64 " press(es), mean %.3f ms, p50 %.3f ms, p99 %.3f ms, max %.3f ms",
+            latency_events,
+            (double)latency_total / latency_events / 1000000.0,
+            (double)latency[(latency_count - 1) * 50 / 100] / 1000000.0,
+            (double)latency[(latency_count - 1) * 99 / 100] / 1000000.0,
+            (double)latency[latency_count - 1] / 1000000.0);
+}
+
+#if defined ALLOCATION_SIZE
+static void count_allocation(void *ptr)
+{
+    if (!ptr)
+    {
+        return;
+    }
+
+    int size = (int)ALLOCATION_SIZE(ptr);
+    int in_use = SDL_AddAtomicInt(&memory_in_use, size) + size;
+    int peak = SDL_GetAtomicInt(&memory_peak);
+    while (in_use > peak && !SDL_CompareAndSwapAtomicInt(&memory_peak, peak, in_use))
+    {
+        peak = SDL_GetAtomicInt(&memory_peak);
+    }
+}
+
+static void *tracked_malloc(size_t size)
+{
+    void *ptr = original_malloc(size);
+    count_allocation(ptr);
+    return ptr;
+}
+
+static void *tracked_calloc(size_t nmemb, size_t size)
+{
+    void *ptr = original_calloc(nmemb, size);
+    count_allocation(ptr);
+    return ptr;
+}
+
+static void *tracked_realloc(void *mem, size_t size)
+{
+    int old_size = mem ? (int)ALLOCATION_SIZE(mem) : 0;
+    void *ptr = original_realloc(mem, size);
+    if (ptr || !size)
+    {
+        SDL_AddAtomicInt(&memory_in_use, -old_size);
+        count_allocation(ptr);
+    }
+    return ptr;
+}
+
+static void tracked_free(void *mem)
+{
+    if (mem)
+    {
+        SDL_AddAtomicInt(&memory_in_use, -(int)ALLOCATION_SIZE(mem));
+    }
+    original_free(mem);
+}
+#endif
+
+#if defined BENCHMARK
+bool track_memory(void)
+{
+#if defined ALLOCATION_SIZE
+    if (is_tracking_memory)
+    {
+        return true;
+    }
+
+    // Blocks allocated before this point are freed through the same allocator, so the
+    // hooks may go in late; only the counts are relative to wherever they started.
+    SDL_GetOriginalMemoryFunctions(&original_malloc, &original_calloc, &original_realloc, &original_free);
+    is_tracking_memory = SDL_SetMemoryFunctions(tracked_malloc, tracked_calloc, tracked_realloc, tracked_free);
+#endif
+
+    return is_tracking_memory;
+}
+
+Sint64 reset_memory_peak(void)
+{
+    int in_use = SDL_GetAtomicInt(&memory_in_use);
+    SDL_SetAtomicInt(&memory_peak, in_use);
+    return in_use;
+}
+
+Sint64 get_memory_peak(void)
+{
+    return is_tracking_memory ? SDL_GetAtomicInt(&memory_peak) : -1;
+}
+#endif
@@ -0,0 +1,80 @@
+/** @file trace.h
+ *
+ *  A minimalist, cross-platform puzzle-platformer, designed
+ *  especially for the Nokia N-Gage.
+ *
+ *  Copyright (c) 2026, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <SDL3/SDL.h>
+
+#define TRACE_TICK_MS         16
+#define TRACE_LATENCY_SAMPLES 1024
+
+typedef struct trace_stats
+{
+    Uint64 draw_calls;
+    Uint64 presents;
+    Uint64 target_switches;
+    Uint64 hud_updates;
+    Uint64 hud_target_switches;
+
+} trace_stats_t;
+
+typedef struct trace trace_t;
+
+extern trace_stats_t trace_stats;
+
+#if defined BENCHMARK
+// Count renderer work without touching every call site.
+#define SDL_RenderTexture(renderer, texture, src, dst) \
+    (trace_stats.draw_calls++, SDL_RenderTexture(renderer, texture, src, dst))
+#define SDL_RenderTextureRotated(renderer, texture, src, dst, angle, center, flip) \
+    (trace_stats.draw_calls++, SDL_RenderTextureRotated(renderer, texture, src, dst, angle, center, flip))
+#define SDL_RenderClear(renderer) \
+    (trace_stats.draw_calls++, SDL_RenderClear(renderer))
+#define SDL_RenderPresent(renderer) \
+    (trace_stats.presents++, SDL_RenderPresent(renderer))
+#define SDL_SetRenderTarget(renderer, texture) \
+    (trace_stats.target_switches++, SDL_SetRenderTarget(renderer, texture))
+#endif
+
+trace_t *create_trace(void);
+void destroy_trace(trace_t *trace);
+void bind_trace(trace_t *trace);
+
+Uint64 get_ticks(void);
+void set_virtual_ticks(Uint64 ticks);
+void advance_virtual_ticks(void);
+void stop_virtual_ticks(void);
+
+bool start_recording(const char *file_name);
+void record_input(unsigned int btn, unsigned int *pressed, unsigned int *released);
+bool stop_recording(void);
+bool is_recording(void);
+
+bool start_replay(const char *file_name);
+bool is_replaying(void);
+bool replay_input(unsigned int *pressed, unsigned int *released);
+void add_frame_time(Uint64 ns);
+void add_state_hash(Sint32 value);
+Uint32 get_state_hash(void);
+void expect_state_hash(Uint32 hash);
+bool report_replay(void);
+void stop_replay(void);
+
+void add_input_latency(Uint64 ns);
+void report_input_latency(void);
+
+#if defined BENCHMARK
+bool track_memory(void);
+Sint64 reset_memory_peak(void);
+Sint64 get_memory_peak(void);
+#endif
+
+#endif // TRACE_H
@@ -10,142 +10,306 @@
 
 #include <SDL3/SDL.h>
 
+#include "config.h"
 #include "pfs.h"
 #include "utils.h"
 
 #define STBI_ONLY_PNG
+#define STBI_MALLOC(size)        SDL_malloc(size)
+#define STBI_REALLOC(ptr, size)  SDL_realloc(ptr, size)
+#define STBI_FREE(ptr)           SDL_free(ptr)
 #define STBI_NO_THREAD_LOCALS
+#if !defined __EMSCRIPTEN__
+// PNG data goes through zlib, which is linked for archives and maps anyway.
+static char *inflate_png(const char *buffer, int len, int initial_size, int *outlen, int parse_header);
+#define STBI_ZLIB_DECODE inflate_png
+#endif
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
-bool load_surface_from_file(const char *file_name, SDL_Surface **surface)
+#if !defined __EMSCRIPTEN__
+static char *inflate_png(const char *buffer, int len, int initial_size, int *outlen, int parse_header)
 {
-    Uint8 *buffer;
-    SDL_IOStream *asset;
-    size_t file_size;
-
-    if (!file_name)
+    size_t size = 0;
+    uint8_t *output = inflate_buffer((const uint8_t *)buffer, (size_t)len, (size_t)initial_size, &size, parse_header ? PFS_WRAP_ZLIB : PFS_WRAP_RAW);
+    if (!output || size > (size_t)SDL_MAX_SINT32)
     {
-        return true;
+        SDL_free(output);
+        stbi__err("bad zlib", "Corrupt PNG");
+        return NULL;
     }
-    SDL_Log("Loading texture from file: %s", file_name);
 
-    buffer = (Uint8 *)load_binary_file_from_path(file_name);
+    *outlen = (int)size;
+    return (char *)output;
+}
+#endif
+
+Uint8 *load_pixels_from_file(const char *file_name, int *width, int *height)
+{
+    int bpp;
+
+    SDL_Log("Loading image from file: %s", file_name);
+
+    Uint8 *buffer = (Uint8 *)load_binary_file_from_path(file_name);
     if (!buffer)
     {
         SDL_Log("Failed to load asset: %s", file_name);
-        return false;
-    }
-
-    file_size = size_of_file(file_name);
-    asset = SDL_IOFromConstMem((Uint8 *)buffer, file_size);
-    if (!asset)
-    {
-        SDL_free(buffer);
-        SDL_Log("Failed to convert asset %s: %s", file_name, SDL_GetError());
-        return false;
+        return NULL;
     }
 
-    int width, height, bpp;
-    stbi_uc *pixels = stbi_load_from_memory(buffer, (int)file_size, &width, &height, &bpp, 4);
+    stbi_uc *pixels = stbi_load_from_memory(buffer, (int)size_of_file(file_name), width, height, &bpp, 4);
+    SDL_free(buffer);
     if (!pixels)
     {
         SDL_Log("Couldn't load image data: %s", stbi_failure_reason());
-        SDL_free(buffer);
-        return false;
+        return NULL;
     }
-    SDL_free(buffer);
 
-    *surface = SDL_CreateSurfaceFrom(width, height, SDL_PIXELFORMAT_RGBA32, (void *)pixels, width * 4);
-    if (!*surface)
+    return (Uint8 *)pixels;
+}
+
+static SDL_PixelFormat get_texture_format(SDL_Renderer *renderer)
+{
+    const SDL_PixelFormat *format = (const SDL_PixelFormat *)SDL_GetPointerProperty(SDL_GetRendererProperties(renderer), SDL_PROP_RENDERER_TEXTURE_FORMATS_POINTER, NULL);
+    SDL_PixelFormat fallback = SDL_PIXELFORMAT_UNKNOWN;
+
+    // Like SDL_CreateTextureFromSurface() for a colour-keyed image: the renderer's
+    // first format with alpha, else its first format, as long as rows can be packed.
+    for (; format && *format != SDL_PIXELFORMAT_UNKNOWN; format += 1)
     {
-        SDL_free(buffer);
-        SDL_Log("Failed to load image: %s", SDL_GetError());
-        return false;
+        int bytes = SDL_BYTESPERPIXEL(*format);
+        if (!SDL_ISPIXELFORMAT_PACKED(*format) || SDL_ISPIXELFORMAT_10BIT(*format) || (bytes != 2 && bytes != 4))
+        {
+            continue;
+        }
+
+        if (SDL_ISPIXELFORMAT_ALPHA(*format))
+        {
+            return *format;
+        }
+        if (SDL_PIXELFORMAT_UNKNOWN == fallback)
+        {
+            fallback = *format;
+        }
     }
 
-    const SDL_PixelFormatDetails *format_details = SDL_GetPixelFormatDetails((*surface)->format);
-    if (!SDL_SetSurfaceColorKey(*surface, true, SDL_MapRGB(format_details, NULL, 0xff, 0x00, 0xff)))
+    return (SDL_PIXELFORMAT_UNKNOWN != fallback) ? fallback : SDL_PIXELFORMAT_ARGB8888;
+}
+
+static Uint32 pack_channel(Uint8 value, Uint8 bits, Uint8 shift)
+{
+    return bits ? ((Uint32)(value >> (8 - bits)) << shift) : 0;
+}
+
+static void convert_pixels(Uint8 *pixels, int width, int height, const SDL_PixelFormatDetails *details)
+{
+    bool has_alpha = details->Abits > 0;
+    int bytes = details->bytes_per_pixel;
+
+    // In place, front to back: a packed pixel is never wider than the RGBA one it replaces.
+    for (int y = 0; y < height; y += 1)
     {
-        SDL_Log("Couldn't set surface color key: %s", SDL_GetError());
-        SDL_DestroySurface(*surface);
-        return false;
+        const Uint8 *src = pixels + ((size_t)y * width * 4);
+        Uint8 *dst = pixels + ((size_t)y * width * bytes);
+
+        for (int x = 0; x < width; x += 1, src += 4, dst += bytes)
+        {
+            Uint8 r = src[0];
+            Uint8 g = src[1];
+            Uint8 b = src[2];
+            Uint8 a = src[3];
+
+            // Magenta is the colour key; without an alpha channel it stays magenta, as before.
+            if (has_alpha && 0xff == r && 0x00 == g && 0xff == b)
+            {
+                a = 0x00;
+            }
+
+            Uint32 value = pack_channel(r, details->Rbits, details->Rshift) |
+                           pack_channel(g, details->Gbits, details->Gshift) |
+                           pack_channel(b, details->Bbits, details->Bshift) |
+                           pack_channel(a, details->Abits, details->Ashift);
+
+            if (4 == bytes)
+            {
+                *(Uint32 *)dst = value;
+            }
+            else
+            {
+                *(Uint16 *)dst = (Uint16)value;
+            }
+        }
     }
-
-    return true;
 }
 
 bool load_texture_from_file(const char *file_name, SDL_Texture **texture, SDL_Renderer *renderer)
 {
-    Uint8 *buffer;
-    SDL_IOStream *asset;
-    SDL_Surface *surface;
-    size_t file_size;
+    int width, height;
 
     if (!file_name)
     {
         return true;
     }
-    SDL_Log("Loading texture from file: %s", file_name);
 
-    buffer = (Uint8 *)load_binary_file_from_path(file_name);
-    if (!buffer)
+    Uint8 *pixels = load_pixels_from_file(file_name, &width, &height);
+    if (!pixels)
     {
-        SDL_Log("Failed to load asset: %s", file_name);
         return false;
     }
 
-    file_size = size_of_file(file_name);
-    asset = SDL_IOFromConstMem((Uint8 *)buffer, file_size);
-    if (!asset)
+    // One decode, converted where it lies, one upload; no surfaces in between.
+    SDL_PixelFormat format = get_texture_format(renderer);
+    const SDL_PixelFormatDetails *details = SDL_GetPixelFormatDetails(format);
+    if (!details)
     {
-        SDL_free(buffer);
-        SDL_Log("Failed to convert asset %s: %s", file_name, SDL_GetError());
+        SDL_Log("Couldn't get pixel format details: %s", SDL_GetError());
+        SDL_free(pixels);
         return false;
     }
+    convert_pixels(pixels, width, height, details);
 
-    int width, height, bpp;
-    stbi_uc *pixels = stbi_load_from_memory(buffer, (int)file_size, &width, &height, &bpp, 4);
-    if (!pixels)
+    *texture = SDL_CreateTexture(renderer, format, SDL_TEXTUREACCESS_STATIC, width, height);
+    if (!*texture)
     {
-        SDL_Log("Couldn't load image data: %s", stbi_failure_reason());
-        SDL_free(buffer);
+        SDL_Log("Could not create texture: %s", SDL_GetError());
+        SDL_free(pixels);
         return false;
     }
-    SDL_free(buffer);
 
-    surface = SDL_CreateSurfaceFrom(width, height, SDL_PIXELFORMAT_RGBA32, (void *)pixels, width * 4);
-    if (!surface)
+    bool exit_code = SDL_UpdateTexture(*texture, NULL, pixels, width * details->bytes_per_pixel);
+    SDL_free(pixels);
+    if (!exit_code)
     {
-        SDL_free(buffer);
-        SDL_Log("Failed to load image: %s", SDL_GetError());
+        SDL_Log("Could not upload texture: %s", SDL_GetError());
+        SDL_DestroyTexture(*texture);
+        *texture = NULL;
         return false;
     }
 
-    const SDL_PixelFormatDetails *format_details = SDL_GetPixelFormatDetails(surface->format);
-    if (!SDL_SetSurfaceColorKey(surface, true, SDL_MapRGB(format_details, NULL, 0xff, 0x00, 0xff)))
+    if (details->Abits && !SDL_SetTextureBlendMode(*texture, SDL_BLENDMODE_BLEND))
     {
-        SDL_Log("Couldn't set surface color key: %s", SDL_GetError());
-        SDL_DestroySurface(surface);
-        return false;
+        SDL_Log("Couldn't set texture blend mode: %s", SDL_GetError());
     }
 
-    *texture = SDL_CreateTextureFromSurface(renderer, surface);
-    if (!*texture)
+    if (!SDL_SetTextureScaleMode(*texture, SDL_SCALEMODE_NEAREST))
     {
-        SDL_Log("Could not create texture from surface: %s", SDL_GetError());
-        SDL_DestroySurface(surface);
-        return false;
+        SDL_Log("Couldn't set texture scale mode: %s", SDL_GetError());
     }
 
-    if (!SDL_SetTextureScaleMode(*texture, SDL_SCALEMODE_NEAREST))
+    return true;
+}
+
+#if defined BENCHMARK
+static int compare_ns(const void *a, const void *b)
+{
+    Uint64 lhs = *(const Uint64 *)a;
+    Uint64 rhs = *(const Uint64 *)b;
+
+    return (lhs > rhs) - (lhs < rhs);
+}
+
+typedef struct image_bench
+{
+    SDL_Renderer *renderer;
+    int runs;
+    Uint64 *sample;
+    bool has_memory;
+
+} image_bench_t;
+
+static bool benchmark_image(const char *name, void *userdata)
+{
+    image_bench_t *bench = (image_bench_t *)userdata;
+    Uint64 *sample = bench->sample;
+    Uint64 *decode = sample + bench->runs;
+    int runs = bench->runs;
+    Sint64 peak = 0;
+    float width = 0.f;
+    float height = 0.f;
+
+    // Maps, sounds and the world file share the pack.
+    size_t length = SDL_strlen(name);
+    if (length < 4 || SDL_strcasecmp(name + length - 4, ".png") != 0)
     {
-        SDL_Log("Couldn't set texture scale mode: %s", SDL_GetError());
+        return true;
+    }
+
+    for (int run = 0; run < runs; run += 1)
+    {
+        SDL_Texture *texture = NULL;
+        int pixels_w, pixels_h;
+
+        Uint64 start = SDL_GetTicksNS();
+        Uint8 *pixels = load_pixels_from_file(name, &pixels_w, &pixels_h);
+        decode[run] = SDL_GetTicksNS() - start;
+        if (!pixels)
+        {
+            return false;
+        }
+        SDL_free(pixels);
+
+        Sint64 base = reset_memory_peak();
+        start = SDL_GetTicksNS();
+        if (!load_texture_from_file(name, &texture, bench->renderer))
+        {
+            return false;
+        }
+        sample[run] = SDL_GetTicksNS() - start;
+
+        // Counts the decode buffer and whatever the renderer keeps for the texture.
+        if (bench->has_memory && get_memory_peak() - base > peak)
+        {
+            peak = get_memory_peak() - base;
+        }
+
+        SDL_GetTextureSize(texture, &width, &height);
+        SDL_DestroyTexture(texture);
+    }
+
+    SDL_qsort(sample, runs, sizeof(Uint64), compare_ns);
+    SDL_qsort(decode, runs, sizeof(Uint64), compare_ns);
+
+    if (bench->has_memory)
+    {
+        SDL_Log("%-20s %4dx%-4d %8.3f %8.3f %8.3f %8.1f", name, (int)width, (int)height,
+                (double)decode[(runs - 1) / 2] / 1000000.0,
+                (double)sample[(runs - 1) / 2] / 1000000.0,
+                (double)sample[(runs - 1) * 95 / 100] / 1000000.0,
+                (double)peak / 1024.0);
+    }
+    else
+    {
+        SDL_Log("%-20s %4dx%-4d %8.3f %8.3f %8.3f      n/a", name, (int)width, (int)height,
+                (double)decode[(runs - 1) / 2] / 1000000.0,
+                (double)sample[(runs - 1) / 2] / 1000000.0,
+                (double)sample[(runs - 1) * 95 / 100] / 1000000.0);
     }
 
     return true;
 }
 
+bool benchmark_images(SDL_Renderer *renderer, int runs)
+{
+    // Every packed image, the frames of other platforms included, so a change of inflate
+    // shows up in the decode column whatever the image.
+    image_bench_t bench = { renderer, runs, NULL, get_memory_peak() >= 0 };
+
+    bench.sample = (Uint64 *)SDL_calloc(runs * 2, sizeof(Uint64));
+    if (!bench.sample)
+    {
+        SDL_Log("Failed to allocate memory for image benchmark");
+        return false;
+    }
+
+    SDL_Log("Image load over %d run(s): image, size, decode p50 ms, p50 ms, p95 ms, peak KiB", runs);
+
+    bool exit_code = for_each_entry(benchmark_image, &bench);
+
+    SDL_free(bench.sample);
+    return exit_code;
+}
+#endif
+
 /* djb2 by Dan Bernstein
  * http://www.cse.yorku.ca/~oz/hash.html
  */
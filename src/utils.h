@@ -14,6 +14,7 @@
 #include <SDL3/SDL.h>
 
 #include "fix32.h"
+#include "trace.h"
 
 typedef enum button
 {
@@ -53,15 +54,6 @@ typedef enum button
 #define CLEAR_BIT_FAST clear_bit
 #endif
 
-// Fast tile calculations using bit shifts since tile sizes are powers of 2.
-#define TILE_WIDTH_SHIFT 3   // 2^3 = 8 pixels (change to 4 for 16-pixel tiles)
-#define TILE_HEIGHT_SHIFT 3  // 2^3 = 8 pixels
-
-// Fast tile index calculation: (y / tile_height) * map_width + (x / tile_width)
-// Using bit shifts: (y >> TILE_HEIGHT_SHIFT) * map_width + (x >> TILE_WIDTH_SHIFT)
-#define GET_TILE_INDEX_FAST(x, y, map_width) \
-    (((y) >> TILE_HEIGHT_SHIFT) * (map_width) + ((x) >> TILE_WIDTH_SHIFT))
-
 // 256-entry sine lookup table (one full period, amplitude 2.0 baked in).
 // Values are fix32_t (16.16 fixed-point): sin(angle) * 2.0 * 65536.
 // Index with: SIN_LUT[(angle) & 0xFF]
@@ -100,20 +92,11 @@ static const fix32_t SIN_LUT[256] = {
  -25530, -22381, -19200, -16022, -12820,  -9630,  -6423,  -3218
 };
 
-// Fast position to tile coordinate.
-#define POS_TO_TILE_X(x) ((x) >> TILE_WIDTH_SHIFT)
-#define POS_TO_TILE_Y(y) ((y) >> TILE_HEIGHT_SHIFT)
-
-// Fast tile to position coordinate.
-#define TILE_TO_POS_X(tile_x) ((tile_x) << TILE_WIDTH_SHIFT)
-#define TILE_TO_POS_Y(tile_y) ((tile_y) << TILE_HEIGHT_SHIFT)
-
-// Snap position to tile grid.
-#define SNAP_TO_TILE_X(x) ((x) & ~((1 << TILE_WIDTH_SHIFT) - 1))
-#define SNAP_TO_TILE_Y(y) ((y) & ~((1 << TILE_HEIGHT_SHIFT) - 1))
-
-bool load_surface_from_file(const char *file_name, SDL_Surface **texture);
+Uint8 *load_pixels_from_file(const char *file_name, int *width, int *height);
 bool load_texture_from_file(const char *file_name, SDL_Texture **texture, SDL_Renderer *renderer);
+#if defined BENCHMARK
+bool benchmark_images(SDL_Renderer *renderer, int runs);
+#endif
 
 Uint64 generate_hash(const unsigned char *name);
 
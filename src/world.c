@@ -0,0 +1,729 @@
+/** @file world.c
+ *
+ *  A minimalist, cross-platform puzzle-platformer, designed
+ *  especially for the Nokia N-Gage.
+ *
+ *  Copyright (c) 2026, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <SDL3/SDL.h>
+
+#include "config.h"
+#include "kero.h"
+#include "map.h"
+#include "pfs.h"
+#include "raster.h"
+#include "utils.h"
+#include "world.h"
+
+static bool get_json_int(const char *object, const char *key, int *value)
+{
+    const char *pos = SDL_strstr(object, key);
+    if (!pos)
+    {
+        return false;
+    }
+
+    pos = SDL_strchr(pos + SDL_strlen(key), ':');
+    if (!pos)
+    {
+        return false;
+    }
+
+    *value = (int)SDL_strtol(pos + 1, NULL, 10);
+    return true;
+}
+
+static bool get_json_map_name(const char *object, char *file_name, size_t size)
+{
+    const char *pos = SDL_strstr(object, "\"fileName\"");
+    if (!pos)
+    {
+        return false;
+    }
+
+    pos = SDL_strchr(pos + 10, ':');
+    if (pos)
+    {
+        pos = SDL_strchr(pos, '"');
+    }
+    if (!pos)
+    {
+        return false;
+    }
+    pos += 1;
+
+    // The world references the plain .tmj sources, the archive may hold them compressed.
+    char base_name[8] = { 0 };
+    size_t length = 0;
+    while (pos[length] && pos[length] != '"' && pos[length] != '.' && length < sizeof(base_name) - 1)
+    {
+        base_name[length] = pos[length];
+        length += 1;
+    }
+
+    if (!length)
+    {
+        return false;
+    }
+
+    SDL_snprintf(file_name, size, "%s.%s", base_name, MAP_SUFFIX);
+    return true;
+}
+
+static bool spans_overlap(int a_start, int a_length, int b_start, int b_length)
+{
+    return (a_start < b_start + b_length) && (b_start < a_start + a_length);
+}
+
+static void find_open_edges(world_t *world)
+{
+    for (int index = 0; index < world->entry_count; index += 1)
+    {
+        world_map_t *a = &world->entry[index];
+        a->open_edges = 0;
+
+        for (int other = 0; other < world->entry_count; other += 1)
+        {
+            world_map_t *b = &world->entry[other];
+            if (other == index)
+            {
+                continue;
+            }
+
+            if (spans_overlap(a->y, a->height, b->y, b->height))
+            {
+                if (b->x + b->width == a->x)
+                {
+                    a->open_edges |= EDGE_LEFT;
+                }
+                if (a->x + a->width == b->x)
+                {
+                    a->open_edges |= EDGE_RIGHT;
+                }
+            }
+
+            if (spans_overlap(a->x, a->width, b->x, b->width))
+            {
+                if (b->y + b->height == a->y)
+                {
+                    a->open_edges |= EDGE_TOP;
+                }
+                if (a->y + a->height == b->y)
+                {
+                    a->open_edges |= EDGE_BOTTOM;
+                }
+            }
+        }
+    }
+}
+
+static bool contains_point(world_map_t *entry, int pos_x, int pos_y)
+{
+    return pos_x >= entry->x && pos_x < entry->x + entry->width &&
+           pos_y >= entry->y && pos_y < entry->y + entry->height;
+}
+
+static bool intersects_rect(world_map_t *entry, int left, int top, int right, int bottom)
+{
+    return entry->x < right && entry->x + entry->width > left &&
+           entry->y < bottom && entry->y + entry->height > top;
+}
+
+static bool place_map(world_t *world, world_map_t *entry, SDL_Renderer *renderer)
+{
+    map_t *map = entry->map;
+
+    map->world = world;
+    map->world_x = entry->x;
+    map->world_y = entry->y;
+    map->open_edges = entry->open_edges;
+
+    // Borrow the shared tileset so streaming a map never decodes the image again.
+#if defined SOFTWARE_RASTER
+    if (world->tileset_raster)
+    {
+        map->tileset_raster = world->tileset_raster;
+        map->prev_tileset_hash = world->tileset_hash;
+        map->shared_tileset = true;
+    }
+#else
+    if (world->tileset_texture)
+    {
+        map->tileset_texture = world->tileset_texture;
+        map->prev_tileset_hash = world->tileset_hash;
+        map->shared_tileset = true;
+    }
+#endif
+
+    if (!finish_map(map, renderer))
+    {
+        return false;
+    }
+
+#if defined SOFTWARE_RASTER
+    if (!world->tileset_raster)
+    {
+        world->tileset_raster = map->tileset_raster;
+        world->tileset_hash = map->tileset_hash;
+        map->shared_tileset = true;
+    }
+#else
+    if (!world->tileset_texture)
+    {
+        world->tileset_texture = map->tileset_texture;
+        world->tileset_hash = map->tileset_hash;
+        map->shared_tileset = true;
+    }
+#endif
+
+    return true;
+}
+
+static int SDLCALL world_loader(void *data)
+{
+    world_t *world = (world_t *)data;
+    world_map_t *entry = &world->entry[world->loading];
+    map_t *map = NULL;
+
+    if (prepare_map(entry->file_name, &map))
+    {
+        entry->map = map;
+
+#if defined SOFTWARE_RASTER
+        // Rasters are plain memory, so the whole map is composed here instead of on the main thread.
+        if (!place_map(world, entry, world->renderer) || !prerender_map(map, world->renderer, 0))
+        {
+            destroy_map(map);
+            entry->map = NULL;
+        }
+#endif
+    }
+    else
+    {
+        entry->map = NULL;
+    }
+
+    SDL_SetAtomicInt(&world->loader_done, 1);
+    return 0;
+}
+
+static void unload_entry(world_t *world, world_map_t *entry)
+{
+    if (entry->state == WORLD_MAP_UNLOADED || entry->state == WORLD_MAP_LOADING)
+    {
+        return;
+    }
+
+    SDL_Log("Unloading world map: %s", entry->file_name);
+
+    destroy_map(entry->map);
+    entry->map = NULL;
+    entry->state = WORLD_MAP_UNLOADED;
+    world->resident_count -= 1;
+}
+
+static void start_loading(world_t *world, int index)
+{
+    world_map_t *entry = &world->entry[index];
+
+    entry->state = WORLD_MAP_LOADING;
+    world->loading = index;
+    world->resident_count += 1;
+    SDL_SetAtomicInt(&world->loader_done, 0);
+
+    world->loader = SDL_CreateThread(world_loader, "world_loader", world);
+    if (!world->loader)
+    {
+        // No threads available: load in place.
+        world_loader(world);
+    }
+}
+
+static void poll_loader(world_t *world, SDL_Renderer *renderer)
+{
+    if (world->loading < 0 || !SDL_GetAtomicInt(&world->loader_done))
+    {
+        return;
+    }
+
+    if (world->loader)
+    {
+        SDL_WaitThread(world->loader, NULL);
+        world->loader = NULL;
+    }
+
+    world_map_t *entry = &world->entry[world->loading];
+    world->loading = -1;
+
+    if (!entry->map)
+    {
+        SDL_Log("Failed to stream world map: %s", entry->file_name);
+        entry->state = WORLD_MAP_UNLOADED;
+        world->resident_count -= 1;
+        return;
+    }
+
+#if defined SOFTWARE_RASTER
+    entry->state = WORLD_MAP_READY;
+#else
+    // Texture work has to happen on the render thread. Only the canvas is created here,
+    // update_world() draws into it a slice per frame.
+    entry->state = WORLD_MAP_PREPARED;
+    if (!place_map(world, entry, renderer))
+    {
+        SDL_Log("Failed to place world map: %s", entry->file_name);
+        unload_entry(world, entry);
+    }
+#endif
+}
+
+static void advance_static_pass(world_t *world, SDL_Renderer *renderer)
+{
+    for (int index = 0; index < world->entry_count; index += 1)
+    {
+        world_map_t *entry = &world->entry[index];
+        if (entry->state == WORLD_MAP_PREPARED)
+        {
+            if (prerender_map(entry->map, renderer, WORLD_CELLS_PER_FRAME))
+            {
+                entry->state = WORLD_MAP_READY;
+            }
+            return;
+        }
+    }
+}
+
+void destroy_world(world_t *world)
+{
+    if (!world)
+    {
+        return;
+    }
+
+    if (world->loader)
+    {
+        SDL_WaitThread(world->loader, NULL);
+        world->loader = NULL;
+    }
+
+    if (world->loading >= 0)
+    {
+        world_map_t *entry = &world->entry[world->loading];
+        entry->state = WORLD_MAP_PREPARED;
+        world->loading = -1;
+    }
+
+    for (int index = 0; index < world->entry_count; index += 1)
+    {
+        world_map_t *entry = &world->entry[index];
+        if (entry->map)
+        {
+            destroy_map(entry->map);
+            entry->map = NULL;
+        }
+        entry->state = WORLD_MAP_UNLOADED;
+    }
+
+    if (world->tileset_texture)
+    {
+        SDL_DestroyTexture(world->tileset_texture);
+        world->tileset_texture = NULL;
+    }
+
+#if defined SOFTWARE_RASTER
+    destroy_raster(world->tileset_raster);
+    world->tileset_raster = NULL;
+#endif
+
+    SDL_free(world);
+}
+
+bool load_world(const char *file_name, world_t **world)
+{
+    char *buffer = (char *)load_binary_file_from_path(file_name);
+    if (!buffer)
+    {
+        SDL_Log("Failed to load world: %s", file_name);
+        return false;
+    }
+
+    size_t buffer_size = size_of_file(file_name);
+    char *json = (char *)SDL_malloc(buffer_size + 1);
+    if (!json)
+    {
+        SDL_free(buffer);
+        SDL_Log("Error allocating memory for world");
+        return false;
+    }
+    SDL_memcpy(json, buffer, buffer_size);
+    json[buffer_size] = '\0';
+    SDL_free(buffer);
+
+    *world = (world_t *)SDL_calloc(1, sizeof(world_t));
+    if (!*world)
+    {
+        SDL_free(json);
+        SDL_Log("Error allocating memory for world");
+        return false;
+    }
+    (*world)->loading = -1;
+
+    const char *cursor = SDL_strstr(json, "\"maps\"");
+    if (cursor)
+    {
+        cursor = SDL_strchr(cursor, '[');
+    }
+
+    while (cursor && (*world)->entry_count < WORLD_MAP_MAX)
+    {
+        const char *object_start = SDL_strchr(cursor, '{');
+        const char *list_end = SDL_strchr(cursor, ']');
+        if (!object_start || (list_end && list_end < object_start))
+        {
+            break;
+        }
+
+        const char *object_end = SDL_strchr(object_start, '}');
+        if (!object_end)
+        {
+            break;
+        }
+
+        char object[256] = { 0 };
+        size_t length = (size_t)(object_end - object_start);
+        if (length >= sizeof(object))
+        {
+            length = sizeof(object) - 1;
+        }
+        SDL_memcpy(object, object_start, length);
+
+        world_map_t *entry = &(*world)->entry[(*world)->entry_count];
+        if (get_json_map_name(object, entry->file_name, sizeof(entry->file_name)) &&
+            get_json_int(object, "\"x\"", &entry->x) &&
+            get_json_int(object, "\"y\"", &entry->y) &&
+            get_json_int(object, "\"width\"", &entry->width) &&
+            get_json_int(object, "\"height\"", &entry->height))
+        {
+            (*world)->entry_count += 1;
+        }
+
+        cursor = object_end + 1;
+    }
+
+    SDL_free(json);
+
+    if (!(*world)->entry_count)
+    {
+        SDL_Log("World %s contains no maps", file_name);
+        destroy_world(*world);
+        *world = NULL;
+        return false;
+    }
+
+    find_open_edges(*world);
+
+    SDL_Log("Loaded world %s with %d map(s)", file_name, (*world)->entry_count);
+
+    return true;
+}
+
+bool enter_world(world_t *world, const char *file_name, map_t **map, SDL_Renderer *renderer)
+{
+    world->renderer = renderer;
+
+    for (int index = 0; index < world->entry_count; index += 1)
+    {
+        world_map_t *entry = &world->entry[index];
+        if (SDL_strcmp(entry->file_name, file_name) != 0)
+        {
+            continue;
+        }
+
+        // A map still in the loader is finished first rather than prepared twice.
+        if (entry->state == WORLD_MAP_LOADING && world->loader)
+        {
+            SDL_WaitThread(world->loader, NULL);
+            world->loader = NULL;
+        }
+        poll_loader(world, renderer);
+
+        if (entry->state == WORLD_MAP_UNLOADED)
+        {
+            if (!prepare_map(entry->file_name, &entry->map))
+            {
+                return false;
+            }
+            world->resident_count += 1;
+            entry->state = WORLD_MAP_PREPARED;
+
+            if (!place_map(world, entry, renderer))
+            {
+                unload_entry(world, entry);
+                return false;
+            }
+        }
+
+        // The map is entered right away, so its static pass cannot wait for later frames.
+        prerender_map(entry->map, renderer, 0);
+        entry->state = WORLD_MAP_READY;
+
+        world->active = index;
+        *map = entry->map;
+        return true;
+    }
+
+    SDL_Log("Map %s is not part of the world", file_name);
+    return false;
+}
+
+bool update_world(world_t *world, map_t **map, kero_t *kero, int cam_x, int cam_y, SDL_Renderer *renderer)
+{
+    poll_loader(world, renderer);
+    advance_static_pass(world, renderer);
+
+    // Hand kero over to the neighbouring map once it crosses a seam.
+    world_map_t *active = &world->entry[world->active];
+    int pos_x = active->x + fix32_to_int(kero->pos_x);
+    int pos_y = active->y + fix32_to_int(kero->pos_y);
+
+    if (!contains_point(active, pos_x, pos_y))
+    {
+        bool switched = false;
+
+        for (int index = 0; index < world->entry_count; index += 1)
+        {
+            world_map_t *entry = &world->entry[index];
+            if (index == world->active || entry->state != WORLD_MAP_READY)
+            {
+                continue;
+            }
+
+            if (contains_point(entry, pos_x, pos_y))
+            {
+                kero->pos_x += fix32_from_int(active->x - entry->x);
+                kero->pos_y += fix32_from_int(active->y - entry->y);
+                world->active = index;
+                *map = entry->map;
+                active = entry;
+                switched = true;
+                break;
+            }
+        }
+
+        if (!switched)
+        {
+            // Neighbour is not streamed in yet: hold kero at the seam.
+            if (kero->pos_x < fix32_from_int(KERO_HALF))
+            {
+                kero->pos_x = fix32_from_int(KERO_HALF);
+                kero->velocity_x = 0;
+            }
+            else if (kero->pos_x > fix32_from_int(active->width - KERO_HALF))
+            {
+                kero->pos_x = fix32_from_int(active->width - KERO_HALF);
+                kero->velocity_x = 0;
+            }
+            if (kero->pos_y < fix32_from_int(KERO_HALF))
+            {
+                kero->pos_y = fix32_from_int(KERO_HALF);
+                kero->velocity_y = 0;
+            }
+        }
+    }
+
+    // Drop maps that have moved well out of view.
+    int keep_left = cam_x - WORLD_UNLOAD_MARGIN;
+    int keep_top = cam_y - WORLD_UNLOAD_MARGIN;
+    int keep_right = cam_x + SCREEN_W + WORLD_UNLOAD_MARGIN;
+    int keep_bottom = cam_y + SCREEN_H + WORLD_UNLOAD_MARGIN;
+
+    for (int index = 0; index < world->entry_count; index += 1)
+    {
+        world_map_t *entry = &world->entry[index];
+        if (index == world->active)
+        {
+            continue;
+        }
+
+        if (entry->state == WORLD_MAP_READY && !intersects_rect(entry, keep_left, keep_top, keep_right, keep_bottom))
+        {
+            unload_entry(world, entry);
+        }
+    }
+
+    // Start streaming the closest map the camera is approaching.
+    if (world->loading < 0 && world->resident_count < WORLD_MAX_RESIDENT)
+    {
+        int want_left = cam_x - WORLD_PRELOAD_MARGIN;
+        int want_top = cam_y - WORLD_PRELOAD_MARGIN;
+        int want_right = cam_x + SCREEN_W + WORLD_PRELOAD_MARGIN;
+        int want_bottom = cam_y + SCREEN_H + WORLD_PRELOAD_MARGIN;
+        int center_x = cam_x + (SCREEN_W / 2);
+        int center_y = cam_y + (SCREEN_H / 2);
+        int best = -1;
+        Sint64 best_distance = 0;
+
+        for (int index = 0; index < world->entry_count; index += 1)
+        {
+            world_map_t *entry = &world->entry[index];
+            if (entry->state != WORLD_MAP_UNLOADED || !intersects_rect(entry, want_left, want_top, want_right, want_bottom))
+            {
+                continue;
+            }
+
+            Sint64 dx = (Sint64)(entry->x + (entry->width / 2) - center_x);
+            Sint64 dy = (Sint64)(entry->y + (entry->height / 2) - center_y);
+            Sint64 distance = (dx * dx) + (dy * dy);
+            if (best < 0 || distance < best_distance)
+            {
+                best = index;
+                best_distance = distance;
+            }
+        }
+
+        if (best >= 0)
+        {
+            SDL_Log("Streaming world map: %s", world->entry[best].file_name);
+            start_loading(world, best);
+        }
+    }
+
+    return true;
+}
+
+bool render_world(world_t *world, SDL_Renderer *renderer, bool *has_updated)
+{
+    *has_updated = false;
+
+    for (int index = 0; index < world->entry_count; index += 1)
+    {
+        world_map_t *entry = &world->entry[index];
+        bool map_updated = false;
+
+        if (entry->state != WORLD_MAP_READY)
+        {
+            continue;
+        }
+
+        if (!render_map(entry->map, renderer, &map_updated))
+        {
+            return false;
+        }
+
+        if (map_updated)
+        {
+            *has_updated = true;
+        }
+    }
+
+    return true;
+}
+
+const tile_desc_t *get_world_tile(world_t *world, int pos_x, int pos_y)
+{
+    for (int index = 0; index < world->entry_count; index += 1)
+    {
+        world_map_t *entry = &world->entry[index];
+
+        // Collision is available as soon as a map is prepared, before it is drawn.
+        if ((entry->state == WORLD_MAP_PREPARED || entry->state == WORLD_MAP_READY) && contains_point(entry, pos_x, pos_y))
+        {
+            return &entry->map->tile_desc[get_tile_index(pos_x - entry->x, pos_y - entry->y, entry->map)];
+        }
+    }
+
+    return NULL;
+}
+
+void clamp_world_camera(world_t *world, int *cam_x, int *cam_y)
+{
+    world_map_t *active = &world->entry[world->active];
+
+    // Only closed edges stop the camera; open ones look into the neighbour.
+    if (!(active->open_edges & EDGE_LEFT) && *cam_x < active->x)
+    {
+        *cam_x = active->x;
+    }
+    else if (!(active->open_edges & EDGE_RIGHT) && *cam_x > active->x + active->width - SCREEN_W)
+    {
+        *cam_x = active->x + active->width - SCREEN_W;
+    }
+
+    if (!(active->open_edges & EDGE_TOP) && *cam_y < active->y)
+    {
+        *cam_y = active->y;
+    }
+    else if (!(active->open_edges & EDGE_BOTTOM) && *cam_y > active->y + active->height - SCREEN_H)
+    {
+        *cam_y = active->y + active->height - SCREEN_H;
+    }
+}
+
+void draw_world(world_t *world, SDL_Renderer *renderer, int cam_x, int cam_y)
+{
+    world_map_t *active = &world->entry[world->active];
+    SDL_FRect src;
+    SDL_FRect dst;
+
+    if (active->map)
+    {
+        SDL_SetRenderDrawColor(renderer, active->map->bg_r, active->map->bg_g, active->map->bg_b, 255);
+        SDL_RenderClear(renderer);
+    }
+
+    for (int index = 0; index < world->entry_count; index += 1)
+    {
+        world_map_t *entry = &world->entry[index];
+        if (entry->state != WORLD_MAP_READY)
+        {
+            continue;
+        }
+
+        int left = SDL_max(entry->x, cam_x);
+        int top = SDL_max(entry->y, cam_y);
+        int right = SDL_min(entry->x + entry->width, cam_x + SCREEN_W);
+        int bottom = SDL_min(entry->y + entry->height, cam_y + SCREEN_H);
+
+        if (right <= left || bottom <= top)
+        {
+            continue;
+        }
+
+        src.x = (float)(left - entry->x);
+        src.y = (float)(top - entry->y);
+        src.w = (float)(right - left);
+        src.h = (float)(bottom - top);
+        dst.x = (float)(left - cam_x);
+        dst.y = (float)(top - cam_y);
+        dst.w = src.w;
+        dst.h = src.h;
+        SDL_RenderTexture(renderer, entry->map->render_target, &src, &dst);
+    }
+}
+
+#if defined SOFTWARE_RASTER
+void draw_world_raster(world_t *world, raster_t *frame, int cam_x, int cam_y)
+{
+    world_map_t *active = &world->entry[world->active];
+
+    if (active->map)
+    {
+        clear_raster(frame, active->map->bg_r, active->map->bg_g, active->map->bg_b);
+    }
+
+    for (int index = 0; index < world->entry_count; index += 1)
+    {
+        world_map_t *entry = &world->entry[index];
+        if (entry->state != WORLD_MAP_READY)
+        {
+            continue;
+        }
+
+        // blit_raster clips against the frame.
+        blit_raster(frame, entry->map->raster, 0, 0, entry->width, entry->height, entry->x - cam_x, entry->y - cam_y, false);
+    }
+}
+#endif
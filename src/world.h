@@ -0,0 +1,81 @@
+/** @file world.h
+ *
+ *  A minimalist, cross-platform puzzle-platformer, designed
+ *  especially for the Nokia N-Gage.
+ *
+ *  Copyright (c) 2026, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#ifndef WORLD_H
+#define WORLD_H
+
+#include <SDL3/SDL.h>
+
+#include "kero.h"
+#include "map.h"
+#include "raster.h"
+
+#define WORLD_MAP_MAX 16
+
+typedef enum world_map_state
+{
+    WORLD_MAP_UNLOADED = 0,
+    WORLD_MAP_LOADING,
+    WORLD_MAP_PREPARED, // Collision is usable, the static pass is still being drawn.
+    WORLD_MAP_READY
+
+} world_map_state_t;
+
+typedef struct world_map
+{
+    char file_name[16];
+
+    int x;
+    int y;
+    int width;
+    int height;
+
+    Uint8 open_edges;
+
+    map_t *map;
+    world_map_state_t state;
+
+} world_map_t;
+
+typedef struct world
+{
+    world_map_t entry[WORLD_MAP_MAX];
+    int entry_count;
+    int active;
+    int resident_count;
+
+    // Tileset shared by all resident maps, decoded by whichever is placed first.
+    SDL_Texture *tileset_texture;
+#if defined SOFTWARE_RASTER
+    raster_t *tileset_raster;
+#endif
+    Uint64 tileset_hash;
+
+    // Background loader; prepares at most one map at a time.
+    SDL_Renderer *renderer;
+    SDL_Thread *loader;
+    SDL_AtomicInt loader_done;
+    int loading;
+
+} world_t;
+
+void destroy_world(world_t *world);
+bool load_world(const char *file_name, world_t **world);
+bool enter_world(world_t *world, const char *file_name, map_t **map, SDL_Renderer *renderer);
+bool update_world(world_t *world, map_t **map, kero_t *kero, int cam_x, int cam_y, SDL_Renderer *renderer);
+bool render_world(world_t *world, SDL_Renderer *renderer, bool *has_updated);
+void clamp_world_camera(world_t *world, int *cam_x, int *cam_y);
+void draw_world(world_t *world, SDL_Renderer *renderer, int cam_x, int cam_y);
+const tile_desc_t *get_world_tile(world_t *world, int pos_x, int pos_y);
+#if defined SOFTWARE_RASTER
+void draw_world_raster(world_t *world, raster_t *frame, int cam_x, int cam_y);
+#endif
+
+#endif // WORLD_H
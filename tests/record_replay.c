@@ -0,0 +1,148 @@
+/** @file record_replay.c
+ *
+ *  A minimalist, cross-platform puzzle-platformer, designed
+ *  especially for the Nokia N-Gage.
+ *
+ *  Copyright (c) 2026, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <SDL3/SDL.h>
+
+#include "core.h"
+#include "pfs.h"
+#include "trace.h"
+
+#define RECORD_TICKS 240
+
+typedef struct key_step
+{
+    int tick;
+    SDL_Keycode key;
+    bool is_down;
+
+} key_step_t;
+
+// Starts the game from the menu with a tap, dismisses the dialogue, then walks and jumps.
+static const key_step_t steps[] = {
+    { 2, SDLK_X, true },
+    { 2, SDLK_X, false },
+    { 10, SDLK_X, true },
+    { 12, SDLK_X, false },
+    { 30, SDLK_RIGHT, true },
+    { 60, SDLK_Z, true },
+    { 64, SDLK_Z, false },
+    { 120, SDLK_RIGHT, false },
+    { 140, SDLK_LEFT, true },
+    { 141, SDLK_LEFT, false },
+};
+
+static bool push_key(core_t *nc, SDL_Keycode key, bool is_down)
+{
+    SDL_Event event;
+
+    SDL_zero(event);
+    event.type = is_down ? SDL_EVENT_KEY_DOWN : SDL_EVENT_KEY_UP;
+    event.key.key = key;
+    event.key.down = is_down;
+    event.key.timestamp = SDL_GetTicksNS();
+
+    nc->event = &event;
+    bool exit_code = handle_events(nc);
+    nc->event = NULL;
+    return exit_code;
+}
+
+static bool record(const char *file_name, Uint32 *hash, state_t *state)
+{
+    core_t *nc = NULL;
+    int next_step = 0;
+    bool exit_code = true;
+
+    if (!start_recording(file_name) || !init_headless(&nc))
+    {
+        return false;
+    }
+
+    // The same steps as a live frame: events are queued, then process_input() records and applies them.
+    for (int tick = 0; tick < RECORD_TICKS && exit_code; tick += 1)
+    {
+        while (next_step < (int)SDL_arraysize(steps) && steps[next_step].tick == tick)
+        {
+            exit_code = push_key(nc, steps[next_step].key, steps[next_step].is_down) && exit_code;
+            next_step += 1;
+        }
+
+        exit_code = exit_code && process_input(nc) && update(nc);
+        hash_state(nc);
+
+        // Real frames, so the recording stores wall-clock deltas.
+        SDL_Delay(TRACE_TICK_MS);
+    }
+
+    *hash = get_state_hash();
+    *state = nc->state;
+
+    exit_code = stop_recording() && exit_code;
+    destroy(nc);
+    return exit_code;
+}
+
+static bool replay(const char *file_name, Uint32 *hash, state_t *state)
+{
+    core_t *nc = NULL;
+    unsigned int pressed = 0;
+    unsigned int released = 0;
+
+    if (!start_replay(file_name) || !init_headless(&nc))
+    {
+        return false;
+    }
+
+    while (replay_input(&pressed, &released) && apply_buttons(nc, pressed, released) && update(nc))
+    {
+        hash_state(nc);
+    }
+
+    *hash = get_state_hash();
+    *state = nc->state;
+
+    stop_replay();
+    destroy(nc);
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *file_name = argc > 1 ? argv[1] : "record_replay.trace";
+    Uint32 recorded_hash = 0;
+    Uint32 replayed_hash = 0;
+    state_t recorded_state = STATE_INTRO;
+    state_t replayed_state = STATE_INTRO;
+
+    init_file_reader();
+
+    if (!record(file_name, &recorded_hash, &recorded_state) || !replay(file_name, &replayed_hash, &replayed_state))
+    {
+        SDL_Log("Recording or replaying %s failed", file_name);
+        return 1;
+    }
+
+    SDL_Log("Recorded hash: 0x%08" SDL_PRIx32 ", replayed hash: 0x%08" SDL_PRIx32, recorded_hash, replayed_hash);
+
+    // A start press lost from the trace would leave the replay in the menu.
+    if (STATE_GAME != recorded_state || STATE_GAME != replayed_state)
+    {
+        SDL_Log("Expected both runs to reach the game (recorded %d, replayed %d)", recorded_state, replayed_state);
+        return 1;
+    }
+
+    if (recorded_hash != replayed_hash)
+    {
+        SDL_Log("Replay diverged from the recording");
+        return 1;
+    }
+
+    return 0;
+}
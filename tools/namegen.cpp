@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+// Must match generate_hash() in src/utils.c (djb2).
+uint64_t djb2(const string &name) {
+    uint64_t hash = 5381;
+
+    for (unsigned char c : name) {
+        hash = ((hash << 5) + hash) + c;
+    }
+
+    return hash;
+}
+
+// Must match mix_name_hash() in the generated names.c.
+uint32_t mix(uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+
+    return (uint32_t)(hash >> 32);
+}
+
+vector<string> readNames(const char *path) {
+    std::ifstream in(path);
+    vector<string> names;
+    string line;
+
+    while (std::getline(in, line)) {
+        line.erase(std::remove_if(line.begin(), line.end(), [](unsigned char c) { return std::isspace(c); }), line.end());
+        if (!line.empty() && line[0] != '#') {
+            names.push_back(line);
+        }
+    }
+
+    return names;
+}
+
+string toEnum(const string &name) {
+    string id = "NAME_";
+
+    for (unsigned char c : name) {
+        id += std::isalnum(c) ? (char)std::toupper(c) : '_';
+    }
+
+    return id;
+}
+
+const char *fileHeader =
+    " *\n"
+    " *  A minimalist, cross-platform puzzle-platformer, designed\n"
+    " *  especially for the Nokia N-Gage.\n"
+    " *\n"
+    " *  Copyright (c) 2026, Michael Fitzmayer. All rights reserved.\n"
+    " *  SPDX-License-Identifier: MIT\n"
+    " *\n"
+    " *  Generated by tools/namegen from tools/names.txt; do not edit.\n"
+    " *\n"
+    " **/\n\n";
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        std::cerr << "usage: namegen <names.txt> <output dir>" << std::endl;
+        return 1;
+    }
+
+    vector<string> names = readNames(argv[1]);
+    if (names.empty()) {
+        std::cerr << "no names in " << argv[1] << std::endl;
+        return 1;
+    }
+
+    std::set<string> unique(names.begin(), names.end());
+    if (unique.size() != names.size()) {
+        std::cerr << "duplicate name in " << argv[1] << std::endl;
+        return 1;
+    }
+
+    // Hash and displace: names are spread over buckets, then each bucket gets
+    // the first displacement that moves all of its names into free slots.
+    uint32_t slotCount = names.size();
+    uint32_t bucketCount = (slotCount + 1) / 2;
+    vector<vector<uint32_t>> buckets(bucketCount);
+    vector<uint32_t> displacement(bucketCount, 0);
+    vector<int> slot(slotCount, -1);
+
+    for (uint32_t n = 0; n < slotCount; ++n) {
+        buckets[mix(djb2(names[n])) % bucketCount].push_back(n);
+    }
+
+    vector<uint32_t> order(bucketCount);
+    for (uint32_t b = 0; b < bucketCount; ++b) {
+        order[b] = b;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return buckets[a].size() > buckets[b].size(); });
+
+    for (uint32_t b : order) {
+        if (buckets[b].empty()) {
+            break;
+        }
+
+        for (uint32_t d = 1; d != 0; ++d) {
+            vector<uint32_t> taken;
+            bool fits = true;
+
+            for (uint32_t n : buckets[b]) {
+                uint32_t s = mix(djb2(names[n]) ^ d) % slotCount;
+                if (slot[s] >= 0 || std::find(taken.begin(), taken.end(), s) != taken.end()) {
+                    fits = false;
+                    break;
+                }
+                taken.push_back(s);
+            }
+
+            if (fits) {
+                for (size_t i = 0; i < taken.size(); ++i) {
+                    slot[taken[i]] = buckets[b][i];
+                }
+                displacement[b] = d;
+                break;
+            }
+        }
+
+        if (!displacement[b]) {
+            std::cerr << "no displacement found for bucket " << b << std::endl;
+            return 1;
+        }
+    }
+
+    string dir = argv[2];
+    FILE *header = fopen((dir + "/names.h").c_str(), "wb");
+    FILE *source = fopen((dir + "/names.c").c_str(), "wb");
+    if (!header || !source) {
+        std::cerr << "cannot write to " << dir << std::endl;
+        return 1;
+    }
+
+    fprintf(header, "/** @file names.h\n%s", fileHeader);
+    fprintf(header, "#ifndef NAMES_H\n#define NAMES_H\n\n#include <SDL3/SDL.h>\n\n");
+    fprintf(header, "typedef enum name_id\n{\n    NAME_UNKNOWN = 0,\n");
+    for (const auto &name : names) {
+        fprintf(header, "    %s,\n", toEnum(name).c_str());
+    }
+    fprintf(header, "    NAME_COUNT\n\n} name_id_t;\n\n");
+    fprintf(header, "name_id_t lookup_name(const char *name);\n\n#endif // NAMES_H\n");
+    fclose(header);
+
+    fprintf(source, "/** @file names.c\n%s", fileHeader);
+    fprintf(source, "#include <SDL3/SDL.h>\n\n#include \"names.h\"\n#include \"utils.h\"\n\n");
+    fprintf(source, "#define NAME_SLOTS   %u\n#define NAME_BUCKETS %u\n\n", slotCount, bucketCount);
+    fprintf(source, "static const Uint32 name_displacement[NAME_BUCKETS] = {");
+    for (uint32_t b = 0; b < bucketCount; ++b) {
+        fprintf(source, "%s0x%08x", b ? ", " : " ", displacement[b]);
+    }
+    fprintf(source, " };\n\nstatic const char *const name_string[NAME_SLOTS] = {\n");
+    for (uint32_t s = 0; s < slotCount; ++s) {
+        fprintf(source, "    \"%s\",\n", names[slot[s]].c_str());
+    }
+    fprintf(source, "};\n\nstatic const name_id_t name_id[NAME_SLOTS] = {\n");
+    for (uint32_t s = 0; s < slotCount; ++s) {
+        fprintf(source, "    %s,\n", toEnum(names[slot[s]]).c_str());
+    }
+    fprintf(source, "};\n\n");
+    fprintf(source,
+            "static Uint32 mix_name_hash(Uint64 hash)\n"
+            "{\n"
+            "    hash ^= hash >> 33;\n"
+            "    hash *= 0xff51afd7ed558ccdULL;\n"
+            "    hash ^= hash >> 33;\n"
+            "\n"
+            "    return (Uint32)(hash >> 32);\n"
+            "}\n"
+            "\n"
+            "name_id_t lookup_name(const char *name)\n"
+            "{\n"
+            "    if (!name)\n"
+            "    {\n"
+            "        return NAME_UNKNOWN;\n"
+            "    }\n"
+            "\n"
+            "    // One pass over the string, then a single compare rejects unknown names.\n"
+            "    Uint64 hash = generate_hash((const unsigned char *)name);\n"
+            "    Uint32 slot = mix_name_hash(hash ^ name_displacement[mix_name_hash(hash) %% NAME_BUCKETS]) %% NAME_SLOTS;\n"
+            "\n"
+            "    if (SDL_strcmp(name_string[slot], name) != 0)\n"
+            "    {\n"
+            "        return NAME_UNKNOWN;\n"
+            "    }\n"
+            "\n"
+            "    return name_id[slot];\n"
+            "}\n");
+    fclose(source);
+
+    std::cout << "namegen: " << slotCount << " names in " << bucketCount << " buckets" << std::endl;
+
+    return 0;
+}
@@ -1,109 +1,779 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
-#include <string>
-#include <cstdio>
+#include <map>
+#include <sstream>
 #include <stdint.h>
-#include <cstring>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
 #include <vector>
-#include <iterator>
 
+#if defined PACKER_ZLIB
+#include <zlib.h>
+#endif
+
+using std::string;
 using std::vector;
 
-vector<char> readToBuffer(FILE *fileDescriptor) {
-    const unsigned N = 1024;
-
-    fseek(fileDescriptor, 0, SEEK_END);
-    auto endPos = ftell(fileDescriptor);
-    rewind(fileDescriptor);
-    vector<char> total(endPos);
-    auto writeHead = std::begin(total);
-
-    for (int c = 0; c < endPos; ++c) {
-        char buffer[N];
-        size_t read = fread((void *) &buffer[0], 1, N, fileDescriptor);
-        if (read) {
-            for (unsigned int c = 0; c < read; ++c) {
-                *writeHead = (buffer[c]);
-                writeHead = std::next(writeHead);
+static const char *manifestMagic = "pfs-manifest 2";
+
+// Must match pfs_codec_t and the payload layout in src/pfs.c.
+enum Codec { CODEC_STORED = 0, CODEC_DEFLATE, CODEC_LZ, CODEC_COUNT };
+static const char *codecName[CODEC_COUNT] = {"stored", "deflate", "lz"};
+static const uint32_t sizeMask = 0x00ffffff;
+static const int codecShift = 24;
+static const int lzMinMatch = 4;
+
+// Rough N-Gage figures in bytes per millisecond, used to weigh read time against decode
+// time. Calibrate them with the game's archive_benchmark on the device.
+static const double readBytesPerMs = 600.0;
+static const double lzBytesPerMs = 15000.0;
+static const double inflateBytesPerMs = 2500.0;
+
+bool readFile(const string &path, vector<char> &content) {
+    FILE *in = fopen(path.c_str(), "rb");
+    if (!in) {
+        return false;
+    }
+
+    fseek(in, 0, SEEK_END);
+    long size = ftell(in);
+    rewind(in);
+
+    // One read for the whole file.
+    content.resize(size);
+    bool ok = size == 0 || fread(content.data(), 1, size, in) == (size_t)size;
+    fclose(in);
+
+    return ok;
+}
+
+bool statFile(const string &path, uint64_t &size, int64_t &mtime) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) {
+        return false;
+    }
+
+    size = (uint64_t)info.st_size;
+    mtime = (int64_t)info.st_mtime;
+    return true;
+}
+
+bool endsWith(const string &text, const string &suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+uint64_t fnv1a(const vector<char> &data) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    for (char c : data) {
+        hash ^= (unsigned char)c;
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+#if defined PACKER_ZLIB
+bool gzipBuffer(const vector<char> &in, vector<char> &out) {
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+
+    // windowBits 15 + 16 selects the gzip wrapper; the header time stays 0 so output is reproducible.
+    if (deflateInit2(&stream, 9, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+
+    out.resize(deflateBound(&stream, in.size()) + 32);
+    stream.next_in = (Bytef *)in.data();
+    stream.avail_in = (uInt)in.size();
+    stream.next_out = (Bytef *)out.data();
+    stream.avail_out = (uInt)out.size();
+
+    int result = deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+
+    return result == Z_STREAM_END;
+}
+#endif
+
+void writeLength(vector<char> &out, size_t length) {
+    while (length >= 255) {
+        out.push_back((char)255);
+        length -= 255;
+    }
+    out.push_back((char)length);
+}
+
+void writeSequence(vector<char> &out, const uint8_t *literals, size_t literalLength, size_t offset, size_t matchLength) {
+    size_t match = matchLength ? matchLength - lzMinMatch : 0;
+    out.push_back((char)(((literalLength < 15 ? literalLength : 15) << 4) | (match < 15 ? match : 15)));
+    if (literalLength >= 15) {
+        writeLength(out, literalLength - 15);
+    }
+    out.insert(out.end(), literals, literals + literalLength);
+
+    if (matchLength) {
+        out.push_back((char)(offset & 0xff));
+        out.push_back((char)(offset >> 8));
+        if (match >= 15) {
+            writeLength(out, match - 15);
+        }
+    }
+}
+
+// Greedy LZ77 over hash chains in a 64 KiB window, in the layout decode_lz() reads.
+// margin receives the slack the decoder needs to decode the stream over itself.
+void lzEncode(const vector<char> &in, vector<char> &out, uint32_t &margin) {
+    const uint8_t *src = (const uint8_t *)in.data();
+    size_t size = in.size();
+    const int hashBits = 16;
+    const int maxAttempts = 64;
+    vector<int32_t> head((size_t)1 << hashBits, -1);
+    vector<int32_t> chain(size, -1);
+
+    auto hashAt = [&](size_t p) {
+        uint32_t v;
+        std::memcpy(&v, src + p, 4);
+        return (v * 2654435761u) >> (32 - hashBits);
+    };
+    auto insert = [&](size_t p) {
+        uint32_t h = hashAt(p);
+        chain[p] = head[h];
+        head[h] = (int32_t)p;
+    };
+
+    out.clear();
+    int64_t worst = 0;
+    size_t anchor = 0;
+    size_t p = 0;
+
+    while (p + lzMinMatch <= size) {
+        size_t bestLength = 0;
+        size_t bestOffset = 0;
+        int attempts = maxAttempts;
+
+        for (int32_t candidate = head[hashAt(p)]; candidate >= 0 && p - candidate <= 65535 && attempts--; candidate = chain[candidate]) {
+            size_t length = 0;
+            while (p + length < size && src[candidate + length] == src[p + length]) {
+                ++length;
+            }
+            if (length > bestLength) {
+                bestLength = length;
+                bestOffset = p - candidate;
+            }
+        }
+        insert(p);
+
+        if (bestLength < (size_t)lzMinMatch) {
+            ++p;
+            continue;
+        }
+
+        writeSequence(out, src + anchor, p - anchor, bestOffset, bestLength);
+        for (size_t q = p + 1; q < p + bestLength && q + lzMinMatch <= size; ++q) {
+            insert(q);
+        }
+        p += bestLength;
+        anchor = p;
+
+        // In place, the output written so far must stay behind the input still unread.
+        worst = std::max(worst, (int64_t)p - (int64_t)out.size());
+    }
+
+    if (anchor < size) {
+        writeSequence(out, src + anchor, size - anchor, 0, 0);
+    }
+
+    int64_t needed = worst - (int64_t)size + (int64_t)out.size();
+    margin = needed > 0 ? (uint32_t)needed : 0;
+}
+
+// Reference decoder for round-trip checks and the benchmark; mirrors decode_lz() in src/pfs.c.
+bool lzDecode(const uint8_t *src, size_t srcSize, uint8_t *dst, size_t dstSize) {
+    const uint8_t *ip = src;
+    const uint8_t *ipEnd = src + srcSize;
+    uint8_t *op = dst;
+    uint8_t *opEnd = dst + dstSize;
+
+    auto readLength = [&](size_t &length) {
+        unsigned step;
+        do {
+            if (ip >= ipEnd) {
+                return false;
             }
+            step = *ip++;
+            length += step;
+        } while (step == 255);
+        return true;
+    };
+
+    while (ip < ipEnd) {
+        unsigned token = *ip++;
+        size_t length = token >> 4;
+        if (length == 15 && !readLength(length)) {
+            return false;
+        }
+        if (length > (size_t)(ipEnd - ip) || length > (size_t)(opEnd - op)) {
+            return false;
         }
-        if (read < N) {
+        std::memmove(op, ip, length);
+        op += length;
+        ip += length;
+
+        if (ip >= ipEnd) {
             break;
         }
+        if (ipEnd - ip < 2) {
+            return false;
+        }
+
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        length = (token & 15) + lzMinMatch;
+        if ((token & 15) == 15 && !readLength(length)) {
+            return false;
+        }
+        if (offset == 0 || offset > (size_t)(op - dst) || length > (size_t)(opEnd - op)) {
+            return false;
+        }
+
+        const uint8_t *match = op - offset;
+        if (offset >= length) {
+            std::memcpy(op, match, length);
+            op += length;
+        } else {
+            while (length--) {
+                *op++ = *match++;
+            }
+        }
+    }
+
+    return op == opEnd;
+}
+
+// Decodes the way the game does: stream at the tail of one raw + margin buffer.
+bool lzCheckInPlace(const vector<char> &raw, const vector<char> &encoded, uint32_t margin) {
+    size_t capacity = raw.size() + margin;
+    if (capacity < encoded.size()) {
+        return false;
     }
 
-    return total;
+    vector<uint8_t> buffer(capacity ? capacity : 1);
+    uint8_t *src = buffer.data() + capacity - encoded.size();
+    std::memcpy(src, encoded.data(), encoded.size());
+
+    return lzDecode(src, encoded.size(), buffer.data(), raw.size()) && std::memcmp(buffer.data(), raw.data(), raw.size()) == 0;
+}
+
+#if defined PACKER_ZLIB
+bool deflateBuffer(const vector<char> &in, vector<char> &out) {
+    uLongf size = compressBound(in.size());
+    out.resize(size);
+    if (compress2((Bytef *)out.data(), &size, (const Bytef *)in.data(), in.size(), 9) != Z_OK) {
+        return false;
+    }
+    out.resize(size);
+    return true;
 }
 
+bool inflateBuffer(const vector<char> &in, vector<char> &out, size_t rawSize) {
+    uLongf size = rawSize;
+    out.resize(rawSize ? rawSize : 1);
+    return uncompress((Bytef *)out.data(), &size, (const Bytef *)in.data(), in.size()) == Z_OK && size == rawSize;
+}
+#endif
+
+struct Options {
+    bool allowed[CODEC_COUNT] = {true, false, true};
+    string codecList = "stored,lz";
+};
+
 struct Entry {
 public:
     Entry(std::string path, std::string key);
 
     vector<char> mContent;
     std::string id;
+    std::string source;
     uint32_t offset = 0;
+
+    uint64_t sourceSize = 0;
+    int64_t sourceTime = 0;
+    uint64_t hash = 0;
+    Codec codec = CODEC_STORED;
+    bool compress = false;
+    bool reused = false;
+    bool failed = false;
+    int payload = -1; // Index of the entry whose bytes are stored for this one.
 };
 
-Entry::Entry(std::string path, std::string key) : id(key) {
-    FILE *in = fopen(path.c_str(), "rb");
-    mContent = readToBuffer(in);
-    fclose(in);
+Entry::Entry(std::string path, std::string key) : id(key), source(path) {
+    // name.gz is compressed from name while packing, so a stale name.gz left on disk is never picked up.
+    // Without zlib a prepared name.gz is packed as is.
+    uint64_t size;
+    int64_t mtime;
+    if (endsWith(path, ".gz")) {
+        string plain = path.substr(0, path.size() - 3);
+#if defined PACKER_ZLIB
+        bool usePlain = statFile(plain, size, mtime);
+#else
+        bool usePlain = !statFile(path, size, mtime);
+#endif
+        if (usePlain) {
+            source = plain;
+            compress = true;
+        }
+    }
 }
 
-void writeHeader(FILE *file, uint16_t entries) {
-    fwrite(&entries, 2, 1, file);
+struct ManifestRecord {
+    std::string source;
+    uint64_t sourceSize = 0;
+    int64_t sourceTime = 0;
+    uint32_t offset = 0;
+    uint32_t size = 0;
+    int codec = 0;
+    uint64_t hash = 0;
+};
+
+// The header names the codecs that were allowed; packing with another set starts over.
+std::map<string, ManifestRecord> readManifest(const string &path, const string &header) {
+    std::map<string, ManifestRecord> records;
+    std::ifstream in(path);
+    string line;
+
+    if (!std::getline(in, line) || line != header) {
+        return records;
+    }
+
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        string key;
+        ManifestRecord record;
+        if (fields >> key >> record.source >> record.sourceSize >> record.sourceTime >> record.offset >> record.size >> record.codec >> std::hex >>
+            record.hash) {
+            records[key] = record;
+        }
+    }
+
+    return records;
 }
 
-int main(int argc, char **argv) {
-    int c = argc;
+void writeHeader(vector<char> &out, uint16_t entries) {
+    out.push_back((char)(entries & 0xff));
+    out.push_back((char)(entries >> 8));
+}
+
+void writeU32(vector<char> &out, uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) {
+        out.push_back((char)((value >> shift) & 0xff));
+    }
+}
+
+struct Encoding {
+    Codec codec = CODEC_STORED;
+    vector<char> payload; // Codec header included.
+    double cost = 0.0;    // Estimated milliseconds to read and decode on the device.
+};
+
+// Every allowed encoding of raw, each round-tripped before it may be chosen.
+// gzip: the game expects a gzip stream, so the stored form is gzip and the
+// codecs carry the plain source (map.c inflates only when it sees the gzip magic).
+vector<Encoding> encodeAll(const string &id, const vector<char> &raw, bool gzip, const Options &options) {
+    vector<Encoding> encodings;
+
+    Encoding stored;
+    stored.payload = raw;
+#if defined PACKER_ZLIB
+    if (gzip) {
+        if (!gzipBuffer(raw, stored.payload)) {
+            return encodings;
+        }
+        stored.cost = raw.size() / inflateBytesPerMs;
+    }
+#endif
+    stored.cost += stored.payload.size() / readBytesPerMs;
+    encodings.push_back(stored);
+
+    // Audio may be streamed straight out of the pack, which needs the bytes as they are.
+    if (endsWith(id, ".wav")) {
+        return encodings;
+    }
+
+    auto withHeader = [&](Codec codec, const vector<char> &stream, uint32_t argument, double decodeRate) {
+        Encoding encoding;
+        encoding.codec = codec;
+        writeU32(encoding.payload, (uint32_t)raw.size());
+        writeU32(encoding.payload, argument);
+        encoding.payload.insert(encoding.payload.end(), stream.begin(), stream.end());
+        encoding.cost = encoding.payload.size() / readBytesPerMs + raw.size() / decodeRate;
+        encodings.push_back(encoding);
+    };
+
+    if (options.allowed[CODEC_LZ]) {
+        vector<char> stream;
+        uint32_t margin = 0;
+        lzEncode(raw, stream, margin);
+        if (!lzCheckInPlace(raw, stream, margin)) {
+            std::cerr << "lz round trip failed for " << id << std::endl;
+        } else {
+            withHeader(CODEC_LZ, stream, margin, lzBytesPerMs);
+        }
+    }
+
+#if defined PACKER_ZLIB
+    if (options.allowed[CODEC_DEFLATE]) {
+        vector<char> stream;
+        vector<char> check;
+        if (deflateBuffer(raw, stream) && inflateBuffer(stream, check, raw.size()) && check == raw) {
+            withHeader(CODEC_DEFLATE, stream, 0, inflateBytesPerMs);
+        } else {
+            std::cerr << "deflate round trip failed for " << id << std::endl;
+        }
+    }
+#endif
+
+    return encodings;
+}
+
+// Cheapest estimated load wins; ties go to the earlier, simpler encoding.
+Encoding &chooseEncoding(vector<Encoding> &encodings) {
+    size_t best = 0;
+    for (size_t e = 1; e < encodings.size(); ++e) {
+        if (encodings[e].cost < encodings[best].cost) {
+            best = e;
+        }
+    }
+    return encodings[best];
+}
+
+// Loads an entry's payload: reused from the previous pack when its source is unchanged,
+// otherwise read from disk and encoded.
+void loadEntry(Entry &entry, const std::map<string, ManifestRecord> &manifest, const string &previousPack, const Options &options) {
+    if (!statFile(entry.source, entry.sourceSize, entry.sourceTime)) {
+        std::cerr << "missing " << entry.source << std::endl;
+        entry.failed = true;
+        return;
+    }
+
+    auto record = manifest.find(entry.id);
+    if (record != manifest.end() && record->second.source == entry.source &&
+        record->second.sourceSize == entry.sourceSize && record->second.sourceTime == entry.sourceTime) {
+        FILE *in = fopen(previousPack.c_str(), "rb");
+        if (in) {
+            entry.mContent.resize(record->second.size);
+            bool ok = fseek(in, (long)record->second.offset + 4, SEEK_SET) == 0 &&
+                      (record->second.size == 0 || fread(entry.mContent.data(), 1, record->second.size, in) == record->second.size);
+            fclose(in);
 
+            if (ok && fnv1a(entry.mContent) == record->second.hash && record->second.codec < CODEC_COUNT) {
+                entry.hash = record->second.hash;
+                entry.codec = (Codec)record->second.codec;
+                entry.reused = true;
+                return;
+            }
+        }
+    }
+
+    vector<char> raw;
+    if (!readFile(entry.source, raw)) {
+        std::cerr << "cannot read " << entry.source << std::endl;
+        entry.failed = true;
+        return;
+    }
+
+#if !defined PACKER_ZLIB
+    if (entry.compress) {
+        std::cerr << "built without zlib, cannot create " << entry.id << std::endl;
+        entry.failed = true;
+        return;
+    }
+#endif
+
+    vector<Encoding> encodings = encodeAll(entry.id, raw, entry.compress, options);
+    if (encodings.empty()) {
+        std::cerr << "cannot compress " << entry.source << std::endl;
+        entry.failed = true;
+        return;
+    }
+
+    Encoding &chosen = chooseEncoding(encodings);
+    entry.codec = chosen.codec;
+    entry.mContent.swap(chosen.payload);
+    entry.hash = fnv1a(entry.mContent);
+}
+
+// Decode throughput of every codec on every input, measured on this machine.
+int benchmark(vector<Entry> &files, const Options &options) {
+    std::printf("%-20s %-8s %10s %10s %7s %10s %9s\n", "entry", "codec", "raw", "encoded", "ratio", "MB/s", "est. ms");
+
+    for (auto &entry : files) {
+        vector<char> raw;
+        if (!readFile(entry.source, raw)) {
+            std::cerr << "cannot read " << entry.source << std::endl;
+            return 1;
+        }
+
+        vector<Encoding> encodings = encodeAll(entry.id, raw, entry.compress, options);
+        if (encodings.empty()) {
+            return 1;
+        }
+        Codec chosen = chooseEncoding(encodings).codec;
+
+        for (const auto &encoding : encodings) {
+            vector<char> out(raw.size() ? raw.size() : 1);
+            vector<char> stream(encoding.payload.begin() + (encoding.codec == CODEC_STORED ? 0 : 8), encoding.payload.end());
+            uint32_t margin = 0;
+            if (encoding.codec == CODEC_LZ) {
+                std::memcpy(&margin, encoding.payload.data() + 4, 4);
+            }
+
+            // Repeat until the measurement is long enough to trust.
+            size_t runs = 0;
+            auto start = std::chrono::steady_clock::now();
+            double elapsed = 0.0;
+            do {
+                bool ok = true;
+                switch (encoding.codec) {
+                case CODEC_LZ:
+                    ok = lzCheckInPlace(raw, stream, margin);
+                    break;
+#if defined PACKER_ZLIB
+                case CODEC_DEFLATE:
+                    ok = inflateBuffer(stream, out, raw.size());
+                    break;
+                case CODEC_STORED:
+                    if (entry.compress) {
+                        z_stream z;
+                        std::memset(&z, 0, sizeof(z));
+                        ok = inflateInit2(&z, 15 + 16) == Z_OK;
+                        z.next_in = (Bytef *)stream.data();
+                        z.avail_in = (uInt)stream.size();
+                        z.next_out = (Bytef *)out.data();
+                        z.avail_out = (uInt)out.size();
+                        ok = ok && inflate(&z, Z_FINISH) == Z_STREAM_END;
+                        inflateEnd(&z);
+                    } else {
+                        std::memcpy(out.data(), stream.data(), stream.size());
+                    }
+                    break;
+#endif
+                default:
+                    std::memcpy(out.data(), stream.data(), std::min(stream.size(), out.size()));
+                    break;
+                }
+                if (!ok) {
+                    std::cerr << codecName[encoding.codec] << " decode failed for " << entry.id << std::endl;
+                    return 1;
+                }
+                ++runs;
+                elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            } while (elapsed < 50.0);
+
+            double perRun = elapsed / runs;
+            string name = encoding.codec == CODEC_STORED && entry.compress ? "gzip" : codecName[encoding.codec];
+            std::printf("%-20s %-8s %10zu %10zu %6.1f%% %10.1f %9.2f%s\n", entry.id.c_str(), name.c_str(), raw.size(), encoding.payload.size(),
+                        raw.empty() ? 100.0 : 100.0 * encoding.payload.size() / raw.size(), perRun > 0.0 ? raw.size() / perRun / 1000.0 : 0.0,
+                        encoding.cost, encoding.codec == chosen ? " *" : "");
+        }
+    }
+
+    std::printf("MB/s: decode on this machine. est. ms: read plus decode on the device model. *: packed.\n");
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    string output = "data.pfs";
+    string manifestPath;
+    unsigned jobs = std::thread::hardware_concurrency();
+    bool runBenchmark = false;
+    Options options;
     vector<Entry> files;
-    while (--c) {
-        std::string filename = argv[c];
-        std::cout << "adding " << filename << std::endl;
-        files.emplace_back(filename, filename.substr(filename.find('/') + 1));
+
+    auto start = std::chrono::steady_clock::now();
+
+#if defined PACKER_ZLIB
+    options.allowed[CODEC_DEFLATE] = true;
+    options.codecList = "stored,deflate,lz";
+#endif
+
+    for (int c = 1; c < argc; ++c) {
+        string arg = argv[c];
+        if (arg == "-o" && c + 1 < argc) {
+            output = argv[++c];
+        } else if (arg == "-m" && c + 1 < argc) {
+            manifestPath = argv[++c];
+        } else if (arg == "-j" && c + 1 < argc) {
+            jobs = (unsigned)std::atoi(argv[++c]);
+        } else if (arg == "-c" && c + 1 < argc) {
+            // Codecs the target can decode, e.g. -c stored,lz for builds without zlib.
+            options.codecList = argv[++c];
+            for (int codec = 0; codec < CODEC_COUNT; ++codec) {
+                options.allowed[codec] = ("," + options.codecList + ",").find(string(",") + codecName[codec] + ",") != string::npos;
+            }
+            options.allowed[CODEC_STORED] = true;
+        } else if (arg == "-b") {
+            runBenchmark = true;
+        } else {
+            // name.gz asks for a gzipped name, but it is stored as name: whichever codec
+            // wins, the game looks it up by its plain name and checks for the gzip magic.
+            string key = arg.substr(arg.find('/') + 1);
+            if (endsWith(key, ".gz")) {
+                key.resize(key.size() - 3);
+            }
+            files.emplace_back(arg, key);
+        }
     }
 
-    FILE *file = fopen("data.pfs", "wb");
-    uint32_t accOffset = 0;
-    uint16_t entries = files.size();
-    writeHeader(file, entries);
+#if !defined PACKER_ZLIB
+    options.allowed[CODEC_DEFLATE] = false;
+#endif
 
-    accOffset += 2;
+    if (runBenchmark) {
+        return benchmark(files, options);
+    }
 
-    for (uint16_t e = 0; e < entries; ++e) {
-        accOffset += 4 + 1 + files[e].id.length() + 1;
+    if (manifestPath.empty()) {
+        manifestPath = output + ".manifest";
+    }
+    if (jobs == 0) {
+        jobs = 1;
     }
 
-    std::cout << "base offset " << accOffset << std::endl;
+    // Without the previous pack its offsets are meaningless, so the manifest only counts alongside it.
+    string manifestHeader = string(manifestMagic) + " " + options.codecList;
+    std::map<string, ManifestRecord> manifest;
+    uint64_t packSize = 0;
+    int64_t packTime = 0;
+    if (statFile(output, packSize, packTime)) {
+        manifest = readManifest(manifestPath, manifestHeader);
+    }
 
-    for (uint16_t e = 0; e < entries; ++e) {
-        files[e].offset = accOffset;
-        std::cout << "Offset for " << files[e].id << " = " << accOffset << std::endl;
-        accOffset += 4 + files[e].mContent.size();
+    std::atomic<size_t> next(0);
+    vector<std::thread> workers;
+    for (unsigned j = 0; j < jobs && j < files.size(); ++j) {
+        workers.emplace_back([&]() {
+            for (size_t e = next++; e < files.size(); e = next++) {
+                loadEntry(files[e], manifest, output, options);
+            }
+        });
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    size_t reused = 0;
+    size_t codecCount[CODEC_COUNT] = {0};
+    for (const auto &entry : files) {
+        if (entry.failed) {
+            return 1;
+        }
+        if (entry.mContent.size() > sizeMask) {
+            std::cerr << entry.id << " is too large for the pack" << std::endl;
+            return 1;
+        }
+        reused += entry.reused ? 1 : 0;
+        codecCount[entry.codec] += 1;
     }
 
+    // Identical payloads are stored once; their directory entries share an offset.
+    std::map<std::pair<uint64_t, size_t>, vector<int>> byHash;
+    size_t unique = 0;
+    for (size_t e = 0; e < files.size(); ++e) {
+        auto &candidates = byHash[std::make_pair(files[e].hash, files[e].mContent.size())];
+        for (int other : candidates) {
+            if (files[other].codec == files[e].codec && files[other].mContent == files[e].mContent) {
+                files[e].payload = other;
+                break;
+            }
+        }
+        if (files[e].payload < 0) {
+            files[e].payload = (int)e;
+            candidates.push_back((int)e);
+            unique += 1;
+        }
+    }
+
+    uint16_t entries = files.size();
+    uint32_t accOffset = 2;
+
     for (uint16_t e = 0; e < entries; ++e) {
-        std::cout << "entry " << files[e].id << " starting at " << ftell(file) << std::endl;
-        uint32_t offset = files[e].offset;
-        const char *name = files[e].id.c_str();
-        uint8_t strLen = std::strlen(name);
-        fwrite(&offset, 4, 1, file);
-        fwrite(&strLen, 1, 1, file);
-        fwrite(name, strLen + 1, 1, file);
+        accOffset += 4 + 1 + files[e].id.length() + 1;
     }
 
     for (uint16_t e = 0; e < entries; ++e) {
-        uint32_t size = files[e].mContent.size();
-        std::cout << "writing a file " << files[e].id << " with " << size << " bytes at " << ftell(file) << std::endl;
-        fwrite(&size, 4, 1, file);
+        if (files[e].payload == e) {
+            files[e].offset = accOffset;
+            accOffset += 4 + files[e].mContent.size();
+        }
+    }
+    for (uint16_t e = 0; e < entries; ++e) {
+        files[e].offset = files[files[e].payload].offset;
+    }
 
-        for (const auto &c : files[e].mContent) {
-            fwrite(&c, 1, 1, file);
+    // Identical entry list and payloads: the previous pack is already current.
+    bool current = reused == files.size() && manifest.size() == files.size() && packSize == accOffset;
+    for (uint16_t e = 0; current && e < entries; ++e) {
+        current = manifest[files[e].id].offset == files[e].offset;
+    }
+
+    if (!current) {
+        // The whole pack is assembled in memory and written with one call.
+        vector<char> out;
+        out.reserve(accOffset);
+        writeHeader(out, entries);
+
+        for (uint16_t e = 0; e < entries; ++e) {
+            const char *name = files[e].id.c_str();
+            uint8_t strLen = std::strlen(name);
+            writeU32(out, files[e].offset);
+            out.push_back((char)strLen);
+            out.insert(out.end(), name, name + strLen + 1);
+        }
+
+        for (uint16_t e = 0; e < entries; ++e) {
+            if (files[e].payload == e) {
+                writeU32(out, (uint32_t)files[e].mContent.size() | ((uint32_t)files[e].codec << codecShift));
+                out.insert(out.end(), files[e].mContent.begin(), files[e].mContent.end());
+            }
+        }
+
+        string temp = output + ".tmp";
+        FILE *file = fopen(temp.c_str(), "wb");
+        if (!file || fwrite(out.data(), 1, out.size(), file) != out.size() || fclose(file) != 0) {
+            std::cerr << "cannot write " << temp << std::endl;
+            return 1;
+        }
+        std::remove(output.c_str());
+        if (std::rename(temp.c_str(), output.c_str()) != 0) {
+            std::cerr << "cannot replace " << output << std::endl;
+            return 1;
         }
     }
 
-    fclose(file);
+    std::ofstream manifestOut(manifestPath);
+    manifestOut << manifestHeader << "\n";
+    for (const auto &entry : files) {
+        manifestOut << entry.id << " " << entry.source << " " << entry.sourceSize << " " << entry.sourceTime << " " << entry.offset << " "
+                    << entry.mContent.size() << " " << entry.codec << " " << std::hex << entry.hash << std::dec << "\n";
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    std::cout << (current ? "up to date " : "packed ") << output << ": " << files.size() << " entries, " << unique << " payloads, " << reused
+              << " reused, " << accOffset << " bytes, " << jobs << " jobs, " << elapsed << " ms" << std::endl;
+    std::cout << "codecs:";
+    for (int codec = 0; codec < CODEC_COUNT; ++codec) {
+        std::cout << " " << codecName[codec] << " " << codecCount[codec];
+    }
+    std::cout << std::endl;
 
     return 0;
 }